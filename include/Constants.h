@@ -31,17 +31,29 @@ using glm::vec4;
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <format>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <numbers>
+#include <numeric>
 #include <optional>
+#include <queue>
+#include <random>
 #include <set>
 #include <span>
 #include <sstream>
@@ -135,18 +147,20 @@ struct QueueFamilyIndices {
     }
 };
 
-struct UniformBufferObject {
-    mat4 model;
+// Written once per frame, shared by every draw (std140 layout).
+struct CameraUBO {
     mat4 view;
     mat4 proj;
+    mat4 viewProj;
+    alignas(16) vec3 position;
+    float time; // Packed into the w component of position
 };
 
-struct PushConstants {
-    alignas(16) vec3 cameraEye;
-    alignas(16) vec3 cameraCenter;
-    alignas(16) vec3 cameraUp;
-    float time;
-    int stage;
+// Per-object data, read in the vertex shader through gl_InstanceIndex from a std430 storage buffer.
+struct ObjectData {
+    mat4 model;
+    uint32_t materialID; // Slot in the bindless texture table, or a virtual texture if VIRTUAL_MATERIAL_BIT is set
+    uint32_t padding[3]; // std430 rounds the struct size up to the alignment of mat4
 };
 
 namespace FilePaths {
@@ -163,6 +177,16 @@ constexpr auto SHADER_VERT_PHONG = "shaders/compiled/shader_phong.vert.spv";
 constexpr auto SHADER_FRAG_PHONG = "shaders/compiled/shader_phong.frag.spv";
 constexpr auto SHADER_VERT_PHONG_STAGES = "shaders/compiled/shader_phong_stages.vert.spv";
 constexpr auto SHADER_FRAG_PHONG_STAGES = "shaders/compiled/shader_phong_stages.frag.spv";
+constexpr auto SHADER_COMP_DOWNSAMPLE = "shaders/compiled/downsample.comp.spv";
+// All of the above in one file, written by scripts/bundle_shaders.py
+constexpr auto SHADER_BUNDLE = "shaders/compiled/shaders.bundle";
+
+// Driver specific, validated against the device before use and rewritten on shutdown
+constexpr auto PIPELINE_CACHE = "cache/pipeline_cache.bin";
+// Block compressed textures with their mip chains, cooked from the source images on first use
+constexpr auto TEXTURE_CACHE = "cache/textures";
+// Device memory reports are appended to this every Settings::MEMORY_REPORT_INTERVAL_FRAMES
+constexpr auto MEMORY_REPORT = "logs/memory_report.txt";
 
 constexpr auto FACE_TEXTURE = "assets/textures/texture.jpg";
 constexpr auto VIKING_ROOM_TEXTURE = "assets/textures/viking_room.png";
@@ -216,15 +240,45 @@ static DEF readFile(const string &filename) -> vector<char> {
     return buffer;
 }
 
+// Written next to the target and renamed over it, so a crash mid-write never leaves a truncated file behind. The
+// temporary file is removed again if either step fails, returns false then.
+static DEF writeFileAtomically(const std::filesystem::path &filepath, const std::span<const std::byte> data) -> bool {
+    std::filesystem::path temporaryPath = filepath;
+    temporaryPath += ".tmp";
+
+    std::error_code error;
+    std::filesystem::create_directories(filepath.parent_path(), error);
+    bool written = false;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        written = static_cast<bool>(file);
+    }
+    if (written) std::filesystem::rename(temporaryPath, filepath, error);
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
 } // namespace Util
 
 namespace Settings {
     constexpr uint32_t DEFAULT_WINDOW_WIDTH = 1920;
     constexpr uint32_t DEFAULT_WINDOW_HEIGHT = 1080;
+    // Resizing only rebuilds the swap chain and the attachments that depend on its extent.
+    constexpr bool WINDOW_RESIZABLE = true;
 
     constexpr auto PROJECT_NAME = "Daniel's 3D Engine";
 
     constexpr int STARTING_STAGE = 7;
+    // Stages 0 to STAGE_COUNT - 1, each gets its own pipeline with the stage baked in as a specialization constant
+    constexpr int STAGE_COUNT = 8;
+    // Flat color, built synchronously at startup and shown by every stage whose pipeline is still compiling
+    constexpr int FALLBACK_STAGE = 1;
+    // Pipelines compile on their own workers, so long compilations never hold up command recording
+    constexpr uint32_t PIPELINE_COMPILE_THREADS = 2;
 
     constexpr float MOUSE_SENSITIVITY = 5.0f;
 
@@ -235,7 +289,111 @@ namespace Settings {
     constexpr bool ALLOW_DEVICE_WITHOUT_INTEGRATED_GPU = true;
     constexpr bool ALLOW_DEVICE_WITHOUT_GEOMETRY_SHADER = true;
 
-    constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // Per-frame resources are created for this many frames in flight, Engine::setFramesInFlight picks how many of
+    // them are used at runtime, starting with FRAMES_IN_FLIGHT.
+    constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+    constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+    // The CPU waits for frames on the timeline semaphore every submission signals, the per-frame fences otherwise.
+    constexpr bool USE_TIMELINE_SEMAPHORE = true;
+
+    // Models sharing a mesh get merged into a single instanced draw call, if disabled every model is drawn individually.
+    constexpr bool USE_INSTANCING = true;
+    // Per-frame region of the FrameAllocator, has to fit the camera UBO and the object data of every drawn instance.
+    constexpr VkDeviceSize FRAME_ALLOCATOR_CAPACITY = 16ULL * 1024 * 1024;
+    // Initial size of the FrameArena for transient host data, a frame needing more makes it grow for the next ones.
+    constexpr size_t FRAME_ARENA_CAPACITY = 1024ULL * 1024;
+    // Static range of the dynamic object buffer binding, the most instances a single frame can draw.
+    constexpr uint32_t MAX_OBJECTS = 100'000;
+    // Draws are recorded into secondary command buffers on up to this many threads.
+    constexpr uint32_t MAX_RECORDING_THREADS = 8;
+    // Below this many draws per thread the scene is recorded inline on the main thread.
+    constexpr uint32_t MIN_DRAWS_PER_RECORDING_THREAD = 256;
+    // Issue the draws through vkCmdDrawIndexedIndirect from per-frame command records instead of one vkCmdDrawIndexed each.
+    constexpr bool USE_INDIRECT_DRAWS = false;
+    // Keep recorded command buffers around and only re-record them when the scene structure changes.
+    constexpr bool CACHE_COMMAND_BUFFERS = true;
+    // Upper bound of the bindless texture table, clamped to the device limits at startup.
+    constexpr uint32_t MAX_BINDLESS_TEXTURES = 1024;
+    // Upload textures block compressed when the device samples BC formats, RGBA8 is the fallback.
+    constexpr bool COMPRESS_TEXTURES = true;
+    // BC7 keeps color textures at 8 bits per texel in noticeably better quality, otherwise BC1 (4 bits) or BC3 with alpha.
+    constexpr bool PREFER_BC7 = true;
+    // Build RGBA8 mip chains on the CPU and upload every level in one copy, instead of blitting them on the GPU.
+    constexpr bool GENERATE_MIPMAPS_ON_CPU = true;
+    // Resident mip levels of the texture manager are kept below this, least recently used textures are evicted first.
+    constexpr VkDeviceSize TEXTURE_VRAM_BUDGET = 256ULL * 1024 * 1024;
+    // Referenced textures only lose top mips while their largest remaining level is at least this many texels wide.
+    constexpr uint32_t TEXTURE_MIN_RESIDENT_SIZE = 64;
+    // Virtual texture pages in texels, without the border that every page repeats of its neighbours for filtering.
+    // The virtual texture settings below have to match shaders/shader_phong_stages.frag.
+    constexpr uint32_t VIRTUAL_TEXTURE_PAGE_SIZE = 128;
+    constexpr uint32_t VIRTUAL_TEXTURE_PAGE_BORDER = 4;
+    // Slots per side of the physical page cache, 16 makes it a 2176x2176 texture of 256 pages.
+    constexpr uint32_t VIRTUAL_TEXTURE_CACHE_PAGES = 16;
+    constexpr uint32_t MAX_VIRTUAL_TEXTURES = 16;
+    // Page table entries of every virtual texture together, each one is a counter in the feedback buffer.
+    constexpr uint32_t VIRTUAL_TEXTURE_MAX_PAGES = 16'384;
+    // One fragment out of every STRIDE x STRIDE block writes feedback, a different one every frame.
+    constexpr uint32_t VIRTUAL_TEXTURE_FEEDBACK_STRIDE = 4;
+    // Pages streamed and uploaded per frame at most.
+    constexpr uint32_t VIRTUAL_TEXTURE_UPLOADS_PER_FRAME = 32;
+    // Marks material IDs that index the virtual textures instead of the bindless texture table.
+    constexpr uint32_t VIRTUAL_MATERIAL_BIT = 1u << 31;
+    // Heaps warn once their usage passes this fraction of the driver's budget, or of the heap size without one.
+    constexpr double MEMORY_HEAP_WARNING_FRACTION = 0.9;
+    // Per MemoryCategory in declaration order (meshes, textures, uniforms, attachments, staging, other), what a scene
+    // is expected to stay below. Staging in particular should drop back to near zero once loading is done.
+    constexpr array<VkDeviceSize, 6> MEMORY_CATEGORY_WARNING_BYTES = {
+        512ULL * 1024 * 1024,
+        1024ULL * 1024 * 1024,
+        64ULL * 1024 * 1024,
+        512ULL * 1024 * 1024,
+        256ULL * 1024 * 1024,
+        128ULL * 1024 * 1024};
+    constexpr uint32_t MEMORY_CHECK_INTERVAL_FRAMES = 60;
+    // Frames between reports appended to FilePaths::MEMORY_REPORT, 0 disables them.
+    constexpr uint32_t MEMORY_REPORT_INTERVAL_FRAMES = 3600;
+    // Staging buffers are pooled in power of two size classes between these, larger uploads get buffers of their own.
+    constexpr VkDeviceSize STAGING_POOL_MIN_BUFFER_SIZE = 64ULL * 1024;
+    constexpr VkDeviceSize STAGING_POOL_MAX_BUFFER_SIZE = 64ULL * 1024 * 1024;
+    // Idle staging buffers beyond this are freed right away, least recently used first.
+    constexpr VkDeviceSize STAGING_POOL_MAX_IDLE_BYTES = 128ULL * 1024 * 1024;
+    // Staging buffers that stay unused for this many frames are freed.
+    constexpr uint32_t STAGING_POOL_IDLE_FRAMES = 600;
+
+    constexpr bool RUN_BENCHMARKS = false;
+    constexpr array<uint32_t, 3> INSTANCING_BENCHMARK_COUNTS = {1'000, 10'000, 100'000};
+    constexpr uint32_t BENCHMARK_FRAMES = 120;
+    constexpr array<uint32_t, 5> DESCRIPTOR_BENCHMARK_COUNTS = {10, 100, 1'000, 10'000, 100'000};
+    constexpr uint32_t RESIZE_BENCHMARK_ITERATIONS = 20;
+    constexpr uint32_t RECORDING_BENCHMARK_DRAWS = 50'000;
+    constexpr uint32_t RENDER_QUEUE_BENCHMARK_PACKETS = 100'000;
+    constexpr uint32_t STAGE_BENCHMARK_INSTANCES = 10'000;
+    constexpr auto MIPMAP_BENCHMARK_TEXTURE = FilePaths::PAINTED_PLASTER_DIFFUSE;
+    constexpr array<uint32_t, 3> DOWNSAMPLER_BENCHMARK_SIZES = {1024, 4096, 8192};
+    constexpr uint32_t DOWNSAMPLER_BENCHMARK_ITERATIONS = 10;
+    constexpr uint32_t RESIDENCY_BENCHMARK_FRAMES = 120;
+    constexpr array RESIDENCY_BENCHMARK_TEXTURES = {
+        FilePaths::FACE_TEXTURE,
+        FilePaths::VIKING_ROOM_TEXTURE,
+        FilePaths::CHALET_TEXTURE,
+        FilePaths::PAINTED_PLASTER_DIFFUSE,
+        FilePaths::PAINTED_PLASTER_NORMAL,
+        FilePaths::METAL_DIFFUSE,
+        FilePaths::METAL_NORMAL};
+    // Vertex and index buffers of the loaded meshes, repeated until there are this many uploads
+    constexpr uint32_t STAGING_BENCHMARK_ASSETS = 400;
+    constexpr uint32_t FRAME_SYNC_BENCHMARK_INSTANCES = 10'000;
+    // Frames rendered before the heap allocations of the frame loop get counted, and how many are counted
+    constexpr uint32_t FRAME_ALLOCATION_WARMUP_FRAMES = 60;
+    constexpr uint32_t FRAME_ALLOCATION_CHECK_FRAMES = 300;
+    constexpr uint32_t VIRTUAL_TEXTURE_BENCHMARK_FRAMES = 240;
+    constexpr uint32_t VIRTUAL_TEXTURE_BENCHMARK_INSTANCES = 400;
+    constexpr array VIRTUAL_TEXTURE_BENCHMARK_TEXTURES = {
+        FilePaths::CHALET_TEXTURE,
+        FilePaths::PAINTED_PLASTER_DIFFUSE,
+        FilePaths::METAL_DIFFUSE,
+        FilePaths::VIKING_ROOM_TEXTURE};
 
     constexpr vec3 CAMERA_EYE(2.0f, 4.0f, 2.0f);
     constexpr vec3 CAMERA_CENTER(0.0f, 0.0f, 0.0f);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Constants.h"
+#include "engine/threadPool.h"
+
+// CPU encoders for the BC formats textures get cooked into. Every block is fitted along the principal axis of its
+// pixels and then indexed exhaustively, fast enough to run at load time and far from what offline encoders reach.
+namespace BlockCompression {
+    // BC1 and BC4 style blocks take 8 bytes, the others 16
+    [[nodiscard]] DEF getBlockSize(VkFormat format) -> VkDeviceSize;
+    [[nodiscard]] DEF getCompressedSize(VkFormat format, uint32_t width, uint32_t height) -> VkDeviceSize;
+    [[nodiscard]] DEF isSupported(VkFormat format) -> bool;
+
+    // Opaque RGB, alpha is ignored
+    DEF encodeBC1(const array<uint8_t, 64> &rgba, std::byte *block) -> void;
+    // BC1 color with a separate BC4 block for alpha
+    DEF encodeBC3(const array<uint8_t, 64> &rgba, std::byte *block) -> void;
+    // Two BC4 blocks for red and green, meant for tangent space normals
+    DEF encodeBC5(const array<uint8_t, 64> &rgba, std::byte *block) -> void;
+    // Only mode 6, a single RGBA subset with 7 bit endpoints, a p-bit each and 4 bit indices
+    DEF encodeBC7(const array<uint8_t, 64> &rgba, std::byte *block) -> void;
+
+    // Encodes a tightly packed RGBA8 image, rows of blocks are spread over the thread pool. Waits for the workers,
+    // so it mustn't be called from a task running on the same pool.
+    DEF compress(VkFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, std::byte *output, ThreadPool &threadPool) -> void;
+} // namespace BlockCompression
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Constants.h"
+
+class Engine; // Forward declaration of Engine class to avoid circular dependency
+
+// Generates mip chains with the compute shader in shaders/downsample.comp instead of a chain of blits. One dispatch
+// covers up to 12 levels, workgroups reduce 64x64 tiles in shared memory and the last one to finish, found through an
+// atomic counter, reduces the tiles' results further. Sources above 4096 texels take one extra dispatch.
+//
+// Works on any image whose format supports storage images and that was created with STORAGE and SAMPLED usage, e.g.
+// render targets that get sampled with mips afterwards. sRGB formats can't be storage images, those keep the blits.
+class Downsampler {
+public:
+    Downsampler(Engine *engine, VkShaderModule shaderModule, VkPipelineCache pipelineCache);
+    ~Downsampler();
+
+    Downsampler(const Downsampler &) = delete;
+    Downsampler &operator=(const Downsampler &) = delete;
+    Downsampler(Downsampler &&) = delete;
+    Downsampler &operator=(Downsampler &&) = delete;
+
+    [[nodiscard]] DEF isFormatSupported(VkFormat format) const -> bool;
+
+    // Records levels 1 to mipLevels - 1 from level 0, which has to be in baseLayout with its writes done by the time
+    // the barrier in front of the dispatches runs. The other levels' contents are discarded. Leaves every level in
+    // SHADER_READ_ONLY_OPTIMAL and returns how many dispatches it took.
+    DEF record(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkFormat format,
+        uint32_t width,
+        uint32_t height,
+        uint32_t mipLevels,
+        VkImageLayout baseLayout) -> uint32_t;
+
+    // Destroys the views and descriptor sets of everything recorded so far, every command buffer that recorded
+    // since the last reset has to be done executing
+    DEF reset() -> void;
+
+private:
+    // Per record call, needed until its command buffer has executed
+    struct Resources {
+        VkDescriptorPool descriptorPool;
+        vector<VkImageView> views;
+    };
+
+    DEF createImageView(VkImage image, VkFormat format, uint32_t level) const -> VkImageView;
+
+    Engine *m_Engine;
+    VkDevice m_Device;
+    VkPhysicalDevice m_PhysicalDevice;
+
+    VkDescriptorSetLayout m_DescriptorSetLayout;
+    VkPipelineLayout m_PipelineLayout;
+    VkPipeline m_Pipeline;
+    VkSampler m_Sampler;
+
+    // The atomic counter followed by the texels every workgroup hands to the last one
+    VkBuffer m_TailBuffer;
+    VkDeviceMemory m_TailBufferMemory;
+
+    vector<Resources> m_Pending;
+};
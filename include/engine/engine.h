@@ -1,7 +1,20 @@
 #pragma once
 
 #include "Constants.h"
+#include "engine/downsampler.h"
+#include "engine/frameAllocator.h"
+#include "engine/frameArena.h"
+#include "engine/memoryTracker.h"
 #include "engine/model.h"
+#include "engine/pipelineLibrary.h"
+#include "engine/renderQueue.h"
+#include "engine/shaderBundle.h"
+#include "engine/stagingPool.h"
+#include "engine/textureLoader.h"
+#include "engine/textureManager.h"
+#include "engine/threadPool.h"
+#include "engine/virtualTextureCache.h"
+#include "engine/vulkanObjectCache.h"
 
 DEF CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkDebugUtilsMessengerEXT *pDebugMessenger) -> VkResult;
 DEF DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks *pAllocator) -> void;
@@ -26,6 +39,11 @@ public:
 
     [[nodiscard]] DEF getWindow() const -> GLFWwindow * { return m_Window; };
     [[nodiscard]] DEF getDevice() const -> VkDevice { return m_Device; };
+    [[nodiscard]] DEF getPhysicalDevice() const -> VkPhysicalDevice { return m_PhysicalDevice; };
+    // Transient per-frame GPU memory, everything allocated from it is reclaimed once the frame's fence signalled
+    [[nodiscard]] DEF getFrameAllocator() const -> FrameAllocator * { return m_FrameAllocator.get(); }
+    // Transient host memory, everything allocated from it is reclaimed at the start of the next frame
+    [[nodiscard]] DEF getFrameArena() -> FrameArena & { return m_FrameArena; }
 
     DEF setCameraPosition(vec3 position) -> void;
     DEF moveCamera(vec3 direction) -> void;
@@ -37,13 +55,48 @@ public:
     [[nodiscard]] DEF getCameraLookDirection() const -> vec3;
 
     [[nodiscard]] DEF getPipelineLayout() const -> VkPipelineLayout { return m_PipelineLayout; }
-    [[nodiscard]] DEF getDescriptorSets() const -> vector<VkDescriptorSet> { return m_DescriptorSets; }
+    // Shared samplers, descriptor set layouts, pipeline layouts and render passes, owned by the cache
+    [[nodiscard]] DEF getObjectCache() const -> VulkanObjectCache * { return m_ObjectCache.get(); }
+    [[nodiscard]] DEF getDescriptorSet() const -> VkDescriptorSet { return m_DescriptorSet; }
     [[nodiscard]] DEF getCurrentFrameIdx() const -> uint32_t { return m_CurrentFrameIdx; }
 
+    // Frames are numbered by submission starting at 1, the timeline semaphore reaches N once the GPU finished frame N.
+    // The number of the frame being built, what it submits counts as done once isFrameComplete of it returns true.
+    [[nodiscard]] DEF getFrameNumber() const -> uint64_t { return m_FrameCounter + 1; }
+    // Cheap, only asks the driver while the answer isn't known to be yes already
+    [[nodiscard]] DEF isFrameComplete(uint64_t frame) -> bool;
+    DEF waitForFrame(uint64_t frame) -> void;
+
+    // Between 1 and Settings::MAX_FRAMES_IN_FLIGHT, waits for the device and recreates the swap chain when it changes
+    DEF setFramesInFlight(uint32_t framesInFlight) -> void;
+    [[nodiscard]] DEF getFramesInFlight() const -> uint32_t { return m_FramesInFlight; }
+    // Waits for the frame on the timeline semaphore instead of its fence, the semaphore gets signalled either way
+    DEF setTimelineSemaphoreWaits(bool useTimelineSemaphore) -> void;
+    [[nodiscard]] DEF getTimelineSemaphoreWaits() const -> bool { return m_UseTimelineSemaphore; }
+    // How long the CPU blocked on the GPU at the start of the last frame
+    [[nodiscard]] DEF getLastFrameWaitMs() const -> double { return m_LastFrameWaitMs; }
+
     DEF takeScreenshot() -> void { m_TakeScreenshotNextFrame = true; }
 
-    DEF createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory) const -> void;
+    // The memory of both is recorded by the memory tracker under the category, release it with freeMemory
+    DEF createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory, MemoryCategory category) const -> void;
     DEF copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const -> void;
+    DEF createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory, MemoryCategory category) -> void;
+    DEF freeMemory(VkDeviceMemory memory) const -> void;
+    // Copies the data into the buffer through a pooled staging buffer and waits for the copy
+    DEF uploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size) const -> void;
+    // Recycled staging buffers for uploads and readbacks
+    [[nodiscard]] DEF getStagingPool() const -> StagingPool * { return m_StagingPool.get(); }
+    // Device memory usage by category, heap and memory type
+    [[nodiscard]] DEF getMemoryTracker() const -> MemoryTracker * { return m_MemoryTracker.get(); }
+    DEF createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) const -> VkImageView;
+    // Submits on the graphics queue and waits for it to go idle
+    DEF beginSingleTimeCommands() const -> VkCommandBuffer;
+    DEF endSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void;
+    // Submits without waiting. Ahead of the frame being built in submission order, so the commands are done once
+    // isFrameComplete of getFrameNumber returns true, only then may the command buffer be freed.
+    DEF submitSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void;
+    DEF freeSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void;
 
     vec3 m_CameraEye;
     vec3 m_CameraCenter;
@@ -52,14 +105,119 @@ public:
     [[nodiscard]] DEF getSwapchainExtent() const -> VkExtent2D { return m_SwapChainExtent; }
     [[nodiscard]] DEF getNumModels() const -> size_t { return m_Models.size(); }
 
-    DEF getUniformBuffersMapped() -> vector<void*> { return m_UniformBuffersMapped; }
-
-    DEF setStage(const int stage) -> void { m_Stage = stage; }
+    // Switches to the pipeline specialized for that stage, out of range stages are ignored
+    DEF setStage(int stage) -> void;
     DEF getStage() const -> int { return m_Stage; }
 
     DEF update(float frameTime) const -> void;
 
+    // Meshes are cached by filepath, so every model using the same file shares vertex and index buffers.
+    DEF acquireMesh(const char *meshFilepath) -> std::shared_ptr<MeshNT>;
+
+    // Acquires the texture from the texture manager and waits for it to load, models refer to it by the returned slot.
+    DEF registerTexture(const char *textureFilepath, TextureUsage usage = TextureUsage::Color) -> uint32_t;
+    // Decodes the textures in parallel and uploads them in a single submission, returns their slots in the same order
+    DEF registerTextures(std::span<const char *const> textureFilepaths, TextureUsage usage = TextureUsage::Color) -> vector<uint32_t>;
+
+    // Stays disabled on devices without textureCompressionBC, only affects textures loaded afterwards
+    DEF setTextureCompression(bool compressTextures) -> void;
+    [[nodiscard]] DEF getTextureCompression() const -> bool { return m_CompressTextures; }
+
+    // RGBA8 textures get their mips from the CPU instead of GPU blits, forced on for formats without linear blit support
+    DEF setCpuMipmaps(const bool cpuMipmaps) -> void { m_CpuMipmaps = cpuMipmaps; }
+    [[nodiscard]] DEF getCpuMipmaps() const -> bool { return m_CpuMipmaps; }
+    // Slots that hold a texture, valid material IDs aren't a contiguous range once textures got evicted
+    [[nodiscard]] DEF getTextureSlots() const -> const vector<uint32_t> & { return m_TextureManager->getOccupiedSlots(); }
+    // Owns every texture in the bindless texture table and keeps them within the VRAM budget
+    [[nodiscard]] DEF getTextureManager() const -> TextureManager * { return m_TextureManager.get(); }
+    // Returns the material ID of the new virtual texture, see VirtualTextureCache::registerTexture
+    DEF registerVirtualTexture(const char *textureFilepath) -> uint32_t { return m_VirtualTextures->registerTexture(textureFilepath); }
+    [[nodiscard]] DEF getVirtualTextureCache() const -> VirtualTextureCache * { return m_VirtualTextures.get(); }
+    [[nodiscard]] DEF getThreadPool() const -> ThreadPool * { return m_ThreadPool.get(); }
+    // Decoding, mip generation and block compression, kept off the pool command recording waits for every frame
+    [[nodiscard]] DEF getTexturePool() const -> ThreadPool * { return m_TexturePool.get(); }
+
+    // Decodes the textures into a new staging buffer on the texture pool, safe to call from any thread
+    DEF stageTextures(std::span<const char *const> textureFilepaths, TextureUsage usage, bool compress, bool cpuMipmaps) const -> StagedTextures;
+    // Uploads staged textures in a single submission and frees the staging buffer, main thread only. The textures end
+    // up in SHADER_READ_ONLY, but not in the texture table.
+    DEF uploadTextures(StagedTextures &staged, vector<double> &uploadMs) -> vector<Texture>;
+    // Creates the textures and records their upload without submitting it, the staging buffer has to stay alive until
+    // the commands are done. Writes a timestamp before and after every texture when given a pool.
+    DEF recordTextureUploads(VkCommandBuffer commandBuffer, const StagedTextures &staged, VkQueryPool timestampPool) -> vector<Texture>;
+    DEF destroyTexture(const Texture &texture) const -> void;
+
+    // Compute mip generation for images created at runtime, null if the device can't write storage images without a
+    // format. Whoever records with it calls reset once those command buffers have executed.
+    [[nodiscard]] DEF getDownsampler() const -> Downsampler * { return m_Downsampler.get(); }
+    // Records the downsampler into a submission of its own and waits for it, see Downsampler::record for the requirements.
+    // Resets the downsampler afterwards, so it mustn't run while another command buffer is recording with it.
+    DEF generateMipmapsCompute(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, VkImageLayout baseLayout) -> void;
+
+    DEF setInstancing(const bool useInstancing) -> void { m_UseInstancing = useInstancing; }
+    [[nodiscard]] DEF getInstancing() const -> bool { return m_UseInstancing; }
+
+    // Stays disabled on devices without drawIndirectFirstInstance, the object index travels in firstInstance
+    DEF setIndirectDraws(bool useIndirectDraws) -> void;
+    [[nodiscard]] DEF getIndirectDraws() const -> bool { return m_UseIndirectDraws; }
+
+    // Upper bound of worker threads recording secondary command buffers, clamped to the size of the thread pool
+    DEF setRecordingThreadCount(uint32_t threadCount) -> void;
+    [[nodiscard]] DEF getRecordingThreadCount() const -> uint32_t { return m_RecordingThreadCount; }
+
+    // Reuse recorded command buffers until something they bake in changes, per-frame data only changes buffer contents
+    DEF setCommandBufferCaching(const bool cacheCommandBuffers) -> void { m_CacheCommandBuffers = cacheCommandBuffers; }
+    [[nodiscard]] DEF getCommandBufferCaching() const -> bool { return m_CacheCommandBuffers; }
+
+    [[nodiscard]] DEF getRecordingStats() const -> const RecordingStats & { return m_RecordingStats; }
+
+    DEF runBenchmarks() -> void;
+
 private:
+    // A run of sorted instances sharing the same mesh, stored contiguously in the object buffer.
+    struct DrawBatch {
+        MeshNT *mesh;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+        uint32_t firstCommand; // Of the batch's draws in the indirect command buffer, if indirect draws are used
+    };
+
+    // Replaced by a recreation, destroyed once the first frame on its successor completed
+    struct RetiredSwapChain {
+        VkSwapchainKHR swapChain;
+        uint64_t frame;
+    };
+
+    // One per worker thread, frame in flight and swap chain image
+    struct RecordingContext {
+        VkCommandPool commandPool;
+        VkCommandBuffer commandBuffer; // Secondary, executed inside the render pass of the frame's primary buffer
+    };
+
+    // Everything a recorded command buffer depends on besides the contents of the buffers it reads
+    struct RecordingKey {
+        VkPipeline pipeline;
+        VkFramebuffer framebuffer;
+        uint32_t extentWidth;
+        uint32_t extentHeight;
+        int stage;
+        bool useInstancing;
+        bool useIndirectDraws;
+        array<uint32_t, 2> dynamicOffsets;
+        VkDeviceSize indirectOffset;
+        uint64_t batchLayoutHash;
+
+        bool operator==(const RecordingKey &) const = default;
+    };
+
+    struct CachedCommandBuffer {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        RecordingKey key{};
+        bool valid = false;
+        bool usesSecondaryCommandBuffers = false;
+        RecordingStats stats{};
+    };
+
     DEF
     initWindow() -> void;
     DEF initVulkan() -> void;
@@ -74,40 +232,96 @@ private:
     DEF findQueueFamilies(VkPhysicalDevice device) const -> QueueFamilyIndices;
     DEF querySwapChainSupport(VkPhysicalDevice device) const -> SwapChainSupportDetails;
     DEF createLogicalDevice() -> void;
+    DEF createMemoryTracker() -> void;
+    DEF createObjectCache() -> void;
+    DEF createStagingPool() -> void;
     DEF createSwapChain() -> void;
     DEF createRenderPass() -> void;
     DEF createDescriptorSetLayout() -> void;
+    DEF createPipelineCache() -> void;
+    DEF savePipelineCache() const -> void;
+    [[nodiscard]] DEF isPipelineCacheCompatible(const vector<char> &data) const -> bool;
+    DEF createPipelineLayout() -> void;
     DEF createGraphicsPipeline() -> void;
+    [[nodiscard]] DEF createStagePipeline(int stage) const -> VkPipeline;
+    DEF destroyGraphicsPipelines() -> void;
     DEF createFramebuffers() -> void;
     DEF createCommandPool() -> void;
     DEF createSyncObjects() -> void;
-    DEF createUniformBuffers() -> void;
+    DEF createFrameAllocator() -> void;
     DEF createDescriptorPool() -> void;
     DEF createDescriptorSets() -> void;
-    DEF generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) -> void;
-    DEF createTextureImage() -> void;
-    DEF createTextureImageView() -> void;
+    // Records the blit chain, the fallback for mips that weren't generated on the CPU. Expects every level in
+    // TRANSFER_DST and leaves them all in SHADER_READ_ONLY.
+    DEF generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) const -> void;
+    DEF createTextureTable() -> void;
+    DEF createDownsampler() -> void;
+    DEF createTextureManager() -> void;
+    DEF createVirtualTextureCache() -> void;
+    // Stages and uploads the textures right away, bypassing the texture manager, and prints how long that took
+    DEF loadTextures(std::span<const char *const> textureFilepaths, TextureUsage usage) -> vector<Texture>;
+    // Copies one mip level of an RGBA8 texture back to the host, the texture has to be in SHADER_READ_ONLY
+    DEF readTextureLevel(const Texture &texture, uint32_t level, uint32_t width, uint32_t height) const -> vector<uint8_t>;
     DEF createTextureSampler() -> void;
     DEF createColorResources() -> void;
     DEF getMaxUsableSampleCount() const -> VkSampleCountFlagBits;
     DEF createCommandBuffers() -> void;
-    DEF copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) const -> void;
+    DEF createThreadPool() -> void;
+    DEF createRecordingContexts() -> void;
+    // Creates the contexts of an image the first time it's recorded for
+    DEF getRecordingContexts(uint32_t frameIdx, uint32_t imageIndex) -> vector<RecordingContext> &;
     DEF transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) const -> void;
+    // Every retired swap chain whose frame completed, or all of them once the device is idle
+    DEF destroyRetiredSwapChains(bool all) -> void;
     DEF recreateSwapChain() -> void;
     DEF cleanupSwapChain() -> void;
-    DEF beginSingleTimeCommands() const -> VkCommandBuffer;
-    DEF endSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void;
     DEF createImageViews() -> void;
-    DEF createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) const -> VkImageView;
-    DEF createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory) -> void;
-    DEF createShaderModule(const vector<char> &code) const -> VkShaderModule;
+    DEF createShaderModule(std::span<const std::byte> code) const -> VkShaderModule;
+    DEF loadShaderBundle() -> void;
+    // Cached by path, taken from the shader bundle if there is one and read from the loose file otherwise
+    DEF getShaderModule(const char *shaderFilepath) -> VkShaderModule;
     DEF findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const -> uint32_t;
     DEF chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) const -> VkExtent2D;
-    DEF recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex) -> void;
+    // Returns how many threads recorded the draws, 1 means they were recorded inline
+    DEF recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex, RecordingStats &stats) -> uint32_t;
+    DEF acquireCommandBuffer(uint32_t imageIndex) -> VkCommandBuffer;
+    [[nodiscard]] DEF hashDrawBatches() const -> uint64_t;
+    DEF printCommandBufferCacheStats() const -> void;
     DEF findSupportedFormat(const vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) -> VkFormat;
     DEF createDepthResources() -> void;
     DEF findDepthFormat() -> VkFormat;
-    DEF updatePushConstants() -> void;
+    DEF updateCameraUniforms() -> TransientAllocation;
+    DEF buildDrawBatches() -> TransientAllocation;
+    DEF writeIndirectCommands() -> void;
+    DEF recordSecondaryCommandBuffers(uint32_t imageIndex, uint32_t drawCount, uint32_t threadCount) -> RecordingStats;
+    DEF recordSecondaryCommandBuffer(const RecordingContext &context, uint32_t imageIndex, uint32_t firstDraw, uint32_t drawCount, RecordingStats &stats) const -> void;
+    DEF bindFrameState(VkCommandBuffer commandBuffer, RecordingStats &stats) const -> void;
+    [[nodiscard]] DEF getDrawCount() const -> uint32_t;
+    DEF recordDrawRange(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) const -> RecordingStats;
+    DEF enqueueDrawBatch(VkCommandBuffer commandBuffer, const DrawBatch &batch, uint32_t firstDraw, uint32_t drawCount, const MeshNT *&boundMesh, RecordingStats &stats) const -> void;
+
+    // Puts the sphere grid in place of the scene for a benchmark and restores every setting afterwards, see benchmark.cpp
+    class BenchmarkScene;
+
+    DEF benchmarkInstancing() -> void;
+    DEF benchmarkDescriptors() -> void;
+    DEF benchmarkResize() -> void;
+    DEF benchmarkObjectCache() -> void;
+    DEF benchmarkStagingPool() -> void;
+    DEF benchmarkRecording() -> void;
+    DEF benchmarkCommandBufferCache() -> void;
+    DEF benchmarkRenderQueue() -> void;
+    DEF benchmarkIndirectDraws() -> void;
+    DEF benchmarkStages() -> void;
+    DEF benchmarkTextureLoading() -> void;
+    DEF benchmarkMipmaps() -> void;
+    DEF benchmarkDownsampler() -> void;
+    DEF benchmarkTextureResidency() -> void;
+    DEF benchmarkVirtualTexturing() -> void;
+    // Counts heap allocations over a stretch of warmed up frames, the frame loop shouldn't make any
+    DEF benchmarkFrameAllocations() -> void;
+    // CPU time blocked at the start of a frame at every depth of frames in flight, waiting on fences or the timeline
+    DEF benchmarkFrameSync() -> void;
 
     static DEF getRequiredExtensions() -> vector<const char *>;
     static DEF checkValidationLayerSupport() -> bool;
@@ -131,40 +345,85 @@ private:
     VkSurfaceKHR m_Surface;
 
     VkSwapchainKHR m_SwapChain;
+    vector<RetiredSwapChain> m_RetiredSwapChains;
     vector<VkImage> m_SwapChainImages;
     vector<VkImageView> m_SwapChainImageViews;
     VkFormat m_SwapChainImageFormat;
     VkExtent2D m_SwapChainExtent;
     vector<VkFramebuffer> m_SwapChainFramebuffers;
 
+    std::unique_ptr<MemoryTracker> m_MemoryTracker;
+    bool m_SupportsMemoryBudget; // VK_EXT_memory_budget, enabled when available
+    std::unique_ptr<StagingPool> m_StagingPool;
+
+    // Render pass, pipeline layout, descriptor set layouts and the texture sampler all come from this cache
+    std::unique_ptr<VulkanObjectCache> m_ObjectCache;
     VkRenderPass m_RenderPass;
     VkDescriptorSetLayout m_DescriptorSetLayout;
     VkPipelineLayout m_PipelineLayout;
-    VkPipeline m_GraphicsPipeline;
+    VkPipeline m_GraphicsPipeline; // Of m_Stage if it's compiled already, otherwise the fallback, see drawFrame
+    std::unique_ptr<PipelineLibrary> m_PipelineLibrary;
+    VkShaderModule m_StageVertShaderModule;
+    VkShaderModule m_StageFragShaderModule;
+    std::unique_ptr<ShaderBundle> m_ShaderBundle;
+    unordered_map<string, VkShaderModule> m_ShaderModules;
+    VkPipelineCache m_PipelineCache; // Shared by every pipeline creation, persisted in FilePaths::PIPELINE_CACHE
+    bool m_PipelineCacheWarm;        // Whether the cache got seeded with valid data from disk
 
     VkCommandPool m_CommandPool;
     vector<VkCommandBuffer> m_CommandBuffers;
 
+    std::unique_ptr<ThreadPool> m_ThreadPool;
+    std::unique_ptr<ThreadPool> m_TexturePool;
+    vector<vector<vector<RecordingContext>>> m_RecordingContexts; // [frame in flight][swap chain image][thread]
+    uint32_t m_RecordingThreadCount;
+
+    bool m_CacheCommandBuffers;
+    vector<vector<CachedCommandBuffer>> m_CachedCommandBuffers; // [frame in flight][swap chain image]
+    uint64_t m_CachedFrameCount;
+    uint64_t m_RecordedFrameCount;
+    double m_RecordTotalMs; // Spent re-recording, cache hits excluded
+
     vector<VkSemaphore> m_ImageAvailableSemaphores;
     vector<VkSemaphore> m_RenderFinishedSemaphores;
     vector<VkFence> m_InFlightFences;
-
-    uint32_t m_CurrentFrameIdx; // 0 <= m_CurrentFrameIdx < Max Frames in Flight
-    uint32_t m_FrameCounter;    // How many frames have been rendered in total
+    VkSemaphore m_FrameTimeline; // Signalled with the frame number by every frame's submission
+    array<uint64_t, Settings::MAX_FRAMES_IN_FLIGHT> m_FrameIdxFrames; // The frame that last submitted from each index
+    uint64_t m_CompletedFrame; // Known to be complete, the timeline may already be past it
+    uint32_t m_FramesInFlight;
+    bool m_UseTimelineSemaphore;
+    double m_LastFrameWaitMs;
+
+    uint32_t m_CurrentFrameIdx; // 0 <= m_CurrentFrameIdx < m_FramesInFlight
+    uint64_t m_FrameCounter;    // How many frames have been submitted in total, the number of the last one
     bool m_FramebufferResized;
 
-    vector<VkBuffer> m_UniformBuffers;
-    vector<VkDeviceMemory> m_UniformBuffersMemory;
-    vector<void *> m_UniformBuffersMapped;
+    // Holds the camera UBO and the ObjectData of every drawn instance, among other per-frame data
+    std::unique_ptr<FrameAllocator> m_FrameAllocator;
+    // Host side counterpart, for scratch data of the frame loop that would otherwise go through the heap
+    FrameArena m_FrameArena;
 
     VkDescriptorPool m_DescriptorPool;
-    vector<VkDescriptorSet> m_DescriptorSets;
-
-    uint32_t m_MipLevels;
-    VkImage m_TextureImage;
-    VkDeviceMemory m_TextureImageMemory;
-    VkImageView m_TextureImageView;
-    VkSampler m_TextureSampler;
+    VkDescriptorSet m_DescriptorSet;
+    array<uint32_t, 2> m_DynamicOffsets; // Camera and object buffer offsets of the frame being recorded
+
+    // Bindless texture table in set 1, a partially bound array that textures get registered into at runtime.
+    // It lives in its own update-after-bind pool, which dynamic buffer descriptors aren't allowed in. One per frame in
+    // flight, so the texture manager can rewrite a frame's table while the others are still pending.
+    VkDescriptorSetLayout m_TextureTableLayout;
+    VkDescriptorPool m_TextureTablePool;
+    array<VkDescriptorSet, Settings::MAX_FRAMES_IN_FLIGHT> m_TextureTables;
+    uint32_t m_TextureTableCapacity;
+    std::unique_ptr<TextureManager> m_TextureManager;
+    VkSampler m_TextureSampler; // Shared by every texture in the table
+    // Virtual textures in set 2, with one descriptor set per frame in flight owned by the cache
+    VkDescriptorSetLayout m_VirtualTextureLayout;
+    std::unique_ptr<VirtualTextureCache> m_VirtualTextures;
+    bool m_CompressTextures;
+    bool m_SupportsTextureCompression;
+    bool m_CpuMipmaps;
+    std::unique_ptr<Downsampler> m_Downsampler;
+    bool m_SupportsComputeMipmaps;
 
     VkSampleCountFlagBits m_MSAASamples;
 
@@ -182,10 +441,25 @@ private:
     uint32_t m_ApplicationVersion;
 
     vector<std::unique_ptr<ModelNT>> m_Models;
+    unordered_map<string, std::shared_ptr<MeshNT>> m_MeshCache;
+
+    bool m_UseInstancing;
+    bool m_UseIndirectDraws;
+    bool m_SupportsIndirectDraws;
+    bool m_SupportsMultiDrawIndirect;
+    uint32_t m_MaxDrawIndirectCount;
+    TransientAllocation m_IndirectCommands; // One VkDrawIndexedIndirectCommand per draw, in draw order
+    vector<DrawBatch> m_DrawBatches;
+    RenderQueue m_RenderQueue;
+    RecordingStats m_RecordingStats; // Of the command buffer submitted last, whether recorded or taken from the cache
+
+    // When non-zero the scene is replaced by a grid of that many spheres, used by the benchmarks.
+    uint32_t m_BenchmarkInstanceCount;
+    vector<uint32_t> m_BenchmarkMaterials; // Cycled through by the grid, every loaded texture if empty
+    MeshNT *m_BenchmarkMesh;
+    double m_LastRecordTimeMs;
 
     int m_Stage;
 
-    PushConstants m_PushConstants;
-
     std::chrono::time_point<std::chrono::high_resolution_clock> m_StartTime;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Constants.h"
+
+// A slice of the frame allocator's buffer, only valid until the same frame index comes around again.
+struct TransientAllocation {
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void *mapped;
+};
+
+class Engine; // Forward declaration of Engine class to avoid circular dependency
+
+// Linear allocator over one persistently mapped, host-visible buffer, split into one region per frame in flight.
+// Anything that only lives for a single frame (uniforms, per-object data, dynamic vertices, indirect arguments)
+// bump-allocates from the current frame's region, everything gets reclaimed at once by beginFrame, which must only
+// be called after the fence of that frame has signalled.
+//
+// Dynamic descriptors have a fixed range that must stay inside the buffer for every dynamic offset, so the buffer
+// carries a tail of maxBindingRange bytes past the last region.
+class FrameAllocator {
+public:
+    FrameAllocator(Engine *engine, VkDeviceSize frameCapacity, VkDeviceSize maxBindingRange);
+    ~FrameAllocator();
+
+    FrameAllocator(const FrameAllocator &) = delete;
+    FrameAllocator &operator=(const FrameAllocator &) = delete;
+    FrameAllocator(FrameAllocator &&) = delete;
+    FrameAllocator &operator=(FrameAllocator &&) = delete;
+
+    DEF beginFrame(uint32_t frameIdx) -> void;
+
+    [[nodiscard]] DEF allocate(VkDeviceSize size, VkDeviceSize alignment) -> TransientAllocation;
+    [[nodiscard]] DEF allocateUniform(const VkDeviceSize size) -> TransientAllocation { return allocate(size, m_MinUniformAlignment); }
+    [[nodiscard]] DEF allocateStorage(const VkDeviceSize size) -> TransientAllocation { return allocate(size, m_MinStorageAlignment); }
+
+    [[nodiscard]] DEF getBuffer() const -> VkBuffer { return m_Buffer; }
+    [[nodiscard]] DEF getFrameCapacity() const -> VkDeviceSize { return m_FrameCapacity; }
+    [[nodiscard]] DEF getFrameUsage() const -> VkDeviceSize { return m_Head; }
+    // Largest number of bytes any single frame has used so far
+    [[nodiscard]] DEF getHighWaterMark() const -> VkDeviceSize { return m_HighWaterMark; }
+
+    DEF printStats() const -> void;
+
+private:
+    Engine *m_Engine;
+    VkDevice m_Device;
+
+    VkBuffer m_Buffer;
+    VkDeviceMemory m_Memory;
+    std::byte *m_Mapped;
+
+    VkDeviceSize m_FrameCapacity;
+    VkDeviceSize m_MinUniformAlignment;
+    VkDeviceSize m_MinStorageAlignment;
+
+    uint32_t m_FrameIdx;
+    VkDeviceSize m_Head; // Offset relative to the start of the current frame's region
+
+    VkDeviceSize m_HighWaterMark;
+    uint64_t m_AllocationCount;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Constants.h"
+
+// Linear allocator for transient host data of a single frame, like the scene gathered for sorting or the list of
+// command buffers to submit. Allocations bump a pointer and are never freed individually, reset reclaims all of them
+// at once at the start of the next frame. Only types without destructors can live in it.
+//
+// A frame that runs out of space gets an extra block instead of failing, and the next reset replaces all blocks with a
+// single one large enough for that frame, so once the arena has grown to the largest frame it never allocates again.
+// Not thread safe, it belongs to the thread running the frame loop.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity);
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+    FrameArena(FrameArena &&) = delete;
+    FrameArena &operator=(FrameArena &&) = delete;
+
+    // Invalidates everything allocated since the last reset
+    DEF reset() -> void;
+
+    [[nodiscard]] DEF allocate(size_t size, size_t alignment) -> void *;
+    // Default initialized, like `new T[count]` would be
+    template <typename T>
+    [[nodiscard]] DEF allocateArray(const size_t count) -> std::span<T> {
+        static_assert(std::is_trivially_destructible_v<T>, "The frame arena never runs destructors!");
+        T *data = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        std::uninitialized_default_construct_n(data, count);
+        return {data, count};
+    }
+
+    [[nodiscard]] DEF getCapacity() const -> size_t { return m_Capacity; }
+    [[nodiscard]] DEF getUsed() const -> size_t { return m_Used; }
+    // Largest number of bytes any single frame has used so far
+    [[nodiscard]] DEF getHighWaterMark() const -> size_t { return m_HighWaterMark; }
+    // Frames that didn't fit and made the arena grow
+    [[nodiscard]] DEF getOverflowCount() const -> uint64_t { return m_OverflowCount; }
+
+    DEF printStats() const -> void;
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    DEF addBlock(size_t size) -> void;
+
+    vector<Block> m_Blocks; // Only the last one is allocated from, the others are full
+    size_t m_Head; // Offset into the last block
+    size_t m_Capacity; // Of all blocks
+    size_t m_Used; // Since the last reset, including alignment padding
+
+    size_t m_HighWaterMark;
+    uint64_t m_OverflowCount;
+};
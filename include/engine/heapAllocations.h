@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Constants.h"
+
+// Counts every heap allocation of the process. The global operator new and delete are replaced in
+// heapAllocations.cpp, they still allocate through malloc but bump these counters on the way, so a stretch of code can
+// be checked for allocating by comparing the count before and after it. Counting is thread safe.
+namespace HeapAllocations {
+    // Allocations through operator new since startup, including those of the standard library
+    [[nodiscard]] DEF getCount() -> uint64_t;
+    [[nodiscard]] DEF getBytes() -> uint64_t;
+} // namespace HeapAllocations
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Constants.h"
+
+// Just enough of KTX 2.0 to cache cooked textures: single layer, single face 2D images with a full mip chain and no
+// supercompression. Files written here open in the Khronos tools, reading is limited to what we write ourselves.
+namespace Ktx2 {
+    struct Level {
+        uint64_t byteOffset; // From the start of the file
+        uint64_t byteLength;
+    };
+
+    struct Info {
+        VkFormat format;
+        uint32_t width;
+        uint32_t height;
+        vector<Level> levels; // levels[0] is the full resolution image
+        string sourceStamp;   // Identifies the source image the file was cooked from, see Ktx2::write
+    };
+
+    // Empty if the file doesn't exist or isn't a KTX2 file this reader understands
+    [[nodiscard]] DEF readInfo(const std::filesystem::path &filepath) -> optional<Info>;
+
+    // Levels start at full resolution. The stamp is stored in the key/value data and handed back by readInfo, so
+    // callers can tell a stale file apart. Written through a temporary file, returns false if that failed.
+    DEF write(
+        const std::filesystem::path &filepath,
+        VkFormat format,
+        uint32_t width,
+        uint32_t height,
+        std::span<const std::span<const std::byte>> levels,
+        const string &sourceStamp) -> bool;
+} // namespace Ktx2
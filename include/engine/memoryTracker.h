@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Constants.h"
+
+// What an allocation made through Engine::createBuffer or Engine::createImage is for
+enum class MemoryCategory : uint8_t {
+    Meshes,
+    Textures,
+    Uniforms,
+    Attachments,
+    Staging,
+    Other,
+    Count
+};
+
+// Device memory telemetry. Every allocation of the engine is recorded with its category and memory type, so usage can
+// be reported by category, heap and type, and allocations still alive at shutdown show up as leaks. With
+// VK_EXT_memory_budget the heaps are compared against the budget the driver reports, which includes other processes,
+// otherwise against the heap size and only what the engine allocated itself.
+//
+// update checks the thresholds of Settings::MEMORY_HEAP_WARNING_FRACTION and Settings::MEMORY_CATEGORY_WARNING_BYTES,
+// warning once per crossing, and appends a report to FilePaths::MEMORY_REPORT periodically. Recording is thread safe.
+class MemoryTracker {
+public:
+    struct Usage {
+        VkDeviceSize bytes;
+        VkDeviceSize peakBytes;
+        uint32_t allocations;
+    };
+
+    struct HeapBudget {
+        VkDeviceSize size;
+        VkDeviceSize budget; // The heap size without VK_EXT_memory_budget
+        VkDeviceSize usage; // Of every process with VK_EXT_memory_budget, otherwise only tracked allocations
+        VkDeviceSize tracked;
+    };
+    // Fixed size, so the periodic checks don't allocate, only the first getHeapCount are used
+    using HeapBudgets = array<HeapBudget, VK_MAX_MEMORY_HEAPS>;
+
+    MemoryTracker(VkPhysicalDevice physicalDevice, bool memoryBudget);
+
+    DEF onAllocate(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category) -> void;
+    // Null memory is ignored, like vkFreeMemory does
+    DEF onFree(VkDeviceMemory memory) -> void;
+
+    // Once per frame, checks thresholds and writes the periodic reports at their intervals
+    DEF update() -> void;
+
+    [[nodiscard]] DEF hasMemoryBudget() const -> bool { return m_HasMemoryBudget; }
+    [[nodiscard]] DEF getCategoryUsage(MemoryCategory category) const -> Usage;
+    [[nodiscard]] DEF getHeapCount() const -> uint32_t { return m_MemoryProperties.memoryHeapCount; }
+    // Queries the driver for the current budget of every heap
+    [[nodiscard]] DEF getHeapBudgets() const -> HeapBudgets;
+    [[nodiscard]] DEF getReport() const -> string;
+
+    DEF printReport() const -> void;
+    // Appends the report to the file, creating its directory if needed
+    DEF dumpReport(const char *filepath) const -> void;
+    // Allocations that were never freed, meant to be called right before the device is destroyed
+    DEF printLeaks() const -> void;
+
+    static DEF getCategoryName(MemoryCategory category) -> const char *;
+
+private:
+    struct Allocation {
+        VkDeviceSize size;
+        uint32_t memoryTypeIndex;
+        MemoryCategory category;
+    };
+
+    static DEF add(Usage &usage, VkDeviceSize size) -> void;
+    static DEF remove(Usage &usage, VkDeviceSize size) -> void;
+    DEF checkThresholds() -> void;
+
+    VkPhysicalDevice m_PhysicalDevice;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+    bool m_HasMemoryBudget;
+
+    mutable std::mutex m_Mutex;
+    unordered_map<VkDeviceMemory, Allocation> m_Allocations;
+    array<Usage, static_cast<size_t>(MemoryCategory::Count)> m_Categories;
+    vector<Usage> m_Types; // Indexed by memory type, heaps are the sums of their types
+
+    // Set while over the threshold, so each crossing warns once
+    vector<bool> m_HeapWarnings;
+    array<bool, static_cast<size_t>(MemoryCategory::Count)> m_CategoryWarnings;
+    uint64_t m_Frame;
+};
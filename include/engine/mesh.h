@@ -14,8 +14,20 @@ struct MeshNT {
     [[nodiscard]] DEF getVertexBufferMemory() const -> VkDeviceMemory;
     [[nodiscard]] DEF getVertexIndexBufferMemory() const -> VkDeviceMemory;
 
-    [[nodiscard]] DEF getVertices() const -> std::vector<VertexNT>;
-    [[nodiscard]] DEF getVertexIndices() const -> std::vector<uint32_t>;
+    // Views into the mesh's own CPU copy, valid as long as the mesh
+    [[nodiscard]] DEF getVertices() const -> std::span<const VertexNT>;
+    [[nodiscard]] DEF getVertexIndices() const -> std::span<const uint32_t>;
+    [[nodiscard]] DEF getIndexCount() const -> uint32_t { return static_cast<uint32_t>(m_VertexIndices.size()); }
+
+    // Binds vertex and index buffer and draws `instanceCount` instances, starting at `firstInstance` in the instance buffer.
+    DEF enqueueIntoCommandBuffer(VkCommandBuffer commandBuffer, uint32_t firstInstance, uint32_t instanceCount) const -> void;
+    // The two halves of enqueueIntoCommandBuffer, so consecutive draws of the same mesh can skip the binds
+    DEF bind(VkCommandBuffer commandBuffer) const -> void;
+    DEF draw(VkCommandBuffer commandBuffer, uint32_t firstInstance, uint32_t instanceCount) const -> void;
+
+    // Small dense ID handed out by Engine::acquireMesh, part of the render queue sort key
+    DEF setMeshID(const uint32_t meshID) -> void { m_MeshID = meshID; }
+    [[nodiscard]] DEF getMeshID() const -> uint32_t { return m_MeshID; }
 
     void loadModel();
     void createVertexBuffer();
@@ -35,6 +47,7 @@ private:
     VkDevice m_Device;
 
     const char *m_Filepath;
+    uint32_t m_MeshID;
 
     // GPU Memory
     VkBuffer m_VertexBuffer;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Constants.h"
+#include "engine/threadPool.h"
+
+// CPU mip chain generation for RGBA8 images, replacing the blit chain Engine::generateMipmaps records on the GPU.
+// Every level is a 2x2 box filter of the previous one, evaluated in linear space and kept in floats between levels, so
+// sRGB images don't darken and rounding doesn't accumulate down the chain.
+namespace MipGenerator {
+    // Levels 1 to mipLevels - 1 of a tightly packed RGBA8 image. Rows of every level are spread over the thread pool,
+    // so it waits for the workers and mustn't be called from a task running on the same pool.
+    [[nodiscard]] DEF generate(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t mipLevels, bool srgb, ThreadPool &threadPool) -> vector<vector<uint8_t>>;
+
+    // Averages the full footprint of every texel in the base level directly, the ideal box filtered level to compare against
+    [[nodiscard]] DEF reference(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t level, bool srgb) -> vector<uint8_t>;
+
+    // Peak signal to noise ratio over the color channels in dB, infinite for identical images
+    [[nodiscard]] DEF psnr(std::span<const uint8_t> image, std::span<const uint8_t> reference) -> double;
+} // namespace MipGenerator
@@ -22,8 +22,10 @@ public:
     DEF getMesh() const -> MeshNT *;
     [[nodiscard]] DEF getMatrix() const -> mat4 { return m_CurrentTransform.getMatrix(); }
 
-    DEF enqueueIntoCommandBuffer(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet) -> void;
-    [[nodiscard]] DEF getUBO() -> UniformBufferObject;
+    // Slot of the texture in the engine's bindless texture table, see Engine::registerTexture
+    DEF setMaterialID(const uint32_t materialID) -> void { m_MaterialID = materialID; }
+    [[nodiscard]] DEF getMaterialID() const -> uint32_t { return m_MaterialID; }
+
 
     DEF setRotationAnimationVector(const vec3 rotationAnimationVector) -> void { m_RotationAnimationVector = rotationAnimationVector; }
 
@@ -33,12 +35,13 @@ public:
 
 private:
     Engine *m_Engine;
-    std::unique_ptr<MeshNT> m_Mesh;
+    std::shared_ptr<MeshNT> m_Mesh; // Shared between all models using the same mesh file, see Engine::acquireMesh
     const char *m_MeshFilepath;
 
     Transform m_InitialTransform;
 
     uint32_t m_ModelID;
+    uint32_t m_MaterialID;
 
     vec3 m_RotationAnimationVector;
 };
\ No newline at end of file
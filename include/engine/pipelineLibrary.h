@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Constants.h"
+#include "engine/threadPool.h"
+
+// Compiles pipelines on background threads. Until a pipeline is done, acquire hands out the fallback pipeline, which
+// has to be compatible with everything requested (same layout and render pass). Finished pipelines only become
+// visible in beginFrame, so all draws of a frame see the same set of pipelines.
+class PipelineLibrary {
+public:
+    // Runs on a worker thread, must only touch state that stays unchanged until the library is cleared
+    using BuildFunction = std::function<VkPipeline()>;
+
+    PipelineLibrary(VkDevice device, uint32_t threadCount);
+    ~PipelineLibrary();
+
+    PipelineLibrary(const PipelineLibrary &) = delete;
+    PipelineLibrary &operator=(const PipelineLibrary &) = delete;
+    PipelineLibrary(PipelineLibrary &&) = delete;
+    PipelineLibrary &operator=(PipelineLibrary &&) = delete;
+
+    // Takes ownership of the pipeline, which also is the finished result of pipelineID, so that one is never built
+    // again in the background
+    DEF setFallback(uint32_t pipelineID, VkPipeline pipeline) -> void;
+    [[nodiscard]] DEF getFallback() const -> VkPipeline { return m_Fallback; }
+
+    // Queues the build, requesting an ID that is already known does nothing
+    DEF request(uint32_t pipelineID, BuildFunction build) -> void;
+
+    // Publishes the pipelines finished since the last call and rethrows if a build failed
+    DEF beginFrame() -> void;
+    // Meant to be called once per frame, frames that get the fallback are counted
+    [[nodiscard]] DEF acquire(uint32_t pipelineID) -> VkPipeline;
+    [[nodiscard]] DEF isReady(uint32_t pipelineID) const -> bool;
+
+    // Blocks until every requested pipeline is built and published
+    DEF waitIdle() -> void;
+    // Waits for pending builds and destroys every pipeline including the fallback
+    DEF clear() -> void;
+
+    DEF printStats() const -> void;
+
+private:
+    struct Entry {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        std::future<void> build;
+        std::chrono::time_point<std::chrono::high_resolution_clock> requested;
+        double latencyMs = 0.0; // From the request until the build finished, queueing included
+    };
+
+    struct FinishedBuild {
+        uint32_t pipelineID;
+        VkPipeline pipeline;
+        std::chrono::time_point<std::chrono::high_resolution_clock> finished;
+    };
+
+    DEF publishFinished() -> void;
+
+    VkDevice m_Device;
+    std::unique_ptr<ThreadPool> m_Workers;
+
+    unordered_map<uint32_t, Entry> m_Entries; // Only touched by the thread driving the frames
+
+    std::mutex m_FinishedMutex;
+    vector<FinishedBuild> m_Finished; // Handed over from the workers, drained by publishFinished
+
+    VkPipeline m_Fallback;
+    uint64_t m_FallbackFrameCount;
+    uint64_t m_FrameCount;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Constants.h"
+
+// One opaque draw. Sorting by the key groups draws by pipeline, then mesh, then material and finally orders them front
+// to back, so consecutive draws share as much bound state as possible:
+// [63..60 pipeline][59..48 mesh][47 virtual material][46..31 material][30..0 view depth]
+struct DrawPacket {
+    uint64_t key;
+    uint32_t objectIndex; // Index into whatever scene the packets were built from
+    uint32_t padding;
+};
+
+// What the recorder actually put into the command buffers, redundant binds are skipped and not counted.
+struct RecordingStats {
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t indexBufferBinds = 0;
+    uint32_t draws = 0;
+    uint32_t indirectDrawCalls = 0; // vkCmdDrawIndexedIndirect calls, each covering one or more of the draws
+
+    DEF operator+=(const RecordingStats &other) -> RecordingStats &;
+};
+
+// Draw packets of a single frame, radix sorted by their keys.
+class RenderQueue {
+public:
+    RenderQueue() = default;
+
+    // Throws if an ID doesn't fit its field, the material's Settings::VIRTUAL_MATERIAL_BIT gets a bit of its own
+    static DEF makeKey(uint32_t pipelineID, uint32_t meshID, uint32_t materialID, float viewDepth) -> uint64_t;
+
+    DEF clear() -> void { m_Packets.clear(); }
+    DEF reserve(const size_t packetCount) -> void { m_Packets.reserve(packetCount); }
+    DEF push(const uint64_t key, const uint32_t objectIndex) -> void { m_Packets.push_back(DrawPacket{key, objectIndex, 0}); }
+
+    // Stable LSD radix sort over the key bytes, bytes which are the same in every key are skipped
+    DEF sort() -> void;
+
+    [[nodiscard]] DEF getPackets() const -> const vector<DrawPacket> & { return m_Packets; }
+    [[nodiscard]] DEF size() const -> size_t { return m_Packets.size(); }
+
+private:
+    vector<DrawPacket> m_Packets;
+    vector<DrawPacket> m_Scratch; // Kept around, so sorting doesn't allocate once the queue has reached its size
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Constants.h"
+
+// Read-only view of the shader bundle written by scripts/bundle_shaders.py: every compiled SPIR-V module in one file,
+// mapped into memory once. Entries are looked up by the same path FilePaths uses for the loose .spv file.
+class ShaderBundle {
+public:
+    // Maps the file and checks every entry against its content hash, throws if anything doesn't add up
+    explicit ShaderBundle(const char *bundleFilepath);
+    ~ShaderBundle();
+
+    ShaderBundle(const ShaderBundle &) = delete;
+    ShaderBundle &operator=(const ShaderBundle &) = delete;
+    ShaderBundle(ShaderBundle &&) = delete;
+    ShaderBundle &operator=(ShaderBundle &&) = delete;
+
+    // Empty if the bundle has no such module, the span points right into the mapping
+    [[nodiscard]] DEF find(std::string_view shaderFilepath) const -> std::span<const std::byte>;
+
+    [[nodiscard]] DEF getModuleCount() const -> size_t { return m_Entries.size(); }
+    [[nodiscard]] DEF getSize() const -> size_t { return m_Size; }
+
+    static DEF hash(std::span<const std::byte> data) -> uint64_t;
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+    };
+
+    struct Entry {
+        char path[96];
+        uint64_t offset;
+        uint64_t size;
+        uint64_t hash;
+    };
+
+    const std::byte *m_Data;
+    size_t m_Size;
+    unordered_map<std::string_view, std::span<const std::byte>> m_Entries; // Keys point into the mapping as well
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Constants.h"
+
+// A persistently mapped, host coherent buffer of the staging pool, usable as transfer source and destination.
+struct StagingBuffer {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    std::byte *mapped;
+    VkDeviceSize size; // Of the whole buffer, at least what was requested
+};
+
+class Engine; // Forward declaration of Engine class to avoid circular dependency
+
+// Recycles staging buffers instead of creating, mapping and destroying one for every upload or readback. Requests are
+// rounded up to power of two size classes between Settings::STAGING_POOL_MIN_BUFFER_SIZE and
+// Settings::STAGING_POOL_MAX_BUFFER_SIZE, larger ones get a buffer of their exact size that can be reused by any
+// request it fits. Buffers are only released once the GPU is done with them, callers that submit without waiting
+// hold on to them until their frame completed, see TextureManager.
+//
+// The pool shrinks on its own: idle bytes are kept below Settings::STAGING_POOL_MAX_IDLE_BYTES, update frees buffers
+// that weren't used for Settings::STAGING_POOL_IDLE_FRAMES and every idle one while a memory heap is over
+// Settings::MEMORY_HEAP_WARNING_FRACTION, and a failed allocation trims the pool before it's retried.
+// Acquire and release are safe to call from any thread.
+class StagingPool {
+public:
+    struct Stats {
+        uint64_t acquires;
+        uint64_t allocations; // Every acquire beyond these reused a buffer
+        uint64_t trims; // Idle buffers freed to shrink the pool
+        VkDeviceSize bytes; // Of every buffer alive, in use or idle
+        VkDeviceSize peakBytes;
+    };
+
+    explicit StagingPool(Engine *engine);
+    ~StagingPool();
+
+    StagingPool(const StagingPool &) = delete;
+    StagingPool &operator=(const StagingPool &) = delete;
+    StagingPool(StagingPool &&) = delete;
+    StagingPool &operator=(StagingPool &&) = delete;
+
+    [[nodiscard]] DEF acquire(VkDeviceSize size) -> StagingBuffer;
+    // The GPU has to be done with the buffer
+    DEF release(const StagingBuffer &staging) -> void;
+
+    // Once per frame, frees the buffers that have been idle for too long, or all of them under memory pressure
+    DEF update() -> void;
+    // Frees every idle buffer
+    DEF trim() -> void;
+
+    // Without pooling every acquire allocates and every release frees, like uploads did before the pool
+    DEF setPooling(bool pooling) -> void;
+    [[nodiscard]] DEF getPooling() const -> bool { return m_Pooling; }
+
+    [[nodiscard]] DEF getStats() const -> Stats;
+    DEF printStats() const -> void;
+
+private:
+    struct IdleBuffer {
+        StagingBuffer staging;
+        uint64_t releaseFrame;
+    };
+
+    // Power of two classes from the min to the max buffer size, the last one holds every larger buffer
+    static constexpr uint32_t SIZE_CLASS_COUNT = std::countr_zero(Settings::STAGING_POOL_MAX_BUFFER_SIZE) -
+                                                 std::countr_zero(Settings::STAGING_POOL_MIN_BUFFER_SIZE) + 2;
+
+    static DEF getSizeClass(VkDeviceSize size) -> uint32_t;
+    [[nodiscard]] DEF allocate(VkDeviceSize size) -> StagingBuffer;
+    DEF destroy(const StagingBuffer &staging) -> void;
+    // Frees idle buffers, least recently released first, that the predicate selects, until the idle bytes are
+    // at most the target. The mutex has to be held.
+    template <typename Predicate>
+    DEF trimLocked(VkDeviceSize targetIdleBytes, Predicate shouldFree) -> void;
+    [[nodiscard]] DEF isUnderMemoryPressure() const -> bool;
+
+    Engine *m_Engine;
+    VkDevice m_Device;
+
+    mutable std::mutex m_Mutex;
+    array<vector<IdleBuffer>, SIZE_CLASS_COUNT> m_Idle; // Least recently released first
+    VkDeviceSize m_IdleBytes;
+    uint64_t m_Frame;
+    bool m_Pooling;
+    Stats m_Stats;
+};
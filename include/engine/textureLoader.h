@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Constants.h"
+#include "engine/threadPool.h"
+
+// Decides the format a texture is stored in, color textures are sampled as sRGB and normal maps as linear data
+enum class TextureUsage {
+    Color,
+    NormalMap // Only red and green are kept when compressed, z has to be reconstructed when sampling
+};
+
+// CPU side of loading a batch of textures: lays the images out back to back in one staging region and fills it
+// concurrently on the thread pool, every worker writing its image straight into that region. Uploading the region
+// is up to the caller, see Engine::loadTextures.
+//
+// With compression enabled textures are block compressed and cooked once into KTX2 files under
+// FilePaths::TEXTURE_CACHE, including the whole mip chain. Later loads read the cached levels directly into staging.
+class TextureLoader {
+public:
+    struct Level {
+        VkDeviceSize stagingOffset;
+        VkDeviceSize size;
+        uint32_t width;
+        uint32_t height;
+        uint64_t cacheOffset; // Of the level in the KTX2 file, if it's read from one
+    };
+
+    struct Image {
+        string filepath;
+        VkFormat format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        vector<Level> levels; // Every mip level, unless the GPU blits them from the base level
+        bool compressed;
+        bool cached; // Read from a valid KTX2 file instead of being decoded
+        std::filesystem::path cachePath;
+        string sourceStamp;
+        double decodeMs;
+        double mipMs;
+        double cookMs; // Block compression, zero unless the cache had to be (re)built
+        double stagingWriteMs;
+    };
+
+    explicit TextureLoader(ThreadPool *threadPool);
+
+    // Only reads the image headers and cache headers, returns how many bytes of staging memory decodeInto will write.
+    // Pass compress = false to keep everything RGBA8, e.g. when the device can't sample BC formats. RGBA8 images get
+    // their mip chain generated on the CPU with cpuMipmaps, otherwise only the base level is staged for the GPU to blit.
+    DEF plan(std::span<const char *const> textureFilepaths, TextureUsage usage, bool compress, bool cpuMipmaps) -> VkDeviceSize;
+    // Blocks until every image is in staging memory, throws the first error after all workers are done with the memory
+    DEF decodeInto(std::byte *stagingMemory) -> void;
+
+    [[nodiscard]] DEF getImages() const -> const vector<Image> & { return m_Images; }
+    [[nodiscard]] DEF getStagingSize() const -> VkDeviceSize { return m_StagingSize; }
+
+    [[nodiscard]] static DEF getFormatName(VkFormat format) -> const char *;
+
+private:
+    // Keeps the decoded pixels in `pixels` if the image's mips are generated on the CPU afterwards
+    DEF decodeImage(Image &image, std::byte *stagingMemory, vector<uint8_t> &pixels) const -> void;
+    DEF readCachedImage(Image &image, std::byte *stagingMemory) const -> void;
+    // Decodes, builds the mip chain and compresses it, runs on the calling thread and spreads blocks over the pool
+    DEF cookImage(Image &image, std::byte *stagingMemory) const -> void;
+    // Same threading as cookImage, writes levels 1 and up of an RGBA8 image into staging memory
+    DEF generateMipmaps(Image &image, const vector<uint8_t> &pixels, std::byte *stagingMemory) const -> void;
+
+    ThreadPool *m_ThreadPool;
+    vector<Image> m_Images;
+    vector<vector<uint8_t>> m_DecodedPixels; // Per image, only filled until its mips are generated
+    VkDeviceSize m_StagingSize;
+};
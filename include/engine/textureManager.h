@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Constants.h"
+#include "engine/stagingPool.h"
+#include "engine/textureLoader.h"
+#include "engine/threadPool.h"
+
+class Engine; // Forward declaration of Engine class to avoid circular dependency
+
+struct Texture {
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+    VkFormat format;
+    uint32_t width; // Of level 0
+    uint32_t height;
+    uint32_t mipLevels;
+    VkDeviceSize memorySize; // What the image takes up in VRAM, mips and driver padding included
+};
+
+// Textures decoded into a staging buffer of the staging pool, waiting for Engine::uploadTextures
+struct StagedTextures {
+    std::unique_ptr<TextureLoader> loader;
+    StagingBuffer staging;
+};
+
+// Owns every texture in the bindless texture table. Textures are shared by filepath and reference counted, and the
+// bytes of their resident mip levels are kept under a VRAM budget: once it's exceeded the least recently used
+// textures go first, unreferenced ones entirely, referenced ones lose their top mips down to
+// Settings::TEXTURE_MIN_RESIDENT_SIZE. Using a texture that is missing mips reloads it on a background thread.
+//
+// Slots keep their index for as long as the texture is referenced, while loading they show a placeholder. Uploads and
+// trims are submitted without waiting for them. There is a texture table per frame in flight and a residency change
+// only reaches a table once the frames that used it completed, so no pending frame has a descriptor it samples
+// rewritten. Replaced textures are retired with the frame number, and destroyed once that frame completed and no
+// table points at them anymore.
+class TextureManager {
+public:
+    struct Stats {
+        uint32_t textureCount;
+        uint32_t partialCount; // Resident without their top mips
+        uint32_t loadingCount;
+        VkDeviceSize residentBytes; // Sum of the resident levels, driver padding excluded
+        VkDeviceSize allocatedBytes;
+        VkDeviceSize peakResidentBytes;
+        uint64_t evictedTextures;
+        uint64_t evictedLevels;
+        uint64_t reloads;
+        uint64_t framesOverBudget; // Frames whose used textures alone didn't fit
+    };
+
+    TextureManager(
+        Engine *engine,
+        const array<VkDescriptorSet, Settings::MAX_FRAMES_IN_FLIGHT> &textureTables,
+        uint32_t capacity,
+        VkSampler sampler,
+        VkDeviceSize budget);
+    ~TextureManager();
+
+    TextureManager(const TextureManager &) = delete;
+    TextureManager &operator=(const TextureManager &) = delete;
+    TextureManager(TextureManager &&) = delete;
+    TextureManager &operator=(TextureManager &&) = delete;
+
+    // Returns the slot of the texture, loading it in the background if it isn't known yet
+    DEF acquire(const char *textureFilepath, TextureUsage usage) -> uint32_t;
+    // Unreferenced textures stay resident until the budget needs their memory
+    DEF release(uint32_t slot) -> void;
+
+    // Called for every texture the frame being built samples, feeds the LRU order and reloads missing mips
+    DEF markUsed(uint32_t slot) -> void;
+    // Once per frame after markUsed and before recording: uploads finished loads, enforces the budget and brings the
+    // frame's texture table up to date. The frame that used the table last time has to be complete.
+    DEF update(uint32_t frameIdx) -> void;
+    // Blocks until every requested load is uploaded and the device is idle, not meant for the frame loop
+    DEF waitForLoads() -> void;
+
+    DEF setBudget(const VkDeviceSize budget) -> void { m_Budget = budget; }
+    [[nodiscard]] DEF getBudget() const -> VkDeviceSize { return m_Budget; }
+    [[nodiscard]] DEF getTextureCount() const -> uint32_t { return static_cast<uint32_t>(m_SlotsByFilepath.size()); }
+    // Ascending, evictions leave gaps that acquire fills again, so they needn't be contiguous
+    [[nodiscard]] DEF getOccupiedSlots() const -> const vector<uint32_t> & { return m_OccupiedSlots; }
+    [[nodiscard]] DEF getStats() const -> Stats;
+    // Bytes of every level of the slot's texture that is currently in VRAM
+    [[nodiscard]] DEF getResidentLevelBytes(uint32_t slot) const -> vector<VkDeviceSize>;
+    // Stays valid for the lifetime of the manager, useful wherever any valid view is needed
+    [[nodiscard]] DEF getPlaceholder() const -> const Texture & { return m_Placeholder; }
+
+    DEF printStats() const -> void;
+
+private:
+    struct Entry {
+        string filepath;
+        TextureUsage usage;
+        Texture texture; // Null image while the first load is in flight
+        vector<VkDeviceSize> levelBytes; // Of the full mip chain, known once loaded
+        uint32_t droppedLevels; // Top levels that aren't resident
+        uint32_t refCount;
+        uint64_t lastUsedFrame;
+        bool loading;
+        bool occupied;
+    };
+
+    struct PendingLoad {
+        vector<uint32_t> slots;
+        std::shared_ptr<StagedTextures> staged;
+        std::future<void> done;
+    };
+
+    struct Eviction {
+        uint32_t slot;
+        uint32_t levels; // Zero evicts the whole texture
+    };
+
+    struct RetiredTexture {
+        Texture texture;
+        uint32_t slot; // Where the tables that weren't rewritten yet still point at it
+        uint64_t frame; // Submissions that read from it are done once Engine::isFrameComplete of it
+    };
+
+    // Uploads and trims submitted without waiting, with the staging buffers they copy from
+    struct Submission {
+        VkCommandBuffer commandBuffer;
+        vector<StagingBuffer> staging;
+        uint64_t frame;
+    };
+
+    DEF requestLoad(uint32_t slot) -> void;
+    DEF dispatchLoads() -> void;
+    // Records the uploads of loads that are done, or all of them when wait is set
+    DEF collectLoads(bool wait) -> void;
+    // Evicts in LRU order until the resident bytes fit the budget again
+    DEF enforceBudget() -> void;
+    // Records copying every level but the top `levels` ones into a new image
+    DEF dropTopLevels(VkCommandBuffer commandBuffer, const Entry &entry, uint32_t levels) -> Texture;
+    DEF evict(uint32_t slot) -> void;
+    // The slot's view changed, every table gets it once it's safe to write
+    DEF replace(uint32_t slot, const Texture &retired) -> void;
+    // Begun on first use, submitted by submitCommands
+    DEF getCommandBuffer() -> VkCommandBuffer;
+    DEF submitCommands() -> void;
+    // Rewrites the changed slots of every table no pending frame uses
+    DEF writeTables() -> void;
+    // Frees what the GPU is done with, everything when the device is known to be idle
+    DEF destroyRetired(bool idle) -> void;
+    DEF writeDescriptor(uint32_t table, uint32_t slot, VkImageView view) -> void;
+    DEF createPlaceholder() -> void;
+
+    [[nodiscard]] DEF getView(const Entry &entry) const -> VkImageView;
+
+    [[nodiscard]] DEF getResidentBytes(const Entry &entry) const -> VkDeviceSize;
+
+    Engine *m_Engine;
+    VkDevice m_Device;
+    // A single thread that waits for the decodes, which run on the engine's texture pool. Waiting on a worker of that
+    // pool could leave nobody to run them.
+    std::unique_ptr<ThreadPool> m_Loader;
+
+    array<VkDescriptorSet, Settings::MAX_FRAMES_IN_FLIGHT> m_TextureTables;
+    array<uint64_t, Settings::MAX_FRAMES_IN_FLIGHT> m_TableFrames; // The last frame that used each table
+    array<vector<VkImageView>, Settings::MAX_FRAMES_IN_FLIGHT> m_TableViews; // What each table's slots point at
+    array<vector<uint32_t>, Settings::MAX_FRAMES_IN_FLIGHT> m_DirtySlots; // Changed since the table was last written
+    VkSampler m_Sampler;
+    Texture m_Placeholder;
+
+    vector<Entry> m_Entries; // Indexed by slot
+    unordered_map<string, uint32_t> m_SlotsByFilepath;
+    vector<uint32_t> m_FreeSlots;
+    vector<uint32_t> m_OccupiedSlots;
+    vector<uint32_t> m_RequestedLoads;
+    vector<PendingLoad> m_PendingLoads;
+    VkCommandBuffer m_CommandBuffer; // Of this update, null until something is recorded
+    vector<StagingBuffer> m_RecordedStaging; // Read by the command buffer being recorded
+    vector<Submission> m_Submissions;
+    vector<RetiredTexture> m_RetiredTextures;
+    // Kept around, so a manager that stays over budget doesn't allocate every frame
+    vector<uint32_t> m_EvictionCandidates;
+    vector<Eviction> m_Evictions;
+
+    VkDeviceSize m_Budget;
+    VkDeviceSize m_ResidentBytes;
+    uint64_t m_Frame;
+    Stats m_Stats;
+};
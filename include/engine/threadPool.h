@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Constants.h"
+
+// Fixed set of worker threads pulling tasks from a shared queue, meant for work that is split up every frame
+// (command recording) or at load time (texture decoding), so the threads are created once and kept around.
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    // The future becomes ready once the task ran, get() rethrows anything the task threw.
+    DEF enqueue(std::function<void()> task) -> std::future<void>;
+
+    [[nodiscard]] DEF getThreadCount() const -> uint32_t { return static_cast<uint32_t>(m_Workers.size()); }
+
+private:
+    DEF workerLoop() -> void;
+
+    vector<std::thread> m_Workers;
+    std::queue<std::packaged_task<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stopping;
+};
@@ -10,7 +10,7 @@ struct VertexP {
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
     }
 
-    static DEF getAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription> {
+    static DEF getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 1> {
         VkVertexInputAttributeDescription posAttribute{
             .binding = 0,
             .location = 0,
@@ -35,7 +35,7 @@ struct VertexN {
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
     }
 
-    static DEF getAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription> {
+    static DEF getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 2> {
         VkVertexInputAttributeDescription posAttribute{
             .binding = 0,
             .location = 0,
@@ -66,7 +66,7 @@ struct VertexNT {
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
     }
 
-    static DEF getAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription> {
+    static DEF getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 3> {
         VkVertexInputAttributeDescription posAttribute{
             .binding = 0,
             .location = 0,
@@ -101,7 +101,7 @@ struct VertexC {
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
     }
 
-    static DEF getAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription> {
+    static DEF getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 2> {
         VkVertexInputAttributeDescription posAttribute{
             .binding = 0,
             .location = 0,
@@ -132,7 +132,7 @@ struct VertexCN {
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
     }
 
-    static DEF getAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription> {
+    static DEF getAttributeDescriptions() -> std::array<VkVertexInputAttributeDescription, 3> {
         VkVertexInputAttributeDescription posAttribute{
             .binding = 0,
             .location = 0,
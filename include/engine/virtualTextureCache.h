@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Constants.h"
+#include "engine/threadPool.h"
+
+class Engine; // Forward declaration of Engine class to avoid circular dependency
+
+// Software virtual texturing, no sparse binding involved. Virtual textures are split into pages of
+// Settings::VIRTUAL_TEXTURE_PAGE_SIZE texels per mip level, and only the pages the camera actually needs are resident,
+// each in a slot of one physical page cache texture. Every virtual texture has a page table texture with one texel per
+// page and mip level, pointing at the slot of that page or, if it isn't resident, at its closest resident ancestor. The
+// single page of the last level is pinned, so every lookup resolves to something.
+//
+// The main pass doubles as the feedback pass: a sparse, per-frame jittered grid of fragments counts the pages it wants
+// into a host-visible buffer, one region per frame in flight. Once that frame completed, beginFrame reads the
+// requests back, and the missing pages stream in on a background thread, coarse levels and most requested first.
+// Their uploads and the page table updates are recorded into a command buffer that is submitted ahead of the frame.
+//
+// Set 2 of the pipeline layout, one descriptor set per frame in flight that only differs in its feedback region:
+//   0: page cache, 1: page tables indexed by virtual texture, 2: feedback, 3: size and page table layout per texture
+class VirtualTextureCache {
+public:
+    struct Stats {
+        uint64_t requestedPages; // Distinct pages in the feedback, hits and misses together
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t uploadedPages;
+        uint64_t uploadedBytes; // Pages and page table texels
+        uint64_t evictedPages;
+        uint64_t droppedPages; // Streamed, but every slot was in use by the frame that asked for them
+    };
+
+    VirtualTextureCache(Engine *engine, VkDescriptorSetLayout descriptorSetLayout, uint32_t queueFamilyIndex);
+    ~VirtualTextureCache();
+
+    VirtualTextureCache(const VirtualTextureCache &) = delete;
+    VirtualTextureCache &operator=(const VirtualTextureCache &) = delete;
+    VirtualTextureCache(VirtualTextureCache &&) = delete;
+    VirtualTextureCache &operator=(VirtualTextureCache &&) = delete;
+
+    // Decodes the image and builds its mip chain in host memory, which pages are streamed from. Returns the material
+    // ID to put in ObjectData, the index of the texture with Settings::VIRTUAL_MATERIAL_BIT set. Its page table and
+    // pinned last level are uploaded by the next recordUploads, so the texture can be drawn from the next frame on.
+    DEF registerTexture(const char *textureFilepath) -> uint32_t;
+
+    // Reads back the feedback of the frame that last used this index, must only be called once that frame completed
+    DEF beginFrame(uint32_t frameIdx) -> void;
+    // Records the pages streamed in since the last frame, null if there's nothing to upload. Has to be submitted
+    // ahead of the frame's command buffer, in the same submission.
+    DEF recordUploads() -> VkCommandBuffer;
+    // Makes the feedback the main pass counted into frameIdx's region visible to beginFrame, recorded after the pass
+    DEF recordFeedbackBarrier(VkCommandBuffer commandBuffer, uint32_t frameIdx) const -> void;
+
+    [[nodiscard]] DEF getDescriptorSet(const uint32_t frameIdx) const -> VkDescriptorSet { return m_DescriptorSets[frameIdx]; }
+    [[nodiscard]] DEF getTextureCount() const -> uint32_t { return static_cast<uint32_t>(m_Textures.size()); }
+    [[nodiscard]] DEF getResidentPageCount() const -> uint32_t { return m_ResidentPageCount; }
+    // Totals since creation, and what the last beginFrame and recordUploads added
+    [[nodiscard]] DEF getStats() const -> const Stats & { return m_Stats; }
+    [[nodiscard]] DEF getFrameStats() const -> const Stats & { return m_FrameStats; }
+
+    DEF printStats() const -> void;
+
+private:
+    // Host side of a virtual texture, the pixels stay around for as long as the cache does
+    struct VirtualTexture {
+        string filepath;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint32_t tableWidth; // Pages of level 0, rounded up to a power of two so every level halves it exactly
+        uint32_t tableHeight;
+        uint32_t firstPage; // Of the texture's page table entries in the feedback and page slot arrays
+        vector<uint32_t> levelOffsets; // Of every level's entries, relative to firstPage
+        vector<vector<uint8_t>> levels; // RGBA8 mip chain
+        VkImage pageTable;
+        VkDeviceMemory pageTableMemory;
+        VkImageView pageTableView;
+        vector<uint32_t> tableEntries; // What the page table texture should hold, packed like its RGBA8 texels
+        bool tableDirty;
+        bool tableUploaded; // Until the first upload the page table is still in its initial layout
+    };
+
+    struct PageAddress {
+        uint32_t texture;
+        uint32_t level;
+        uint32_t x;
+        uint32_t y;
+    };
+
+    struct CacheSlot {
+        uint32_t page; // Global page index, only meaningful if occupied
+        uint64_t lastRequestedFrame;
+        bool occupied;
+        bool pinned;
+    };
+
+    // A batch of pages the streaming thread writes into one staging region, one slot after the other
+    struct StreamBatch {
+        uint32_t region;
+        vector<uint32_t> pages;
+        std::future<void> done;
+    };
+
+    // A staging region copied from by the frame with this number
+    struct RetiredRegion {
+        uint32_t region;
+        uint64_t frame;
+    };
+
+    struct Request {
+        uint32_t page;
+        uint32_t level;
+        uint32_t count; // Sampled fragments of the feedback grid that asked for it
+    };
+
+    DEF createPageCache() -> void;
+    DEF createBuffers() -> void;
+    DEF createDescriptorSets() -> void;
+    DEF createPageTable(VirtualTexture &texture) -> void;
+
+    [[nodiscard]] DEF decodePage(uint32_t page) const -> PageAddress;
+    // Copies the page and its border, wrapping around the edges like the repeating texture sampler does
+    static DEF writePage(const VirtualTexture &texture, uint32_t level, uint32_t x, uint32_t y, std::byte *destination) -> void;
+    // Frees the regions of every completed frame
+    DEF reclaimRegions() -> void;
+    // A free staging region, waits for the oldest frame still copying from one if there's none
+    DEF acquireRegion() -> uint32_t;
+    DEF dispatchStreaming() -> void;
+    // Free slot or the least recently requested page that the last feedback didn't ask for, UINT32_MAX if there's none
+    DEF findSlot() -> uint32_t;
+    DEF makeResident(uint32_t page, uint32_t slot, bool pinned) -> void;
+    DEF rebuildPageTable(VirtualTexture &texture) -> void;
+    // Copies staged pages into their slots and the tables of dirty textures from the page table region of frameIdx,
+    // returns the bytes copied
+    DEF recordCopies(VkCommandBuffer commandBuffer, const vector<VkBufferImageCopy> &pageCopies, uint32_t frameIdx) -> VkDeviceSize;
+
+    Engine *m_Engine;
+    VkDevice m_Device;
+    // Writing pages only touches host memory, so unlike the texture loader it can't block the engine's texture pool
+    std::unique_ptr<ThreadPool> m_Streamer;
+
+    VkDescriptorSetLayout m_DescriptorSetLayout;
+    VkDescriptorPool m_DescriptorPool;
+    array<VkDescriptorSet, Settings::MAX_FRAMES_IN_FLIGHT> m_DescriptorSets;
+    VkSampler m_CacheSampler;
+    VkSampler m_TableSampler;
+
+    VkImage m_PageCache;
+    VkDeviceMemory m_PageCacheMemory;
+    VkImageView m_PageCacheView;
+    vector<CacheSlot> m_Slots;
+    vector<uint32_t> m_PageSlots; // Slot of every page, UINT32_MAX if it isn't resident
+    uint32_t m_ResidentPageCount;
+
+    // A header with the frame number that jitters the feedback grid, followed by one counter per page
+    VkBuffer m_FeedbackBuffer;
+    VkDeviceMemory m_FeedbackMemory;
+    uint32_t *m_Feedback;
+    VkDeviceSize m_FeedbackRegionSize;
+
+    VkBuffer m_InfoBuffer;
+    VkDeviceMemory m_InfoMemory;
+    void *m_Info;
+
+    // Page regions the streaming thread fills, followed by one page table region per frame in flight
+    VkBuffer m_StagingBuffer;
+    VkDeviceMemory m_StagingMemory;
+    std::byte *m_Staging;
+    vector<uint32_t> m_FreeRegions;
+    vector<RetiredRegion> m_RetiredRegions; // Free again once Engine::isFrameComplete of their frame
+    // The region registerTexture staged last level pages into, NO_REGION if there are none waiting for recordUploads
+    uint32_t m_PinRegion;
+    vector<VkBufferImageCopy> m_PinCopies;
+
+    VkCommandPool m_CommandPool;
+    array<VkCommandBuffer, Settings::MAX_FRAMES_IN_FLIGHT> m_CommandBuffers;
+
+    vector<std::unique_ptr<VirtualTexture>> m_Textures;
+    uint32_t m_PageCount; // Page table entries of every texture together
+
+    vector<Request> m_Requests; // Missing pages of the last feedback, highest priority first
+    std::optional<StreamBatch> m_Streaming;
+    vector<uint8_t> m_PageStreaming; // Per page, so a page the feedback keeps asking for is only streamed once
+
+    uint32_t m_FrameIdx;
+    uint64_t m_Frame;
+    Stats m_Stats;
+    Stats m_FrameStats;
+};
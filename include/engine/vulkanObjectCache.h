@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Constants.h"
+
+// Deduplicates immutable Vulkan objects: samplers, descriptor set layouts, pipeline layouts and render passes. The
+// create-info is serialized into a canonical key, fields the driver ignores (e.g. the compare op of a sampler without
+// compare) are left out and layout bindings are sorted, so identical requests from any subsystem share one handle and
+// only the first one reaches the driver.
+//
+// The cache owns everything it hands out, callers must not destroy the handles. They stay valid until the cache is
+// destroyed, which has to happen after everything using them is gone. Getters are safe to call from any thread.
+class VulkanObjectCache {
+public:
+    struct KindStats {
+        uint64_t hits;
+        uint64_t misses;
+        double createMs; // Spent in the driver for the misses
+    };
+
+    struct Stats {
+        KindStats samplers;
+        KindStats descriptorSetLayouts;
+        KindStats pipelineLayouts;
+        KindStats renderPasses;
+    };
+
+    explicit VulkanObjectCache(VkDevice device);
+    ~VulkanObjectCache();
+
+    VulkanObjectCache(const VulkanObjectCache &) = delete;
+    VulkanObjectCache &operator=(const VulkanObjectCache &) = delete;
+    VulkanObjectCache(VulkanObjectCache &&) = delete;
+    VulkanObjectCache &operator=(VulkanObjectCache &&) = delete;
+
+    // Throw if the create-info has a pNext chain the key can't represent
+    [[nodiscard]] DEF getSampler(const VkSamplerCreateInfo &createInfo) -> VkSampler;
+    // Understands VkDescriptorSetLayoutBindingFlagsCreateInfo in the chain
+    [[nodiscard]] DEF getDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo &createInfo) -> VkDescriptorSetLayout;
+    [[nodiscard]] DEF getPipelineLayout(const VkPipelineLayoutCreateInfo &createInfo) -> VkPipelineLayout;
+    [[nodiscard]] DEF getRenderPass(const VkRenderPassCreateInfo &createInfo) -> VkRenderPass;
+
+    [[nodiscard]] DEF getStats() const -> Stats;
+    // Driver time the hits would have cost, estimated from the average creation time of the misses of each kind
+    [[nodiscard]] DEF getSavedMs() const -> double;
+
+    DEF printStats() const -> void;
+
+private:
+    VkDevice m_Device;
+
+    mutable std::mutex m_Mutex;
+    unordered_map<string, VkSampler> m_Samplers;
+    unordered_map<string, VkDescriptorSetLayout> m_DescriptorSetLayouts;
+    unordered_map<string, VkPipelineLayout> m_PipelineLayouts;
+    unordered_map<string, VkRenderPass> m_RenderPasses;
+    Stats m_Stats;
+};
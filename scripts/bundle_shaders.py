@@ -0,0 +1,68 @@
+import struct
+import sys
+from pathlib import Path
+
+# Packs every compiled shader into one file, which the engine maps once at startup (see include/engine/shaderBundle.h).
+#
+# Layout, little endian:
+#   header:  magic "SPVB", uint32 version, uint32 entry count, uint32 reserved
+#   entries: char[96] path (zero padded), uint64 offset, uint64 size, uint64 FNV-1a hash of the contents
+#   data:    the SPIR-V blobs, each starting at a multiple of 8 bytes
+MAGIC = b"SPVB"
+VERSION = 1
+PATH_LENGTH = 96
+HEADER_FORMAT = "<4sIII"
+ENTRY_FORMAT = f"<{PATH_LENGTH}sQQQ"
+ALIGNMENT = 8
+
+COMPILED_DIR = Path("shaders/compiled")
+BUNDLE_PATH = COMPILED_DIR / "shaders.bundle"
+
+
+def fnv1a_64(data):
+    value = 0xCBF29CE484222325
+    for byte in data:
+        value ^= byte
+        value = (value * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+    return value
+
+
+def align(value):
+    return (value + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+
+def main():
+    # Paths are stored relative to the project root, exactly like FilePaths uses them
+    project_root = Path(__file__).parent.parent.resolve()
+    shader_files = sorted((project_root / COMPILED_DIR).glob("*.spv"))
+    if not shader_files:
+        print(f"No compiled shaders found in {COMPILED_DIR}, run compile_shaders.sh first.")
+        sys.exit(1)
+
+    blobs = []
+    for shader_file in shader_files:
+        path = shader_file.relative_to(project_root).as_posix().encode()
+        if len(path) >= PATH_LENGTH:
+            print(f"Shader path too long for the bundle: {path.decode()}")
+            sys.exit(1)
+        blobs.append((path, shader_file.read_bytes()))
+
+    offset = align(struct.calcsize(HEADER_FORMAT) + struct.calcsize(ENTRY_FORMAT) * len(blobs))
+    entries = []
+    for path, data in blobs:
+        entries.append(struct.pack(ENTRY_FORMAT, path, offset, len(data), fnv1a_64(data)))
+        offset = align(offset + len(data))
+
+    with open(project_root / BUNDLE_PATH, "wb") as bundle:
+        bundle.write(struct.pack(HEADER_FORMAT, MAGIC, VERSION, len(blobs), 0))
+        for entry in entries:
+            bundle.write(entry)
+        for _, data in blobs:
+            bundle.write(b"\0" * (align(bundle.tell()) - bundle.tell()))
+            bundle.write(data)
+
+    print(f"    Bundled {len(blobs)} shaders into {BUNDLE_PATH}")
+
+
+if __name__ == "__main__":
+    main()
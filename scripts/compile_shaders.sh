@@ -45,4 +45,8 @@ for shader_file in "${shader_files[@]}"; do
     current_shader=$((current_shader + 1))
 done
 
-echo "Shader compilation complete!"
\ No newline at end of file
+echo "Shader compilation complete!"
+
+# Pack everything into the bundle the engine maps at startup
+echo "Bundling shaders..."
+python3 scripts/bundle_shaders.py
@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Change to the project root directory
+cd "$(dirname "$0")/.."
+
+# Compares the instruction count of the phong stages fragment shader with its stage specialization constant left
+# open (what a runtime branch on the stage would cost) against every specialized stage, after optimization.
+# Requires compiled shaders, see compile_shaders.sh.
+SPIRV_OPT=${SPIRV_OPT:-"$VULKAN_SDK/bin/spirv-opt"}
+SPIRV_DIS=${SPIRV_DIS:-"$VULKAN_SDK/bin/spirv-dis"}
+
+SHADER="shaders/compiled/shader_phong_stages.frag.spv"
+STAGE_COUNT=8
+
+if [ ! -f "$SHADER" ]; then
+    echo "Missing $SHADER, run scripts/compile_shaders.sh first."
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+# Instructions are all lines of the disassembly that contain an opcode
+count_instructions() {
+    "$SPIRV_DIS" "$1" | grep -c "Op[A-Z]"
+}
+
+"$SPIRV_OPT" -O "$SHADER" -o "$TMP_DIR/unspecialized.spv"
+unspecialized=$(count_instructions "$TMP_DIR/unspecialized.spv")
+echo "Unspecialized (all stages): $unspecialized instructions"
+
+for stage in $(seq 0 $((STAGE_COUNT - 1))); do
+    "$SPIRV_OPT" --set-spec-const-default-value "0:$stage" --freeze-spec-const -O "$SHADER" -o "$TMP_DIR/stage_$stage.spv"
+    instructions=$(count_instructions "$TMP_DIR/stage_$stage.spv")
+    echo "    Stage $stage: $instructions instructions ($((100 * instructions / unspecialized))% of unspecialized)"
+done
@@ -1,23 +1,22 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragPosition;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragNormal;
 layout(location = 3) in vec3 viewDir;
+layout(location = 4) flat in uint materialID;
 
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform CameraUBO {
     mat4 view;
     mat4 proj;
-    vec3 cameraEye;
-    float time;           // Align to 16 bytes
-    vec3 cameraCenter;
-    float padding1;       // Alignment padding
-    vec3 cameraUp;
-    float padding2;       // Alignment padding
-};
-layout(binding = 1) uniform sampler2D texSampler;
+    mat4 viewProj;
+    vec3 position;
+    float time;
+} camera;
+// Bindless texture table, indexed by the material of the object this fragment belongs to
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 layout(location = 0) out vec4 outColor;
 
@@ -27,10 +26,10 @@ void main() {
     float lightHeight = 5;
     float lightRadius = 2.0;
 
-    vec3 lightPosition = vec3(15 * sin(time), 0.0, 0.0);
+    vec3 lightPosition = vec3(15 * sin(camera.time), 0.0, 0.0);
     vec3 lightColor;
-    float modTime = mod(time, 3.0);
-    float phase = 3.14569 * (time + 1.0);
+    float modTime = mod(camera.time, 3.0);
+    float phase = 3.14569 * (camera.time + 1.0);
 
     // float lightIntensity = sin(phase) * sin(phase);
     float lightIntensity = 1.0;
@@ -57,7 +56,7 @@ void main() {
     vec3 specular = specularStrength * spec * lightColor;
 
     // Sample the texture color using the texture coordinates
-    vec4 sampledColor = texture(texSampler, fragTexCoord);
+    vec4 sampledColor = texture(textures[nonuniformEXT(materialID)], fragTexCoord);
 
     // Combine the lighting components with the texture color and fragment color
     vec3 finalColor = (ambient + diffuse + specular) * lightIntensity * sampledColor.rgb;
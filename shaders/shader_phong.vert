@@ -4,22 +4,28 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform CameraUBO {
     mat4 view;
     mat4 proj;
-    vec3 cameraEye;
-    float time;           // Align to 16 bytes
-    vec3 cameraCenter;
-    float padding1;       // Alignment padding
-    vec3 cameraUp;
-    float padding2;       // Alignment padding
+    mat4 viewProj;
+    vec3 position;
+    float time;
+} camera;
+
+struct ObjectData {
+    mat4 model;
+    uint materialID;
+};
+
+layout(std430, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
 };
 
 layout(location = 0) out vec3 fragPosition;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec3 viewDir;
+layout(location = 4) flat out uint materialID;
 
 void main() {
     // Define the rotation angle (22.5 degrees in radians)
@@ -37,16 +43,18 @@ void main() {
     vec4 rotatedPosition = rotationMatrix * vec4(inPosition, 1.0);
 
     // Transform the rotated position into world space
+    mat4 model = objects[gl_InstanceIndex].model;
     vec4 worldPosition = model * rotatedPosition;
     fragPosition = worldPosition.xyz;
     fragTexCoord = inTexCoord;
+    materialID = objects[gl_InstanceIndex].materialID;
 
     // Calculate the normal in world space
     fragNormal = mat3(transpose(inverse(model))) * inNormal;
 
     // Calculate view direction
-    viewDir = normalize(cameraEye - fragPosition);
+    viewDir = normalize(camera.position - fragPosition);
 
     // Final position in clip space
-    gl_Position = proj * view * worldPosition;
+    gl_Position = camera.viewProj * worldPosition;
 }
\ No newline at end of file
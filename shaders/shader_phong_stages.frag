@@ -1,30 +1,107 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragPosition;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragNormal;
 layout(location = 3) in vec3 viewDir;
 layout(location = 4) flat in int triangleID;
+layout(location = 5) flat in uint materialID;
 
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform CameraUBO {
     mat4 view;
     mat4 proj;
+    mat4 viewProj;
+    vec3 position;
+    float time;
+} camera;
+// Bindless texture table, indexed by the material of the object this fragment belongs to
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// Virtual textures, see VirtualTextureCache. These have to match the Settings in Constants.h.
+const uint VIRTUAL_MATERIAL_BIT = 1u << 31;
+const uint MAX_VIRTUAL_TEXTURES = 16;
+const uint PAGE_SIZE = 128;
+const uint PAGE_BORDER = 4;
+const uint FEEDBACK_STRIDE = 4;
+
+struct VirtualTexture {
+    uvec2 size;
+    uvec2 tableSize; // Pages of level 0, a power of two
+    uint mipLevels;
+    uint firstPage; // Of the texture's counters in the feedback buffer
+    uint padding[2];
 };
-layout(binding = 1) uniform sampler2D texSampler;
 
-// Push constant block
-layout(push_constant) uniform PushConstants {
-    vec3 cameraEye; 
-    vec3 cameraCenter;
-    vec3 cameraUp;
-    float time;
-    int stage;
-} pc; 
+// Slots of PAGE_SIZE + 2 * PAGE_BORDER texels, every page with the border it needs for filtering
+layout(set = 2, binding = 0) uniform sampler2D pageCache;
+// One texel per page and level, RG is the slot and B the level of the closest resident page
+layout(set = 2, binding = 1) uniform sampler2D pageTables[MAX_VIRTUAL_TEXTURES];
+layout(std430, set = 2, binding = 2) buffer Feedback {
+    uint feedbackFrame;
+    uint requests[];
+} feedback;
+layout(std430, set = 2, binding = 3) readonly buffer VirtualTextures {
+    VirtualTexture virtualTextures[];
+};
+
+// Set per pipeline, see Engine::createGraphicsPipeline, the branches of all other stages are compiled out
+layout(constant_id = 0) const int STAGE = 7;
 
 layout(location = 0) out vec4 outColor;
 
+uvec2 levelSize(uvec2 size, uint level) {
+    return max(size >> level, uvec2(1));
+}
+
+vec4 sampleVirtual(uint textureID, vec2 uv, vec2 dx, vec2 dy) {
+    VirtualTexture vt = virtualTextures[textureID];
+
+    // The level the hardware would pick, going by the texel footprint of level 0
+    vec2 texelDx = dx * vec2(vt.size);
+    vec2 texelDy = dy * vec2(vt.size);
+    float lod = 0.5 * log2(max(max(dot(texelDx, texelDx), dot(texelDy, texelDy)), 1.0));
+    uint level = min(uint(lod), vt.mipLevels - 1);
+
+    vec2 wrapped = fract(uv);
+    uvec2 tableSize = levelSize(vt.tableSize, level);
+    uvec2 page = min(uvec2(wrapped * vec2(levelSize(vt.size, level)) / float(PAGE_SIZE)), tableSize - 1);
+
+    // A sparse grid writes feedback, jittered so that every fragment gets its turn over STRIDE * STRIDE frames
+    uint cell = feedback.feedbackFrame % (FEEDBACK_STRIDE * FEEDBACK_STRIDE);
+    uvec2 jitter = uvec2(cell % FEEDBACK_STRIDE, cell / FEEDBACK_STRIDE);
+    if (all(equal(uvec2(gl_FragCoord.xy) % FEEDBACK_STRIDE, jitter))) {
+        uint levelOffset = 0;
+        for (uint i = 0; i < level; i++) {
+            uvec2 levelTable = levelSize(vt.tableSize, i);
+            levelOffset += levelTable.x * levelTable.y;
+        }
+        atomicAdd(feedback.requests[vt.firstPage + levelOffset + page.y * tableSize.x + page.x], 1);
+    }
+
+    uvec4 entry = uvec4(texelFetch(pageTables[nonuniformEXT(textureID)], ivec2(page), int(level)) * 255.0 + 0.5);
+    uint residentLevel = entry.b;
+    uvec2 residentPage = page >> (residentLevel - level);
+
+    float slotSize = float(PAGE_SIZE + 2 * PAGE_BORDER);
+    vec2 inPage = wrapped * vec2(levelSize(vt.size, residentLevel)) - vec2(residentPage * PAGE_SIZE);
+    inPage = clamp(inPage, vec2(0.5 - float(PAGE_BORDER)), vec2(float(PAGE_SIZE + PAGE_BORDER) - 0.5));
+    vec2 cacheUV = (vec2(entry.rg) * slotSize + float(PAGE_BORDER) + inPage) / vec2(textureSize(pageCache, 0));
+    return textureLod(pageCache, cacheUV, 0.0);
+}
+
+// Either the bindless texture or the virtual texture the material refers to
+vec4 sampleMaterial(vec2 uv) {
+    // Derivatives are taken before branching, materials are only uniform per object, not per quad
+    vec2 dx = dFdx(uv);
+    vec2 dy = dFdy(uv);
+    if ((materialID & VIRTUAL_MATERIAL_BIT) != 0) {
+        return sampleVirtual(materialID & ~VIRTUAL_MATERIAL_BIT, uv, dx, dy);
+    }
+    return textureGrad(textures[nonuniformEXT(materialID)], uv, dx, dy);
+}
+
 // Stage 0: Discard fragment (render nothing)
 void renderStage0() {
     discard;
@@ -58,7 +135,7 @@ vec3 computeAmbientLight() {
 
 // Stage 4: Texture without lighting
 void renderStage4() {
-    vec4 sampledColor = texture(texSampler, fragTexCoord);
+    vec4 sampledColor = sampleMaterial(fragTexCoord);
     outColor = sampledColor;
 }
 
@@ -72,7 +149,7 @@ void renderStage5(vec3 lightPosition) {
     float diff = max(dot(normal, lightDir), 0.0);
     vec3 diffuse = diff * vec3(0.5);  // Light color
 
-    vec4 sampledColor = texture(texSampler, fragTexCoord);
+    vec4 sampledColor = sampleMaterial(fragTexCoord);
     vec3 finalColor = (ambient + diffuse) * sampledColor.rgb;
 
     // Gamma correction
@@ -101,7 +178,7 @@ void renderStage6And7(vec3 lightPosition) {
     vec3 specular = specularStrength * spec * vec3(0.5);  // Light color
 
     // Sample texture color
-    vec4 sampledColor = texture(texSampler, fragTexCoord);
+    vec4 sampledColor = sampleMaterial(fragTexCoord);
 
     // Final color
     vec3 finalColor = (ambient + diffuse + specular) * sampledColor.rgb;
@@ -115,26 +192,26 @@ void renderStage6And7(vec3 lightPosition) {
 
 // Main entry point
 void main() {
-    if (pc.stage == 0) {
+    if (STAGE == 0) {
         renderStage0();
         return;
-    } else if (pc.stage == 1) {
+    } else if (STAGE == 1) {
         renderStage1();
         return;
-    } else if (pc.stage == 2) {
+    } else if (STAGE == 2) {
         renderStage2();
         return;
-    } else if (pc.stage == 3) {
+    } else if (STAGE == 3) {
         renderStage3();
         return;
-    } else if (pc.stage == 4) {
+    } else if (STAGE == 4) {
         renderStage4();
         return;
-    } else if (pc.stage == 5) {
+    } else if (STAGE == 5) {
         renderStage5(vec3(15.0, 0.0, 0.0));  // Static light position
         return;
-    } else if (pc.stage == 6 || pc.stage == 7) {
-        vec3 lightPosition = (pc.stage == 6) ? vec3(15.0, 0.0, 0.0) : vec3(15.0 * sin(pc.time), 0.0, 0.0);
+    } else if (STAGE == 6 || STAGE == 7) {
+        vec3 lightPosition = (STAGE == 6) ? vec3(15.0, 0.0, 0.0) : vec3(15.0 * sin(camera.time), 0.0, 0.0);
         renderStage6And7(lightPosition);
         return;
     }
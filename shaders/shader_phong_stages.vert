@@ -4,55 +4,61 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform CameraUBO {
     mat4 view;
     mat4 proj;
+    mat4 viewProj;
+    vec3 position;
+    float time;
+} camera;
+
+struct ObjectData {
+    mat4 model;
+    uint materialID;
 };
 
-// Push constant block
-layout(push_constant) uniform PushConstants {
-    vec3 cameraEye; 
-    vec3 cameraCenter;
-    vec3 cameraUp;
-    float time;
-    int stage;
-} pc; 
+layout(std430, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
 
 layout(location = 0) out vec3 fragPosition;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec3 viewDir;
 layout(location = 4) flat out int triangleID;  // Flat shading for triangle IDs
+layout(location = 5) flat out uint materialID;
 
-void main() {
-    // Define the rotation angle (22.5 degrees in radians)
-    float angle = 3.14159 / 8.0;  // 22.5 degrees in radians
-
-    // Rotation matrix around the y-axis
-    mat4 rotationMatrix = mat4(
-        cos(angle), 0.0, sin(angle), 0.0,
-        0.0,       1.0, 0.0,       0.0,
-        -sin(angle), 0.0, cos(angle), 0.0,
-        0.0,       0.0, 0.0,       1.0
-    );
+// Rotation by 22.5 degrees around the y-axis, cos and sin of pi / 8 folded in
+const float COS_ANGLE = 0.92387953;
+const float SIN_ANGLE = 0.38268343;
+const mat4 ROTATION_MATRIX = mat4(
+    COS_ANGLE, 0.0, SIN_ANGLE, 0.0,
+    0.0,       1.0, 0.0,       0.0,
+    -SIN_ANGLE, 0.0, COS_ANGLE, 0.0,
+    0.0,       0.0, 0.0,       1.0
+);
 
+void main() {
     // Rotate the position around the y-axis
-    vec4 rotatedPosition = rotationMatrix * vec4(inPosition, 1.0);
+    vec4 rotatedPosition = ROTATION_MATRIX * vec4(inPosition, 1.0);
+
+    // gl_InstanceIndex already includes the firstInstance of the draw
+    mat4 model = objects[gl_InstanceIndex].model;
 
     // Transform the rotated position into world space
     vec4 worldPosition = model * rotatedPosition;
     fragPosition = worldPosition.xyz;
     fragTexCoord = inTexCoord;
+    materialID = objects[gl_InstanceIndex].materialID;
 
     // Calculate the normal in world space
     fragNormal = mat3(transpose(inverse(model))) * inNormal;
 
     // Calculate view direction
-    viewDir = normalize(pc.cameraEye - fragPosition);
+    viewDir = normalize(camera.position - fragPosition);
 
     triangleID = gl_VertexIndex;
 
     // Final position in clip space
-    gl_Position = proj * view * worldPosition;
+    gl_Position = camera.viewProj * worldPosition;
 }
\ No newline at end of file
@@ -0,0 +1,1033 @@
+#include "Constants.h"
+
+#include "engine/engine.h"
+#include "engine/heapAllocations.h"
+#include "engine/mipGenerator.h"
+
+#include "Util.h"
+#include "stb_image.h"
+
+namespace {
+    // Host memory the driver requests through VkAllocationCallbacks
+    struct AllocationTracker {
+        size_t current = 0;
+        size_t peak = 0;
+    };
+
+    // Stored right in front of every tracked allocation, so that free and realloc know what they are dealing with
+    struct AllocationHeader {
+        void *original;
+        size_t size;
+    };
+
+    VKAPI_ATTR void *VKAPI_CALL trackedAllocation(void *pUserData, const size_t size, size_t alignment, VkSystemAllocationScope) {
+        alignment = std::max(alignment, alignof(AllocationHeader));
+        auto *original = static_cast<std::byte *>(std::malloc(size + alignment + sizeof(AllocationHeader)));
+        if (original == nullptr) return nullptr;
+
+        const auto address = reinterpret_cast<uintptr_t>(original + sizeof(AllocationHeader));
+        auto *aligned = reinterpret_cast<std::byte *>((address + alignment - 1) & ~(alignment - 1));
+        *(reinterpret_cast<AllocationHeader *>(aligned) - 1) = AllocationHeader{.original = original, .size = size};
+
+        auto *tracker = static_cast<AllocationTracker *>(pUserData);
+        tracker->current += size;
+        tracker->peak = std::max(tracker->peak, tracker->current);
+        return aligned;
+    }
+
+    VKAPI_ATTR void VKAPI_CALL trackedFree(void *pUserData, void *pMemory) {
+        if (pMemory == nullptr) return;
+        const AllocationHeader header = *(static_cast<AllocationHeader *>(pMemory) - 1);
+        static_cast<AllocationTracker *>(pUserData)->current -= header.size;
+        std::free(header.original);
+    }
+
+    VKAPI_ATTR void *VKAPI_CALL trackedReallocation(void *pUserData, void *pOriginal, const size_t size, const size_t alignment, const VkSystemAllocationScope scope) {
+        if (pOriginal == nullptr) return trackedAllocation(pUserData, size, alignment, scope);
+        if (size == 0) {
+            trackedFree(pUserData, pOriginal);
+            return nullptr;
+        }
+
+        void *memory = trackedAllocation(pUserData, size, alignment, scope);
+        if (memory == nullptr) return nullptr;
+        memcpy(memory, pOriginal, std::min(size, (static_cast<AllocationHeader *>(pOriginal) - 1)->size));
+        trackedFree(pUserData, pOriginal);
+        return memory;
+    }
+}
+
+// Replaces the scene by a grid of spheres for as long as it lives. Every setting a benchmark might change is remembered
+// up front and restored through its setter on destruction, so the benchmarks only state what they change.
+class Engine::BenchmarkScene {
+public:
+    BenchmarkScene(Engine *engine, uint32_t instanceCount);
+    ~BenchmarkScene();
+
+    BenchmarkScene(const BenchmarkScene &) = delete;
+    BenchmarkScene &operator=(const BenchmarkScene &) = delete;
+    BenchmarkScene(BenchmarkScene &&) = delete;
+    BenchmarkScene &operator=(BenchmarkScene &&) = delete;
+
+    // Benchmarks that sweep the grid size change it here, the destructor puts the scene back either way
+    DEF setInstanceCount(uint32_t instanceCount) const -> void;
+    // Draws the frames and waits for the device, by default enough for every frame in flight to see the configuration
+    DEF warmUp(uint32_t frames = Settings::MAX_FRAMES_IN_FLIGHT) const -> void;
+
+private:
+    Engine *m_Engine;
+    // Keeps the mesh alive for the duration of the benchmark, it's only referenced by a raw pointer in the draw batches
+    std::shared_ptr<MeshNT> m_SphereMesh;
+
+    bool m_UseInstancing;
+    bool m_UseIndirectDraws;
+    bool m_CacheCommandBuffers;
+    uint32_t m_RecordingThreadCount;
+    int m_Stage;
+    vec3 m_CameraEye;
+    vec3 m_CameraCenter;
+    uint32_t m_FramesInFlight;
+    bool m_UseTimelineSemaphore;
+};
+
+Engine::BenchmarkScene::BenchmarkScene(Engine *engine, const uint32_t instanceCount)
+    : m_Engine(engine),
+      m_SphereMesh(engine->acquireMesh(FilePaths::MODEL_BASIC_SPHERE)),
+      m_UseInstancing(engine->m_UseInstancing),
+      m_UseIndirectDraws(engine->m_UseIndirectDraws),
+      m_CacheCommandBuffers(engine->m_CacheCommandBuffers),
+      m_RecordingThreadCount(engine->m_RecordingThreadCount),
+      m_Stage(engine->m_Stage),
+      m_CameraEye(engine->m_CameraEye),
+      m_CameraCenter(engine->m_CameraCenter),
+      m_FramesInFlight(engine->m_FramesInFlight),
+      m_UseTimelineSemaphore(engine->m_UseTimelineSemaphore) {
+    m_Engine->m_BenchmarkMesh = m_SphereMesh.get();
+    m_Engine->m_BenchmarkInstanceCount = instanceCount;
+}
+
+Engine::BenchmarkScene::~BenchmarkScene() {
+    m_Engine->m_BenchmarkMaterials.clear();
+    m_Engine->m_BenchmarkInstanceCount = 0;
+    m_Engine->m_BenchmarkMesh = nullptr;
+
+    m_Engine->setInstancing(m_UseInstancing);
+    m_Engine->setIndirectDraws(m_UseIndirectDraws);
+    m_Engine->setCommandBufferCaching(m_CacheCommandBuffers);
+    m_Engine->setRecordingThreadCount(m_RecordingThreadCount);
+    m_Engine->setStage(m_Stage);
+    m_Engine->m_CameraEye = m_CameraEye;
+    m_Engine->m_CameraCenter = m_CameraCenter;
+    // Both only wait for the device when they actually change something
+    m_Engine->setTimelineSemaphoreWaits(m_UseTimelineSemaphore);
+    m_Engine->setFramesInFlight(m_FramesInFlight);
+}
+
+DEF Engine::BenchmarkScene::setInstanceCount(const uint32_t instanceCount) const -> void {
+    m_Engine->m_BenchmarkInstanceCount = instanceCount;
+}
+
+DEF Engine::BenchmarkScene::warmUp(const uint32_t frames) const -> void {
+    for (uint32_t i = 0; i < frames; i++) m_Engine->drawFrame();
+    vkDeviceWaitIdle(m_Engine->m_Device);
+}
+
+DEF Engine::runBenchmarks() -> void {
+    PRINT_BOLD_GREEN("* * * * * * * * * * * * * * *");
+    PRINT_BOLD_GREEN("*    Running Benchmarks     *");
+    PRINT_BOLD_GREEN("* * * * * * * * * * * * * * *");
+
+    benchmarkInstancing();
+    benchmarkDescriptors();
+    benchmarkResize();
+    benchmarkObjectCache();
+    benchmarkStagingPool();
+    benchmarkRecording();
+    benchmarkCommandBufferCache();
+    benchmarkRenderQueue();
+    benchmarkIndirectDraws();
+    benchmarkStages();
+    benchmarkTextureLoading();
+    benchmarkMipmaps();
+    benchmarkDownsampler();
+    benchmarkTextureResidency();
+    benchmarkVirtualTexturing();
+    benchmarkFrameAllocations();
+    benchmarkFrameSync();
+
+    vkDeviceWaitIdle(m_Device);
+}
+
+DEF Engine::benchmarkInstancing() -> void {
+    PRINT_BOLD_GREEN("Instancing: individual draws vs. one instanced draw");
+
+    const BenchmarkScene scene(this, Settings::INSTANCING_BENCHMARK_COUNTS[0]);
+    for (const uint32_t instanceCount : Settings::INSTANCING_BENCHMARK_COUNTS) {
+        scene.setInstanceCount(instanceCount);
+
+        for (const bool useInstancing : {false, true}) {
+            setInstancing(useInstancing);
+            scene.warmUp();
+
+            double recordTotalMs = 0.0;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t frame = 0; frame < Settings::BENCHMARK_FRAMES; frame++) {
+                drawFrame();
+                recordTotalMs += m_LastRecordTimeMs;
+            }
+            vkDeviceWaitIdle(m_Device);
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            fprintf(stdout, "%7u spheres, %-10s: %8.3f ms/frame, %8.3f ms recording/frame, %7u draw calls/frame\n",
+                    instanceCount,
+                    useInstancing ? "instanced" : "individual",
+                    elapsed.count() / Settings::BENCHMARK_FRAMES,
+                    recordTotalMs / Settings::BENCHMARK_FRAMES,
+                    useInstancing ? 1 : instanceCount);
+        }
+    }
+}
+
+DEF Engine::benchmarkDescriptors() -> void {
+    PRINT_BOLD_GREEN("Descriptors: one set per model and frame vs. one set with dynamic offsets");
+    fprintf(stdout, "Host memory is what the driver requested through allocation callbacks, "
+                    "drivers keeping descriptors in device memory report little of it.\n");
+
+    // Layout of the old scheme, plain buffer descriptors that get baked into every set
+    constexpr array perModelBindings{
+        VkDescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
+        VkDescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT},
+        VkDescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT}};
+
+    const VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(perModelBindings.size()),
+        .pBindings = perModelBindings.data()};
+
+    VkDescriptorSetLayout perModelLayout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &perModelLayout) != VK_SUCCESS) {
+        throw runtime_error("failed to create descriptor set layout!");
+    }
+
+    const VkDescriptorImageInfo imageInfo{
+        .sampler = m_TextureSampler,
+        .imageView = m_TextureManager->getPlaceholder().view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    for (const uint32_t modelCount : Settings::DESCRIPTOR_BENCHMARK_COUNTS) {
+        for (const bool perModel : {true, false}) {
+            const uint32_t setCount = perModel ? modelCount * Settings::MAX_FRAMES_IN_FLIGHT : 1;
+            const VkDescriptorType uniformType = perModel ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            const VkDescriptorType storageType = perModel ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+            AllocationTracker tracker{};
+            const VkAllocationCallbacks allocator{
+                .pUserData = &tracker,
+                .pfnAllocation = trackedAllocation,
+                .pfnReallocation = trackedReallocation,
+                .pfnFree = trackedFree};
+
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            // The texture moved into the bindless table, so it's only part of the per-model sets
+            vector poolSizes{
+                VkDescriptorPoolSize{.type = uniformType, .descriptorCount = setCount},
+                VkDescriptorPoolSize{.type = storageType, .descriptorCount = setCount}};
+            if (perModel) poolSizes.push_back(VkDescriptorPoolSize{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = setCount});
+
+            const VkDescriptorPoolCreateInfo poolInfo{
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                .maxSets = setCount,
+                .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+                .pPoolSizes = poolSizes.data()};
+
+            VkDescriptorPool pool = VK_NULL_HANDLE;
+            if (vkCreateDescriptorPool(m_Device, &poolInfo, &allocator, &pool) != VK_SUCCESS) {
+                throw runtime_error("failed to create descriptor pool!");
+            }
+
+            const vector layouts(setCount, perModel ? perModelLayout : m_DescriptorSetLayout);
+            vector<VkDescriptorSet> sets(setCount);
+            const VkDescriptorSetAllocateInfo allocInfo{
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .descriptorPool = pool,
+                .descriptorSetCount = setCount,
+                .pSetLayouts = layouts.data()};
+            if (vkAllocateDescriptorSets(m_Device, &allocInfo, sets.data()) != VK_SUCCESS) {
+                throw runtime_error("failed to allocate descriptor sets!");
+            }
+
+            // Every per-model set pointed at its own small slice, the dynamic set covers all objects at once
+            const VkDescriptorBufferInfo cameraBufferInfo{
+                .buffer = m_FrameAllocator->getBuffer(),
+                .offset = 0,
+                .range = sizeof(CameraUBO)};
+            const VkDescriptorBufferInfo objectBufferInfo{
+                .buffer = m_FrameAllocator->getBuffer(),
+                .offset = 0,
+                .range = perModel ? sizeof(ObjectData) : sizeof(ObjectData) * Settings::MAX_OBJECTS};
+
+            vector<VkWriteDescriptorSet> writes;
+            writes.reserve(static_cast<size_t>(setCount) * 3);
+            for (const VkDescriptorSet set : sets) {
+                writes.push_back(VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = set,
+                    .dstBinding = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = uniformType,
+                    .pBufferInfo = &cameraBufferInfo});
+                if (perModel) {
+                    writes.push_back(VkWriteDescriptorSet{
+                        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                        .dstSet = set,
+                        .dstBinding = 1,
+                        .descriptorCount = 1,
+                        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        .pImageInfo = &imageInfo});
+                }
+                writes.push_back(VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = set,
+                    .dstBinding = perModel ? 2u : 1u,
+                    .descriptorCount = 1,
+                    .descriptorType = storageType,
+                    .pBufferInfo = &objectBufferInfo});
+            }
+            vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            fprintf(stdout, "%7u models, %-9s: %7u sets, %7zu descriptors, %10.3f ms create+allocate+update, %10.1f KiB host memory\n",
+                    modelCount,
+                    perModel ? "per-model" : "dynamic",
+                    setCount,
+                    writes.size(),
+                    elapsed.count(),
+                    static_cast<double>(tracker.peak) / 1024.0);
+
+            vkDestroyDescriptorPool(m_Device, pool, &allocator);
+        }
+    }
+
+    vkDestroyDescriptorSetLayout(m_Device, perModelLayout, nullptr);
+}
+
+DEF Engine::benchmarkResize() -> void {
+    PRINT_BOLD_GREEN("Resize: swap chain recreation latency");
+
+    int originalWidth = 0;
+    int originalHeight = 0;
+    glfwGetWindowSize(m_Window, &originalWidth, &originalHeight);
+
+    // Alternate between two sizes, so that every iteration is an actual change of the extent
+    const array<std::pair<int, int>, 2> sizes{
+        std::pair{originalWidth, originalHeight},
+        std::pair{originalWidth * 3 / 4, originalHeight * 3 / 4}};
+
+    double recreateTotalMs = 0.0;
+    double recreateMaxMs = 0.0;
+    double firstFrameTotalMs = 0.0;
+    for (uint32_t i = 0; i < Settings::RESIZE_BENCHMARK_ITERATIONS; i++) {
+        const auto [width, height] = sizes[(i + 1) % sizes.size()];
+        glfwSetWindowSize(m_Window, width, height);
+
+        // Window managers apply the new size asynchronously, give them a moment
+        const auto requested = std::chrono::high_resolution_clock::now();
+        int currentWidth = 0;
+        int currentHeight = 0;
+        do {
+            glfwWaitEventsTimeout(0.005);
+            glfwGetWindowSize(m_Window, &currentWidth, &currentHeight);
+        } while ((currentWidth != width || currentHeight != height) &&
+                 std::chrono::high_resolution_clock::now() - requested < std::chrono::milliseconds(250));
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        recreateSwapChain();
+        m_FramebufferResized = false;
+        const auto recreated = std::chrono::high_resolution_clock::now();
+        drawFrame();
+        const auto presented = std::chrono::high_resolution_clock::now();
+
+        const double recreateMs = std::chrono::duration<double, std::milli>(recreated - start).count();
+        recreateTotalMs += recreateMs;
+        recreateMaxMs = std::max(recreateMaxMs, recreateMs);
+        firstFrameTotalMs += std::chrono::duration<double, std::milli>(presented - recreated).count();
+    }
+
+    glfwSetWindowSize(m_Window, originalWidth, originalHeight);
+    vkDeviceWaitIdle(m_Device);
+    recreateSwapChain();
+    m_FramebufferResized = false;
+
+    fprintf(stdout, "%u resizes: %8.3f ms avg recreation, %8.3f ms max recreation, %8.3f ms avg first frame afterwards\n",
+            Settings::RESIZE_BENCHMARK_ITERATIONS,
+            recreateTotalMs / Settings::RESIZE_BENCHMARK_ITERATIONS,
+            recreateMaxMs,
+            firstFrameTotalMs / Settings::RESIZE_BENCHMARK_ITERATIONS);
+}
+
+DEF Engine::benchmarkObjectCache() -> void {
+    PRINT_BOLD_GREEN("Object cache: immutable objects requested by repeated swap chain rebuilds");
+
+    // The creation functions write the members that pending compilations read
+    m_PipelineLibrary->waitIdle();
+
+    // Everything a rebuild without the cache would have to create again, all of it is known by now
+    const VulkanObjectCache::Stats before = m_ObjectCache->getStats();
+    const double savedBefore = m_ObjectCache->getSavedMs();
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < Settings::RESIZE_BENCHMARK_ITERATIONS; i++) {
+        createTextureSampler();
+        createDescriptorSetLayout();
+        createRenderPass();
+        createPipelineLayout();
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    const VulkanObjectCache::Stats after = m_ObjectCache->getStats();
+
+    const auto total = [](const VulkanObjectCache::Stats &stats, uint64_t VulkanObjectCache::KindStats::*field) {
+        return stats.samplers.*field + stats.descriptorSetLayouts.*field + stats.pipelineLayouts.*field + stats.renderPasses.*field;
+    };
+    const uint64_t hits = total(after, &VulkanObjectCache::KindStats::hits) - total(before, &VulkanObjectCache::KindStats::hits);
+    const uint64_t misses = total(after, &VulkanObjectCache::KindStats::misses) - total(before, &VulkanObjectCache::KindStats::misses);
+    const double savedMs = m_ObjectCache->getSavedMs() - savedBefore;
+    fprintf(stdout, "%u rebuilds: %llu hits, %llu misses, %8.4f ms of lookups per rebuild, ~%8.4f ms of driver calls saved per rebuild\n",
+            Settings::RESIZE_BENCHMARK_ITERATIONS,
+            static_cast<unsigned long long>(hits),
+            static_cast<unsigned long long>(misses),
+            elapsed.count() / Settings::RESIZE_BENCHMARK_ITERATIONS,
+            savedMs / Settings::RESIZE_BENCHMARK_ITERATIONS);
+    fprintf(stdout, "Savings are estimated from the creation time of each kind's misses at startup\n");
+}
+
+DEF Engine::benchmarkStagingPool() -> void {
+    PRINT_BOLD_GREEN("Staging pool: scene load uploads with a new staging buffer each vs. pooled staging buffers");
+
+    // The vertex and index buffers of the loaded meshes stand in for the assets of a scene
+    vector<VkDeviceSize> assetSizes;
+    for (const auto &[meshFilepath, mesh] : m_MeshCache) {
+        assetSizes.push_back(mesh->getVertices().size() * sizeof(VertexNT));
+        assetSizes.push_back(static_cast<VkDeviceSize>(mesh->getIndexCount()) * sizeof(uint32_t));
+    }
+    if (assetSizes.empty()) {
+        fprintf(stdout, "No meshes are loaded, skipping.\n");
+        return;
+    }
+    const vector<std::byte> data(*std::ranges::max_element(assetSizes));
+
+    const bool previousPooling = m_StagingPool->getPooling();
+    for (const bool pooling : {false, true}) {
+        m_StagingPool->setPooling(pooling);
+        const StagingPool::Stats before = m_StagingPool->getStats();
+
+        // Only the upload counts towards the latency, the destination buffers are allocated either way
+        vector<double> latencyMs(Settings::STAGING_BENCHMARK_ASSETS);
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < Settings::STAGING_BENCHMARK_ASSETS; i++) {
+            const VkDeviceSize size = assetSizes[i % assetSizes.size()];
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory, MemoryCategory::Meshes);
+
+            const auto uploadStart = std::chrono::high_resolution_clock::now();
+            uploadBuffer(buffer, data.data(), size);
+            latencyMs[i] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+
+            vkDestroyBuffer(m_Device, buffer, nullptr);
+            freeMemory(memory);
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        const StagingPool::Stats after = m_StagingPool->getStats();
+
+        const uint64_t acquires = after.acquires - before.acquires;
+        const uint64_t allocations = after.allocations - before.allocations;
+        const double meanMs = std::accumulate(latencyMs.begin(), latencyMs.end(), 0.0) / static_cast<double>(latencyMs.size());
+        std::ranges::sort(latencyMs);
+        fprintf(stdout, "%-8s %u uploads: %9.3f ms total, %7.4f ms mean / %7.4f ms p95 upload latency, %llu staging allocations (%llu avoided)\n",
+                pooling ? "Pooled" : "Unpooled",
+                Settings::STAGING_BENCHMARK_ASSETS,
+                elapsed.count(),
+                meanMs,
+                latencyMs[latencyMs.size() * 95 / 100],
+                static_cast<unsigned long long>(allocations),
+                static_cast<unsigned long long>(acquires - std::min(acquires, allocations)));
+    }
+    m_StagingPool->setPooling(previousPooling);
+}
+
+DEF Engine::benchmarkRecording() -> void {
+    PRINT_BOLD_GREEN("Recording: command buffer recording time by thread count");
+
+    const BenchmarkScene scene(this, Settings::RECORDING_BENCHMARK_DRAWS);
+    // Every sphere gets its own draw call, that's the workload worth splitting
+    setInstancing(false);
+    // Cache hits would skip exactly the recording we want to measure
+    setCommandBufferCaching(false);
+
+    double singleThreadedMs = 0.0;
+    for (uint32_t threadCount = 1; threadCount <= m_ThreadPool->getThreadCount(); threadCount *= 2) {
+        setRecordingThreadCount(threadCount);
+        scene.warmUp();
+
+        double recordTotalMs = 0.0;
+        for (uint32_t frame = 0; frame < Settings::BENCHMARK_FRAMES; frame++) {
+            drawFrame();
+            recordTotalMs += m_LastRecordTimeMs;
+        }
+        vkDeviceWaitIdle(m_Device);
+
+        const double recordMs = recordTotalMs / Settings::BENCHMARK_FRAMES;
+        if (threadCount == 1) singleThreadedMs = recordMs;
+        fprintf(stdout, "%7u draws, %2u thread(s): %8.3f ms recording/frame, %5.2fx speedup\n",
+                Settings::RECORDING_BENCHMARK_DRAWS,
+                threadCount,
+                recordMs,
+                singleThreadedMs / recordMs);
+    }
+}
+
+DEF Engine::benchmarkCommandBufferCache() -> void {
+    PRINT_BOLD_GREEN("Command buffer cache: recording time with and without cached command buffers");
+
+    const BenchmarkScene scene(this, Settings::RECORDING_BENCHMARK_DRAWS);
+    setInstancing(false);
+
+    for (const bool cacheCommandBuffers : {false, true}) {
+        setCommandBufferCaching(cacheCommandBuffers);
+        scene.warmUp();
+
+        const uint64_t cachedFramesBefore = m_CachedFrameCount;
+        const uint64_t recordedFramesBefore = m_RecordedFrameCount;
+        double recordTotalMs = 0.0;
+        for (uint32_t frame = 0; frame < Settings::BENCHMARK_FRAMES; frame++) {
+            drawFrame();
+            recordTotalMs += m_LastRecordTimeMs;
+        }
+        vkDeviceWaitIdle(m_Device);
+
+        fprintf(stdout, "%7u draws, cache %-3s: %8.3f ms recording/frame, %4llu frames from cache, %4llu re-recorded\n",
+                Settings::RECORDING_BENCHMARK_DRAWS,
+                cacheCommandBuffers ? "on" : "off",
+                recordTotalMs / Settings::BENCHMARK_FRAMES,
+                static_cast<unsigned long long>(m_CachedFrameCount - cachedFramesBefore),
+                static_cast<unsigned long long>(m_RecordedFrameCount - recordedFramesBefore));
+    }
+}
+
+DEF Engine::benchmarkRenderQueue() -> void {
+    PRINT_BOLD_GREEN("Render queue: radix sort of draw packets and binds per frame");
+
+    // Fixed seed, so runs stay comparable
+    std::mt19937 random(42);
+    std::uniform_int_distribution<uint32_t> pipelineDistribution(0, 3);
+    std::uniform_int_distribution<uint32_t> meshDistribution(0, 63);
+    const vector<uint32_t> &textureSlots = getTextureSlots();
+    std::uniform_int_distribution<size_t> materialDistribution(0, textureSlots.size() - 1);
+    std::uniform_real_distribution<float> depthDistribution(Settings::CLIPPING_PLANE_NEAR, Settings::CLIPPING_PLANE_FAR);
+
+    vector<uint64_t> keys(Settings::RENDER_QUEUE_BENCHMARK_PACKETS);
+    for (uint64_t &key : keys) {
+        key = RenderQueue::makeKey(pipelineDistribution(random), meshDistribution(random), textureSlots[materialDistribution(random)], depthDistribution(random));
+    }
+
+    RenderQueue queue;
+    vector<DrawPacket> reference;
+    double radixTotalMs = 0.0;
+    double comparisonTotalMs = 0.0;
+    for (uint32_t iteration = 0; iteration < Settings::BENCHMARK_FRAMES; iteration++) {
+        queue.clear();
+        for (uint32_t i = 0; i < keys.size(); i++) queue.push(keys[i], i);
+        reference = queue.getPackets();
+
+        const auto radixStart = std::chrono::high_resolution_clock::now();
+        queue.sort();
+        const auto radixEnd = std::chrono::high_resolution_clock::now();
+        std::ranges::stable_sort(reference, {}, &DrawPacket::key);
+        const auto comparisonEnd = std::chrono::high_resolution_clock::now();
+
+        radixTotalMs += std::chrono::duration<double, std::milli>(radixEnd - radixStart).count();
+        comparisonTotalMs += std::chrono::duration<double, std::milli>(comparisonEnd - radixEnd).count();
+    }
+
+    // Both sorts are stable, so they have to agree on the object order as well
+    const bool matches = std::ranges::equal(queue.getPackets(), reference, [](const DrawPacket &a, const DrawPacket &b) {
+        return a.key == b.key && a.objectIndex == b.objectIndex;
+    });
+    if (!matches) throw runtime_error("Radix sorted render queue differs from std::stable_sort!");
+
+    fprintf(stdout, "%7u packets: %8.3f ms radix sort, %8.3f ms std::stable_sort, %5.2fx speedup\n",
+            Settings::RENDER_QUEUE_BENCHMARK_PACKETS,
+            radixTotalMs / Settings::BENCHMARK_FRAMES,
+            comparisonTotalMs / Settings::BENCHMARK_FRAMES,
+            comparisonTotalMs / radixTotalMs);
+
+    const BenchmarkScene scene(this, Settings::RECORDING_BENCHMARK_DRAWS);
+    for (const bool useInstancing : {false, true}) {
+        setInstancing(useInstancing);
+        drawFrame();
+
+        const RecordingStats &stats = getRecordingStats();
+        fprintf(stdout, "%7u objects, %-13s: %7u draws, %u pipeline, %u descriptor set, %u vertex buffer, %u index buffer binds\n",
+                Settings::RECORDING_BENCHMARK_DRAWS,
+                useInstancing ? "instanced" : "not instanced",
+                stats.draws,
+                stats.pipelineBinds,
+                stats.descriptorSetBinds,
+                stats.vertexBufferBinds,
+                stats.indexBufferBinds);
+    }
+    vkDeviceWaitIdle(m_Device);
+}
+
+DEF Engine::benchmarkIndirectDraws() -> void {
+    PRINT_BOLD_GREEN("Indirect draws: CPU frame time of direct and indirect draw submission");
+
+    const BenchmarkScene scene(this, Settings::RECORDING_BENCHMARK_DRAWS);
+    // One draw per sphere and re-recorded every frame, that's the cost indirect draws are meant to cut
+    setInstancing(false);
+    setCommandBufferCaching(false);
+
+    for (const bool useIndirectDraws : {false, true}) {
+        setIndirectDraws(useIndirectDraws);
+        if (m_UseIndirectDraws != useIndirectDraws) continue;
+        scene.warmUp();
+
+        double frameTotalMs = 0.0;
+        double recordTotalMs = 0.0;
+        for (uint32_t frame = 0; frame < Settings::BENCHMARK_FRAMES; frame++) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            drawFrame();
+            frameTotalMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            recordTotalMs += m_LastRecordTimeMs;
+        }
+        vkDeviceWaitIdle(m_Device);
+
+        fprintf(stdout, "%7u draws, %-8s: %8.3f ms CPU/frame, %8.3f ms recording/frame, %7u draw calls%s\n",
+                Settings::RECORDING_BENCHMARK_DRAWS,
+                useIndirectDraws ? "indirect" : "direct",
+                frameTotalMs / Settings::BENCHMARK_FRAMES,
+                recordTotalMs / Settings::BENCHMARK_FRAMES,
+                useIndirectDraws ? m_RecordingStats.indirectDrawCalls : m_RecordingStats.draws,
+                useIndirectDraws && !m_SupportsMultiDrawIndirect ? " (no multi-draw)" : "");
+    }
+}
+
+DEF Engine::benchmarkStages() -> void {
+    PRINT_BOLD_GREEN("Stages: frame time of every specialized stage pipeline");
+    fprintf(stdout, "SPIR-V instruction counts per stage: scripts/shader_stage_costs.sh\n");
+
+    const BenchmarkScene scene(this, Settings::STAGE_BENCHMARK_INSTANCES);
+    // Otherwise the first stages would be measured with the fallback pipeline
+    m_PipelineLibrary->waitIdle();
+
+    for (int stage = 0; stage < Settings::STAGE_COUNT; stage++) {
+        setStage(stage);
+        scene.warmUp();
+
+        // Waiting for the device at the end makes this GPU time per frame once the GPU is the bottleneck
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t frame = 0; frame < Settings::BENCHMARK_FRAMES; frame++) drawFrame();
+        vkDeviceWaitIdle(m_Device);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        fprintf(stdout, "Stage %d, %7u instances: %8.3f ms/frame\n",
+                stage,
+                Settings::STAGE_BENCHMARK_INSTANCES,
+                elapsed.count() / Settings::BENCHMARK_FRAMES);
+    }
+}
+
+DEF Engine::benchmarkTextureLoading() -> void {
+    PRINT_BOLD_GREEN("Texture loading: RGBA8 with blitted mips vs. block compressed from the texture cache");
+
+    constexpr array textureFilepaths = {FilePaths::PAINTED_PLASTER_DIFFUSE, FilePaths::METAL_DIFFUSE};
+    const bool previousCompressTextures = m_CompressTextures;
+
+    for (const bool compress : {false, true}) {
+        setTextureCompression(compress);
+        if (m_CompressTextures != compress) continue;
+
+        // Warms the OS file cache for both, and cooks the compressed textures if the cache didn't have them yet
+        for (const Texture &texture : loadTextures(textureFilepaths, TextureUsage::Color)) destroyTexture(texture);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        const vector<Texture> textures = loadTextures(textureFilepaths, TextureUsage::Color);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        VkDeviceSize memorySize = 0;
+        for (const Texture &texture : textures) {
+            memorySize += texture.memorySize;
+            destroyTexture(texture);
+        }
+        fprintf(stdout, "%-10s %zu textures: %8.3f ms, %8.2f MB VRAM\n",
+                compress ? "Compressed" : "RGBA8",
+                textures.size(),
+                elapsed.count(),
+                static_cast<double>(memorySize) / (1024.0 * 1024.0));
+    }
+
+    setTextureCompression(previousCompressTextures);
+}
+
+DEF Engine::benchmarkMipmaps() -> void {
+    PRINT_BOLD_GREEN("Mipmaps: GPU blits vs. CPU mip chains, load time and PSNR against an exact box filter");
+
+    int texWidth = 0;
+    int texHeight = 0;
+    int texChannels = 0;
+    stbi_uc *pixels = stbi_load(Settings::MIPMAP_BENCHMARK_TEXTURE, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels) throw runtime_error("failed to load the mipmap benchmark texture!");
+    const auto width = static_cast<uint32_t>(texWidth);
+    const auto height = static_cast<uint32_t>(texHeight);
+
+    // Every level averaged straight from the base image, the best a box filter can do
+    const auto mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+    vector<vector<uint8_t>> references;
+    for (uint32_t level = 1; level < mipLevels; level++) references.push_back(MipGenerator::reference(pixels, width, height, level, true));
+    stbi_image_free(pixels);
+
+    const bool previousCompressTextures = m_CompressTextures;
+    const bool previousCpuMipmaps = m_CpuMipmaps;
+    setTextureCompression(false);
+    const array filepaths = {Settings::MIPMAP_BENCHMARK_TEXTURE};
+
+    for (const bool cpuMipmaps : {false, true}) {
+        setCpuMipmaps(cpuMipmaps);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        const vector<Texture> textures = loadTextures(filepaths, TextureUsage::Color);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        // Levels whose reference is identical score infinity, they're left out of the mean but still count as the best
+        double psnrSum = 0.0;
+        uint32_t finiteLevels = 0;
+        double worstPsnr = std::numeric_limits<double>::infinity();
+        for (uint32_t level = 1; level < textures.front().mipLevels; level++) {
+            const vector<uint8_t> mip = readTextureLevel(textures.front(), level, std::max(width >> level, 1u), std::max(height >> level, 1u));
+            const double psnr = MipGenerator::psnr(mip, references[level - 1]);
+            worstPsnr = std::min(worstPsnr, psnr);
+            if (std::isfinite(psnr)) {
+                psnrSum += psnr;
+                finiteLevels++;
+            }
+        }
+        for (const Texture &texture : textures) destroyTexture(texture);
+
+        fprintf(stdout, "%-4s mips: %8.3f ms load, PSNR mean %6.2f dB, worst level %6.2f dB\n",
+                cpuMipmaps ? "CPU" : "Blit",
+                elapsed.count(),
+                finiteLevels > 0 ? psnrSum / finiteLevels : std::numeric_limits<double>::infinity(),
+                worstPsnr);
+    }
+
+    setTextureCompression(previousCompressTextures);
+    setCpuMipmaps(previousCpuMipmaps);
+}
+
+DEF Engine::benchmarkDownsampler() -> void {
+    PRINT_BOLD_GREEN("Mip generation: blit chain vs. single pass compute downsampler, GPU time per chain");
+
+    if (!m_Downsampler) {
+        fprintf(stdout, "Skipped, the device doesn't support the compute downsampler.\n");
+        return;
+    }
+    const QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_PhysicalDevice);
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
+    vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
+    if (queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits == 0) {
+        fprintf(stdout, "Skipped, the graphics queue doesn't support timestamps.\n");
+        return;
+    }
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+    fprintf(stdout, "Device: %s\n", properties.deviceName);
+
+    const VkQueryPoolCreateInfo queryPoolInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2};
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    if (vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+        throw runtime_error("failed to create downsampler benchmark query pool!");
+    }
+
+    // Supports linear blits and storage on every device
+    constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    constexpr VkClearColorValue clearColor = {.float32 = {0.25f, 0.5f, 0.75f, 1.0f}};
+
+    for (const uint32_t size : Settings::DOWNSAMPLER_BENCHMARK_SIZES) {
+        const auto mipLevels = static_cast<uint32_t>(std::floor(std::log2(size))) + 1;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+        createImage(
+            size,
+            size,
+            mipLevels,
+            VK_SAMPLE_COUNT_1_BIT,
+            format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            image,
+            imageMemory,
+            MemoryCategory::Textures);
+
+        // The first iteration warms up caches and the driver, it isn't counted
+        array<double, 2> totalMs{};
+        uint32_t dispatchCount = 0;
+        for (uint32_t iteration = 0; iteration <= Settings::DOWNSAMPLER_BENCHMARK_ITERATIONS; iteration++) {
+            for (const bool compute : {false, true}) {
+                VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+                vkCmdResetQueryPool(commandBuffer, timestampPool, 0, 2);
+
+                // Level 0 gets fresh content every run, the blit chain expects every level in TRANSFER_DST
+                const VkImageMemoryBarrier toTransferDst{
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                    .srcAccessMask = 0,
+                    .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                    .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                    .image = image,
+                    .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = mipLevels, .baseArrayLayer = 0, .layerCount = 1}};
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0,
+                    0, nullptr,
+                    0, nullptr,
+                    1, &toTransferDst);
+                const VkImageSubresourceRange baseLevel = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1};
+                vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &baseLevel);
+
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, 0);
+                if (compute) {
+                    dispatchCount = m_Downsampler->record(commandBuffer, image, format, size, size, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                } else {
+                    generateMipmaps(commandBuffer, image, format, static_cast<int32_t>(size), static_cast<int32_t>(size), mipLevels);
+                }
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, 1);
+                endSingleTimeCommands(commandBuffer);
+                m_Downsampler->reset();
+
+                array<uint64_t, 2> timestamps{};
+                vkGetQueryPoolResults(
+                    m_Device,
+                    timestampPool,
+                    0,
+                    2,
+                    sizeof(timestamps),
+                    timestamps.data(),
+                    sizeof(uint64_t),
+                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+                if (iteration > 0) {
+                    totalMs[compute ? 1 : 0] += static_cast<double>(timestamps[1] - timestamps[0]) * properties.limits.timestampPeriod / 1e6;
+                }
+            }
+        }
+
+        vkDestroyImage(m_Device, image, nullptr);
+        freeMemory(imageMemory);
+
+        const double blitMs = totalMs[0] / Settings::DOWNSAMPLER_BENCHMARK_ITERATIONS;
+        const double computeMs = totalMs[1] / Settings::DOWNSAMPLER_BENCHMARK_ITERATIONS;
+        fprintf(stdout, "%5ux%-5u %2u mips: blit %8.3f ms, compute %8.3f ms in %u dispatches, %5.2fx\n",
+                size, size, mipLevels, blitMs, computeMs, dispatchCount, blitMs / computeMs);
+    }
+
+    vkDestroyQueryPool(m_Device, timestampPool, nullptr);
+}
+
+DEF Engine::benchmarkTextureResidency() -> void {
+    PRINT_BOLD_GREEN("Texture residency: eviction storm with half the textures fitting the budget");
+
+    const VkDeviceSize previousBudget = m_TextureManager->getBudget();
+    m_TextureManager->setBudget(std::numeric_limits<VkDeviceSize>::max());
+
+    // Normal maps are loaded as such, everything else as color. Textures the scene uses already are shared, not reloaded.
+    const auto &filepaths = Settings::RESIDENCY_BENCHMARK_TEXTURES;
+    vector<uint32_t> slots;
+    for (const char *filepath : filepaths) {
+        const bool normalMap = filepath == FilePaths::PAINTED_PLASTER_NORMAL || filepath == FilePaths::METAL_NORMAL;
+        slots.push_back(m_TextureManager->acquire(filepath, normalMap ? TextureUsage::NormalMap : TextureUsage::Color));
+    }
+    m_TextureManager->waitForLoads();
+
+    const TextureManager::Stats before = m_TextureManager->getStats();
+    m_TextureManager->setBudget(before.residentBytes / 2);
+    fprintf(stdout, "%u textures, %.2f MB resident, budget %.2f MB\n",
+            before.textureCount,
+            static_cast<double>(before.residentBytes) / (1024.0 * 1024.0),
+            static_cast<double>(m_TextureManager->getBudget()) / (1024.0 * 1024.0));
+
+    // A window over half the textures moves by one every frame, so each frame reloads what the last ones evicted
+    const size_t windowSize = (slots.size() + 1) / 2;
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    for (uint32_t frame = 0; frame < Settings::RESIDENCY_BENCHMARK_FRAMES; frame++) {
+        for (size_t i = 0; i < windowSize; i++) m_TextureManager->markUsed(slots[(frame + i) % slots.size()]);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        m_TextureManager->update(m_CurrentFrameIdx);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        totalMs += elapsed.count();
+        worstMs = std::max(worstMs, elapsed.count());
+    }
+    m_TextureManager->waitForLoads();
+
+    const TextureManager::Stats after = m_TextureManager->getStats();
+    fprintf(stdout, "%u frames: update %8.3f ms avg, %8.3f ms worst, peak %.2f MB\n",
+            Settings::RESIDENCY_BENCHMARK_FRAMES,
+            totalMs / Settings::RESIDENCY_BENCHMARK_FRAMES,
+            worstMs,
+            static_cast<double>(after.peakResidentBytes) / (1024.0 * 1024.0));
+    fprintf(stdout, "Evicted %llu textures and %llu top mip levels, %llu reloads, %llu frames over budget\n",
+            static_cast<unsigned long long>(after.evictedTextures - before.evictedTextures),
+            static_cast<unsigned long long>(after.evictedLevels - before.evictedLevels),
+            static_cast<unsigned long long>(after.reloads - before.reloads),
+            static_cast<unsigned long long>(after.framesOverBudget - before.framesOverBudget));
+
+    for (const uint32_t slot : slots) m_TextureManager->release(slot);
+    m_TextureManager->setBudget(previousBudget);
+    m_TextureManager->update(m_CurrentFrameIdx);
+}
+
+DEF Engine::benchmarkVirtualTexturing() -> void {
+    PRINT_BOLD_GREEN("Virtual texturing: page streaming while the camera dollies into a grid of spheres");
+
+    const BenchmarkScene scene(this, Settings::VIRTUAL_TEXTURE_BENCHMARK_INSTANCES);
+    // Registered for the rest of the engine's lifetime, virtual textures can't be unregistered
+    for (const char *filepath : Settings::VIRTUAL_TEXTURE_BENCHMARK_TEXTURES) m_BenchmarkMaterials.push_back(registerVirtualTexture(filepath));
+    setStage(Settings::STAGE_COUNT - 1);
+    m_PipelineLibrary->waitIdle();
+
+    // The first half moves from seeing the whole grid to right in front of its closest sphere, the second half holds
+    // still, so the misses have to stop at some point
+    constexpr uint32_t dollyFrames = Settings::VIRTUAL_TEXTURE_BENCHMARK_FRAMES / 2;
+    const vec3 farEye(40.0f, 40.0f, 30.0f);
+    const vec3 nearEye(12.0f, 12.0f, 10.0f);
+    m_CameraCenter = vec3(0.0f);
+
+    const VirtualTextureCache::Stats before = m_VirtualTextures->getStats();
+    uint64_t peakFrameBytes = 0;
+    uint32_t lastMissFrame = 0;
+    for (uint32_t frame = 0; frame < Settings::VIRTUAL_TEXTURE_BENCHMARK_FRAMES; frame++) {
+        const float t = std::min(static_cast<float>(frame) / static_cast<float>(dollyFrames), 1.0f);
+        m_CameraEye = glm::mix(farEye, nearEye, t);
+        drawFrame();
+
+        const VirtualTextureCache::Stats &frameStats = m_VirtualTextures->getFrameStats();
+        peakFrameBytes = std::max(peakFrameBytes, frameStats.uploadedBytes);
+        if (frameStats.misses > 0) lastMissFrame = frame + 1;
+    }
+    vkDeviceWaitIdle(m_Device);
+
+    const VirtualTextureCache::Stats &after = m_VirtualTextures->getStats();
+    const uint64_t requested = after.requestedPages - before.requestedPages;
+    const uint64_t hits = after.hits - before.hits;
+    fprintf(stdout, "%u frames, %u instances: %.1f%% hit rate over %llu page requests, %u of %u pages resident\n",
+            Settings::VIRTUAL_TEXTURE_BENCHMARK_FRAMES,
+            Settings::VIRTUAL_TEXTURE_BENCHMARK_INSTANCES,
+            requested > 0 ? 100.0 * static_cast<double>(hits) / static_cast<double>(requested) : 100.0,
+            static_cast<unsigned long long>(requested),
+            m_VirtualTextures->getResidentPageCount(),
+            Settings::VIRTUAL_TEXTURE_CACHE_PAGES * Settings::VIRTUAL_TEXTURE_CACHE_PAGES);
+    fprintf(stdout, "Uploads: %.3f MB/frame avg, %.3f MB/frame peak, %llu pages evicted, %llu dropped\n",
+            static_cast<double>(after.uploadedBytes - before.uploadedBytes) / (1024.0 * 1024.0) / Settings::VIRTUAL_TEXTURE_BENCHMARK_FRAMES,
+            static_cast<double>(peakFrameBytes) / (1024.0 * 1024.0),
+            static_cast<unsigned long long>(after.evictedPages - before.evictedPages),
+            static_cast<unsigned long long>(after.droppedPages - before.droppedPages));
+    if (lastMissFrame < Settings::VIRTUAL_TEXTURE_BENCHMARK_FRAMES) {
+        fprintf(stdout, "Misses stopped %u frames after the camera did\n", lastMissFrame > dollyFrames ? lastMissFrame - dollyFrames : 0);
+    } else {
+        fprintf(stdout, "Still missing pages after %u frames of holding still, the working set doesn't fit the cache\n",
+                Settings::VIRTUAL_TEXTURE_BENCHMARK_FRAMES - dollyFrames);
+    }
+}
+
+DEF Engine::benchmarkFrameAllocations() -> void {
+    PRINT_BOLD_GREEN("Frame allocations: heap allocations per frame once warmed up");
+
+    const BenchmarkScene scene(this, Settings::INSTANCING_BENCHMARK_COUNTS[0]);
+    bool allocationFree = true;
+    for (const bool cacheCommandBuffers : {true, false}) {
+        setCommandBufferCaching(cacheCommandBuffers);
+        // Lets every container of the frame loop and the frame arena grow to the size this scene needs
+        scene.warmUp(Settings::FRAME_ALLOCATION_WARMUP_FRAMES);
+
+        uint32_t allocatingFrames = 0;
+        uint64_t worstFrameAllocations = 0;
+        const uint64_t countBefore = HeapAllocations::getCount();
+        const uint64_t bytesBefore = HeapAllocations::getBytes();
+        for (uint32_t frame = 0; frame < Settings::FRAME_ALLOCATION_CHECK_FRAMES; frame++) {
+            const uint64_t frameBefore = HeapAllocations::getCount();
+            drawFrame();
+            const uint64_t frameAllocations = HeapAllocations::getCount() - frameBefore;
+            if (frameAllocations > 0) allocatingFrames++;
+            worstFrameAllocations = std::max(worstFrameAllocations, frameAllocations);
+        }
+        const uint64_t allocations = HeapAllocations::getCount() - countBefore;
+        const uint64_t bytes = HeapAllocations::getBytes() - bytesBefore;
+        vkDeviceWaitIdle(m_Device);
+
+        fprintf(stdout, "%u frames, cache %-3s: %llu heap allocations (%llu bytes), %u frames allocated, at most %llu in one frame\n",
+                Settings::FRAME_ALLOCATION_CHECK_FRAMES,
+                cacheCommandBuffers ? "on" : "off",
+                static_cast<unsigned long long>(allocations),
+                static_cast<unsigned long long>(bytes),
+                allocatingFrames,
+                static_cast<unsigned long long>(worstFrameAllocations));
+        allocationFree = allocationFree && allocations == 0;
+    }
+    m_FrameArena.printStats();
+    if (!allocationFree) fprintf(stderr, "The steady-state frame loop allocated on the heap!\n");
+}
+
+DEF Engine::benchmarkFrameSync() -> void {
+    PRINT_BOLD_GREEN("Frame sync: CPU wait on fences vs. the timeline semaphore per frames in flight");
+
+    const BenchmarkScene scene(this, Settings::FRAME_SYNC_BENCHMARK_INSTANCES);
+    for (uint32_t framesInFlight = 1; framesInFlight <= Settings::MAX_FRAMES_IN_FLIGHT; framesInFlight++) {
+        setFramesInFlight(framesInFlight);
+
+        for (const bool useTimelineSemaphore : {false, true}) {
+            setTimelineSemaphoreWaits(useTimelineSemaphore);
+            scene.warmUp();
+
+            double waitTotalMs = 0.0;
+            double waitMaxMs = 0.0;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t frame = 0; frame < Settings::BENCHMARK_FRAMES; frame++) {
+                drawFrame();
+                waitTotalMs += m_LastFrameWaitMs;
+                waitMaxMs = std::max(waitMaxMs, m_LastFrameWaitMs);
+            }
+            vkDeviceWaitIdle(m_Device);
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            fprintf(stdout, "%u in flight, %-8s: %8.3f ms/frame, %8.3f ms waiting/frame, %8.3f ms longest wait\n",
+                    framesInFlight,
+                    useTimelineSemaphore ? "timeline" : "fences",
+                    elapsed.count() / Settings::BENCHMARK_FRAMES,
+                    waitTotalMs / Settings::BENCHMARK_FRAMES,
+                    waitMaxMs);
+        }
+    }
+}
@@ -0,0 +1,362 @@
+#include "Constants.h"
+
+#include "engine/blockCompression.h"
+
+namespace {
+    using Color = array<float, 4>;
+    using Pixels = array<Color, 16>;
+
+    constexpr uint32_t POWER_ITERATIONS = 8;
+    constexpr array<int, 16> BC7_WEIGHTS_4 = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    DEF toPixels(const array<uint8_t, 64> &rgba) -> Pixels {
+        Pixels pixels{};
+        for (size_t i = 0; i < 16; i++) {
+            for (size_t c = 0; c < 4; c++) pixels[i][c] = static_cast<float>(rgba[i * 4 + c]);
+        }
+        return pixels;
+    }
+
+    DEF distanceSquared(const Color &a, const Color &b, const int channels) -> float {
+        float distance = 0.0f;
+        for (int c = 0; c < channels; c++) distance += (a[c] - b[c]) * (a[c] - b[c]);
+        return distance;
+    }
+
+    // Endpoints at the extremes of the pixels projected onto their principal axis, over the first `channels` channels
+    DEF fitEndpoints(const Pixels &pixels, const int channels, Color &low, Color &high) -> void {
+        Color mean{};
+        Color minimum{255.0f, 255.0f, 255.0f, 255.0f};
+        Color maximum{};
+        for (const Color &pixel : pixels) {
+            for (int c = 0; c < channels; c++) {
+                mean[c] += pixel[c] / 16.0f;
+                minimum[c] = std::min(minimum[c], pixel[c]);
+                maximum[c] = std::max(maximum[c], pixel[c]);
+            }
+        }
+
+        array<Color, 4> covariance{};
+        for (const Color &pixel : pixels) {
+            for (int i = 0; i < channels; i++) {
+                for (int j = 0; j < channels; j++) covariance[i][j] += (pixel[i] - mean[i]) * (pixel[j] - mean[j]);
+            }
+        }
+
+        // Power iteration, starting from the bounding box diagonal which is usually close already
+        Color axis{};
+        for (int c = 0; c < channels; c++) axis[c] = maximum[c] - minimum[c];
+        for (uint32_t iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+            Color next{};
+            float largest = 0.0f;
+            for (int i = 0; i < channels; i++) {
+                for (int j = 0; j < channels; j++) next[i] += covariance[i][j] * axis[j];
+                largest = std::max(largest, std::abs(next[i]));
+            }
+            if (largest == 0.0f) break;
+            for (int c = 0; c < channels; c++) axis[c] = next[c] / largest;
+        }
+
+        const float length = std::sqrt(distanceSquared(axis, Color{}, channels));
+        if (length < 1e-6f) {
+            low = mean;
+            high = mean;
+            return;
+        }
+
+        float projectedMin = std::numeric_limits<float>::max();
+        float projectedMax = std::numeric_limits<float>::lowest();
+        for (const Color &pixel : pixels) {
+            float projected = 0.0f;
+            for (int c = 0; c < channels; c++) projected += (pixel[c] - mean[c]) * axis[c] / length;
+            projectedMin = std::min(projectedMin, projected);
+            projectedMax = std::max(projectedMax, projected);
+        }
+        for (int c = 0; c < channels; c++) {
+            low[c] = std::clamp(mean[c] + axis[c] / length * projectedMin, 0.0f, 255.0f);
+            high[c] = std::clamp(mean[c] + axis[c] / length * projectedMax, 0.0f, 255.0f);
+        }
+    }
+
+    DEF quantize565(const Color &color) -> uint16_t {
+        const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+        const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+        const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    // Bit replication, the same expansion the hardware decoder does
+    DEF expand565(const uint16_t packed) -> Color {
+        const uint32_t r = packed >> 11 & 31;
+        const uint32_t g = packed >> 5 & 63;
+        const uint32_t b = packed & 31;
+        return {static_cast<float>(r << 3 | r >> 2), static_cast<float>(g << 2 | g >> 4), static_cast<float>(b << 3 | b >> 2), 255.0f};
+    }
+
+    // Always in four color mode, which BC3 requires and opaque BC1 blocks get by keeping color0 > color1
+    DEF writeColorBlock(const Pixels &pixels, std::byte *block) -> void {
+        Color low{};
+        Color high{};
+        fitEndpoints(pixels, 3, low, high);
+
+        uint16_t color0 = quantize565(high);
+        uint16_t color1 = quantize565(low);
+        if (color0 < color1) std::swap(color0, color1);
+
+        uint32_t indices = 0;
+        // Equal endpoints decode every index to color0, so the zeroed indices are already right
+        if (color0 != color1) {
+            const Color endpoint0 = expand565(color0);
+            const Color endpoint1 = expand565(color1);
+            array<Color, 4> palette{endpoint0, endpoint1};
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2.0f * endpoint0[c] + endpoint1[c]) / 3.0f;
+                palette[3][c] = (endpoint0[c] + 2.0f * endpoint1[c]) / 3.0f;
+            }
+
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t bestIndex = 0;
+                float bestDistance = std::numeric_limits<float>::max();
+                for (uint32_t k = 0; k < 4; k++) {
+                    const float distance = distanceSquared(pixels[i], palette[k], 3);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        bestIndex = k;
+                    }
+                }
+                indices |= bestIndex << (2 * i);
+            }
+        }
+
+        std::memcpy(block, &color0, sizeof(color0));
+        std::memcpy(block + 2, &color1, sizeof(color1));
+        std::memcpy(block + 4, &indices, sizeof(indices));
+    }
+
+    // BC4 layout, in eight value mode whenever the block isn't flat
+    DEF writeChannelBlock(const Pixels &pixels, const int channel, std::byte *block) -> void {
+        float minimum = 255.0f;
+        float maximum = 0.0f;
+        for (const Color &pixel : pixels) {
+            minimum = std::min(minimum, pixel[channel]);
+            maximum = std::max(maximum, pixel[channel]);
+        }
+        const auto value0 = static_cast<uint8_t>(std::lround(maximum));
+        const auto value1 = static_cast<uint8_t>(std::lround(minimum));
+
+        uint64_t indices = 0;
+        if (value0 > value1) {
+            array<float, 8> palette{static_cast<float>(value0), static_cast<float>(value1)};
+            for (uint32_t k = 2; k < 8; k++) {
+                palette[k] = (static_cast<float>(8 - k) * value0 + static_cast<float>(k - 1) * value1) / 7.0f;
+            }
+
+            for (uint32_t i = 0; i < 16; i++) {
+                uint64_t bestIndex = 0;
+                float bestDistance = std::numeric_limits<float>::max();
+                for (uint32_t k = 0; k < 8; k++) {
+                    const float distance = std::abs(pixels[i][channel] - palette[k]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        bestIndex = k;
+                    }
+                }
+                indices |= bestIndex << (3 * i);
+            }
+        }
+
+        block[0] = static_cast<std::byte>(value0);
+        block[1] = static_cast<std::byte>(value1);
+        for (uint32_t b = 0; b < 6; b++) block[2 + b] = static_cast<std::byte>(indices >> (8 * b) & 0xFF);
+    }
+
+    // Picks the p-bit that lands the 7 bit endpoint closest to the 8 bit one
+    DEF quantizeBC7Endpoint(const Color &endpoint, array<uint8_t, 4> &quantized, uint8_t &pBit) -> void {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint8_t p = 0; p < 2; p++) {
+            array<uint8_t, 4> candidate{};
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                candidate[c] = static_cast<uint8_t>(std::clamp<long>(std::lround((endpoint[c] - p) / 2.0f), 0, 127));
+                const float expanded = static_cast<float>(candidate[c] << 1 | p);
+                error += (expanded - endpoint[c]) * (expanded - endpoint[c]);
+            }
+            if (error < bestError) {
+                bestError = error;
+                quantized = candidate;
+                pBit = p;
+            }
+        }
+    }
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::byte *block) : m_Block(block), m_Position(0) { std::memset(block, 0, 16); }
+
+        DEF write(const uint32_t value, const uint32_t bitCount) -> void {
+            for (uint32_t bit = 0; bit < bitCount; bit++, m_Position++) {
+                if (value >> bit & 1) m_Block[m_Position / 8] |= static_cast<std::byte>(1 << (m_Position % 8));
+            }
+        }
+
+    private:
+        std::byte *m_Block;
+        uint32_t m_Position;
+    };
+
+    DEF encodeBlockRows(
+        const VkFormat format,
+        const uint8_t *rgba,
+        const uint32_t width,
+        const uint32_t height,
+        const uint32_t firstRow,
+        const uint32_t endRow,
+        std::byte *output) -> void {
+
+        const uint32_t blocksX = (width + 3) / 4;
+        const VkDeviceSize blockSize = BlockCompression::getBlockSize(format);
+        array<uint8_t, 64> block{};
+
+        for (uint32_t blockY = firstRow; blockY < endRow; blockY++) {
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+                // Blocks hanging over the edge repeat the last row and column
+                for (uint32_t y = 0; y < 4; y++) {
+                    const uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+                    for (uint32_t x = 0; x < 4; x++) {
+                        const uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+                        std::memcpy(&block[(y * 4 + x) * 4], rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+                    }
+                }
+
+                std::byte *destination = output + (static_cast<VkDeviceSize>(blockY) * blocksX + blockX) * blockSize;
+                switch (format) {
+                    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: BlockCompression::encodeBC1(block, destination); break;
+                    case VK_FORMAT_BC3_SRGB_BLOCK:
+                    case VK_FORMAT_BC3_UNORM_BLOCK: BlockCompression::encodeBC3(block, destination); break;
+                    case VK_FORMAT_BC5_UNORM_BLOCK: BlockCompression::encodeBC5(block, destination); break;
+                    default: BlockCompression::encodeBC7(block, destination); break;
+                }
+            }
+        }
+    }
+} // namespace
+
+DEF BlockCompression::getBlockSize(const VkFormat format) -> VkDeviceSize {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return 8;
+        default: return 16;
+    }
+}
+
+DEF BlockCompression::getCompressedSize(const VkFormat format, const uint32_t width, const uint32_t height) -> VkDeviceSize {
+    return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+DEF BlockCompression::isSupported(const VkFormat format) -> bool {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK: return true;
+        default: return false;
+    }
+}
+
+DEF BlockCompression::encodeBC1(const array<uint8_t, 64> &rgba, std::byte *block) -> void {
+    writeColorBlock(toPixels(rgba), block);
+}
+
+DEF BlockCompression::encodeBC3(const array<uint8_t, 64> &rgba, std::byte *block) -> void {
+    const Pixels pixels = toPixels(rgba);
+    writeChannelBlock(pixels, 3, block);
+    writeColorBlock(pixels, block + 8);
+}
+
+DEF BlockCompression::encodeBC5(const array<uint8_t, 64> &rgba, std::byte *block) -> void {
+    const Pixels pixels = toPixels(rgba);
+    writeChannelBlock(pixels, 0, block);
+    writeChannelBlock(pixels, 1, block + 8);
+}
+
+DEF BlockCompression::encodeBC7(const array<uint8_t, 64> &rgba, std::byte *block) -> void {
+    const Pixels pixels = toPixels(rgba);
+    Color low{};
+    Color high{};
+    fitEndpoints(pixels, 4, low, high);
+
+    array<array<uint8_t, 4>, 2> endpoints{};
+    array<uint8_t, 2> pBits{};
+    quantizeBC7Endpoint(low, endpoints[0], pBits[0]);
+    quantizeBC7Endpoint(high, endpoints[1], pBits[1]);
+
+    array<Color, 16> palette{};
+    for (uint32_t k = 0; k < 16; k++) {
+        for (int c = 0; c < 4; c++) {
+            const int endpoint0 = endpoints[0][c] << 1 | pBits[0];
+            const int endpoint1 = endpoints[1][c] << 1 | pBits[1];
+            palette[k][c] = static_cast<float>(((64 - BC7_WEIGHTS_4[k]) * endpoint0 + BC7_WEIGHTS_4[k] * endpoint1 + 32) >> 6);
+        }
+    }
+
+    array<uint32_t, 16> indices{};
+    for (uint32_t i = 0; i < 16; i++) {
+        float bestDistance = std::numeric_limits<float>::max();
+        for (uint32_t k = 0; k < 16; k++) {
+            const float distance = distanceSquared(pixels[i], palette[k], 4);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                indices[i] = k;
+            }
+        }
+    }
+
+    // The anchor index only stores 3 bits, its top bit has to be zero, which swapping the endpoints guarantees
+    if (indices[0] & 8) {
+        std::swap(endpoints[0], endpoints[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (uint32_t &index : indices) index = 15 - index;
+    }
+
+    BitWriter writer(block);
+    writer.write(1 << 6, 7); // Mode 6
+    for (int c = 0; c < 4; c++) {
+        writer.write(endpoints[0][c], 7);
+        writer.write(endpoints[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for (uint32_t i = 1; i < 16; i++) writer.write(indices[i], 4);
+}
+
+DEF BlockCompression::compress(
+    const VkFormat format,
+    const uint8_t *rgba,
+    const uint32_t width,
+    const uint32_t height,
+    std::byte *output,
+    ThreadPool &threadPool) -> void {
+
+    if (!isSupported(format)) throw runtime_error("BlockCompression doesn't support the requested format!");
+
+    // A few chunks per thread even out blocks that take longer, like the ones on busy parts of the image
+    const uint32_t blocksY = (height + 3) / 4;
+    const uint32_t chunkCount = std::min(blocksY, threadPool.getThreadCount() * 4);
+    const uint32_t rowsPerChunk = (blocksY + chunkCount - 1) / chunkCount;
+
+    vector<std::future<void>> chunks;
+    chunks.reserve(chunkCount);
+    for (uint32_t firstRow = 0; firstRow < blocksY; firstRow += rowsPerChunk) {
+        const uint32_t endRow = std::min(firstRow + rowsPerChunk, blocksY);
+        chunks.push_back(threadPool.enqueue([=] {
+            encodeBlockRows(format, rgba, width, height, firstRow, endRow, output);
+        }));
+    }
+    for (std::future<void> &chunk : chunks) chunk.wait();
+    for (std::future<void> &chunk : chunks) chunk.get();
+}
@@ -0,0 +1,346 @@
+#include "Constants.h"
+
+#include "engine/downsampler.h"
+#include "engine/engine.h"
+
+namespace {
+    // Have to match shaders/downsample.comp
+    constexpr uint32_t MAX_LEVELS_PER_DISPATCH = 12;
+    constexpr uint32_t TILE_SIZE = 64;
+    constexpr uint32_t TILE_LEVELS = 6;
+    constexpr uint32_t MAX_TAIL_GROUPS = 64;
+    constexpr VkDeviceSize TAIL_BUFFER_SIZE = 4 * sizeof(uint32_t) + MAX_TAIL_GROUPS * MAX_TAIL_GROUPS * 4 * sizeof(float);
+
+    struct PushConstants {
+        int32_t sourceWidth;
+        int32_t sourceHeight;
+        int32_t groupCountX;
+        int32_t groupCountY;
+        int32_t levelCount;
+    };
+
+    struct Dispatch {
+        uint32_t sourceLevel;
+        uint32_t levelCount;
+    };
+} // namespace
+
+Downsampler::Downsampler(Engine *engine, VkShaderModule shaderModule, VkPipelineCache pipelineCache)
+    : m_Engine(engine),
+      m_DescriptorSetLayout(VK_NULL_HANDLE),
+      m_PipelineLayout(VK_NULL_HANDLE),
+      m_Pipeline(VK_NULL_HANDLE),
+      m_Sampler(VK_NULL_HANDLE),
+      m_TailBuffer(VK_NULL_HANDLE),
+      m_TailBufferMemory(VK_NULL_HANDLE) {
+    m_Device = m_Engine->getDevice();
+    m_PhysicalDevice = m_Engine->getPhysicalDevice();
+    if (m_Device == VK_NULL_HANDLE) throw runtime_error("Initializing downsampler before engine device got initialized!");
+
+    const array bindings = {
+        VkDescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+        VkDescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = MAX_LEVELS_PER_DISPATCH,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+        VkDescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT}};
+    const VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()};
+    VulkanObjectCache *objectCache = m_Engine->getObjectCache();
+    m_DescriptorSetLayout = objectCache->getDescriptorSetLayout(layoutInfo);
+
+    const VkPushConstantRange pushConstantRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants)};
+    const VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_DescriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange};
+    m_PipelineLayout = objectCache->getPipelineLayout(pipelineLayoutInfo);
+
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shaderModule,
+            .pName = "main"},
+        .layout = m_PipelineLayout};
+    if (vkCreateComputePipelines(m_Device, pipelineCache, 1, &pipelineInfo, nullptr, &m_Pipeline) != VK_SUCCESS) {
+        throw runtime_error("failed to create downsampler pipeline!");
+    }
+
+    const VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod = 0.0f};
+    m_Sampler = objectCache->getSampler(samplerInfo);
+
+    m_Engine->createBuffer(
+        TAIL_BUFFER_SIZE,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_TailBuffer,
+        m_TailBufferMemory,
+        MemoryCategory::Other);
+}
+
+Downsampler::~Downsampler() {
+    reset();
+    vkDestroyBuffer(m_Device, m_TailBuffer, nullptr);
+    m_Engine->freeMemory(m_TailBufferMemory);
+    // Layouts and the sampler belong to the engine's object cache
+    vkDestroyPipeline(m_Device, m_Pipeline, nullptr);
+}
+
+DEF Downsampler::isFormatSupported(const VkFormat format) const -> bool {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &formatProperties);
+    constexpr VkFormatFeatureFlags required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    return (formatProperties.optimalTilingFeatures & required) == required;
+}
+
+DEF Downsampler::record(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    const VkFormat format,
+    const uint32_t width,
+    const uint32_t height,
+    const uint32_t mipLevels,
+    const VkImageLayout baseLayout) -> uint32_t {
+
+    if (!isFormatSupported(format)) throw runtime_error("image format can't be used as a storage image for downsampling!");
+    if (mipLevels > static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1) {
+        throw runtime_error("image has more mip levels than its size allows!");
+    }
+
+    // The last group only reduces a 64x64 grid of tiles, larger sources first go down six levels on their own
+    vector<Dispatch> dispatches;
+    for (uint32_t sourceLevel = 0; sourceLevel + 1 < mipLevels;) {
+        uint32_t levelCount = std::min(mipLevels - 1 - sourceLevel, MAX_LEVELS_PER_DISPATCH);
+        if (std::max(width >> sourceLevel, height >> sourceLevel) > TILE_SIZE * MAX_TAIL_GROUPS) levelCount = std::min(levelCount, TILE_LEVELS);
+        dispatches.push_back(Dispatch{sourceLevel, levelCount});
+        sourceLevel += levelCount;
+    }
+
+    Resources &resources = m_Pending.emplace_back(Resources{VK_NULL_HANDLE, {}});
+    if (!dispatches.empty()) {
+        const array poolSizes = {
+            VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(dispatches.size())},
+            VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, static_cast<uint32_t>(dispatches.size()) * MAX_LEVELS_PER_DISPATCH},
+            VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(dispatches.size())}};
+        const VkDescriptorPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .maxSets = static_cast<uint32_t>(dispatches.size()),
+            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data()};
+        if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &resources.descriptorPool) != VK_SUCCESS) {
+            throw runtime_error("failed to create downsampler descriptor pool!");
+        }
+    }
+
+    // One view per level serves as storage target of one dispatch and as sampled source of the next
+    for (uint32_t level = 0; level < mipLevels; level++) resources.views.push_back(createImageView(image, format, level));
+
+    vector<VkDescriptorSet> descriptorSets(dispatches.size());
+    const vector<VkDescriptorSetLayout> setLayouts(dispatches.size(), m_DescriptorSetLayout);
+    if (!dispatches.empty()) {
+        const VkDescriptorSetAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = resources.descriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data()};
+        if (vkAllocateDescriptorSets(m_Device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+            throw runtime_error("failed to allocate downsampler descriptor sets!");
+        }
+    }
+
+    const VkDescriptorBufferInfo tailInfo{.buffer = m_TailBuffer, .offset = 0, .range = TAIL_BUFFER_SIZE};
+    for (size_t i = 0; i < dispatches.size(); i++) {
+        const Dispatch &dispatch = dispatches[i];
+        const VkDescriptorImageInfo sourceInfo{
+            .sampler = m_Sampler,
+            .imageView = resources.views[dispatch.sourceLevel],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+        // Slots past the last level still need a valid view, the shader never writes them
+        array<VkDescriptorImageInfo, MAX_LEVELS_PER_DISPATCH> levelInfos{};
+        for (uint32_t slot = 0; slot < MAX_LEVELS_PER_DISPATCH; slot++) {
+            const uint32_t level = dispatch.sourceLevel + 1 + std::min(slot, dispatch.levelCount - 1);
+            levelInfos[slot] = VkDescriptorImageInfo{
+                .sampler = VK_NULL_HANDLE,
+                .imageView = resources.views[level],
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+        }
+
+        const array writes = {
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &sourceInfo},
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = 1,
+                .descriptorCount = MAX_LEVELS_PER_DISPATCH,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = levelInfos.data()},
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSets[i],
+                .dstBinding = 2,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &tailInfo}};
+        vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    // Everything goes to GENERAL, the level being read by one dispatch was written as storage image by the one before.
+    // The global barrier also orders the counter reset after earlier dispatches that used the tail buffer.
+    const VkMemoryBarrier beforeReset{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    const array toGeneral = {
+        VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = baseLayout,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1}},
+        VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 1, .levelCount = mipLevels - 1, .baseArrayLayer = 0, .layerCount = 1}}};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &beforeReset,
+        0, nullptr,
+        mipLevels > 1 ? 2 : 1, toGeneral.data());
+
+    // The shader resets the counter itself, clearing it here covers dispatches that never ran to the end
+    vkCmdFillBuffer(commandBuffer, m_TailBuffer, 0, sizeof(uint32_t), 0);
+    const VkBufferMemoryBarrier afterReset{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = m_TailBuffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        1, &afterReset,
+        0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+    for (size_t i = 0; i < dispatches.size(); i++) {
+        const Dispatch &dispatch = dispatches[i];
+        if (i > 0) {
+            const VkMemoryBarrier betweenDispatches{
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &betweenDispatches,
+                0, nullptr,
+                0, nullptr);
+        }
+
+        const uint32_t sourceWidth = std::max(width >> dispatch.sourceLevel, 1u);
+        const uint32_t sourceHeight = std::max(height >> dispatch.sourceLevel, 1u);
+        const PushConstants pushConstants{
+            .sourceWidth = static_cast<int32_t>(sourceWidth),
+            .sourceHeight = static_cast<int32_t>(sourceHeight),
+            .groupCountX = static_cast<int32_t>((sourceWidth + TILE_SIZE - 1) / TILE_SIZE),
+            .groupCountY = static_cast<int32_t>((sourceHeight + TILE_SIZE - 1) / TILE_SIZE),
+            .levelCount = static_cast<int32_t>(dispatch.levelCount)};
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, static_cast<uint32_t>(pushConstants.groupCountX), static_cast<uint32_t>(pushConstants.groupCountY), 1);
+    }
+
+    const VkImageMemoryBarrier toShaderRead{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = mipLevels, .baseArrayLayer = 0, .layerCount = 1}};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &toShaderRead);
+
+    return static_cast<uint32_t>(dispatches.size());
+}
+
+DEF Downsampler::reset() -> void {
+    for (const Resources &resources : m_Pending) {
+        for (VkImageView view : resources.views) vkDestroyImageView(m_Device, view, nullptr);
+        // Frees the descriptor sets along with it
+        vkDestroyDescriptorPool(m_Device, resources.descriptorPool, nullptr);
+    }
+    m_Pending.clear();
+}
+
+DEF Downsampler::createImageView(VkImage image, const VkFormat format, const uint32_t level) const -> VkImageView {
+    const VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = level, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1}};
+
+    VkImageView imageView = VK_NULL_HANDLE;
+    if (vkCreateImageView(m_Device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+        throw runtime_error("failed to create downsampler image view!");
+    }
+    return imageView;
+}
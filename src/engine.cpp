@@ -12,6 +12,9 @@ const vector validationLayers = {"VK_LAYER_KHRONOS_validation"};
 // VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME is a MacOS specific workaround
 const vector deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME};
 
+static_assert(Settings::FRAMES_IN_FLIGHT >= 1 && Settings::FRAMES_IN_FLIGHT <= Settings::MAX_FRAMES_IN_FLIGHT,
+              "The initial frames in flight have to be within the per-frame resources");
+
 #ifdef NDEBUG
 constexpr bool enableValidationLayers = false;
 #else
@@ -62,20 +65,44 @@ Engine::Engine()
       m_SwapChain(VK_NULL_HANDLE),
       m_SwapChainImageFormat(VK_FORMAT_UNDEFINED),
       m_SwapChainExtent({.width = 0, .height = 0}),
+      m_SupportsMemoryBudget(false),
       m_RenderPass(VK_NULL_HANDLE),
       m_DescriptorSetLayout(VK_NULL_HANDLE),
       m_PipelineLayout(VK_NULL_HANDLE),
       m_GraphicsPipeline(VK_NULL_HANDLE),
-      m_CommandPool(VK_NULL_HANDLE), // Not the total frames, 0 <= m_CurrentFrameIdx < Settings::MAX_FRAMES_IN_FLIGHT
-      m_CurrentFrameIdx(0),
+      m_StageVertShaderModule(VK_NULL_HANDLE),
+      m_StageFragShaderModule(VK_NULL_HANDLE),
+      m_PipelineCache(VK_NULL_HANDLE),
+      m_PipelineCacheWarm(false),
+      m_CommandPool(VK_NULL_HANDLE),
+      m_FrameTimeline(VK_NULL_HANDLE),
+      m_FrameIdxFrames{},
+      m_CompletedFrame(0),
+      m_FramesInFlight(Settings::FRAMES_IN_FLIGHT),
+      m_UseTimelineSemaphore(Settings::USE_TIMELINE_SEMAPHORE),
+      m_LastFrameWaitMs(0.0),
+      m_CurrentFrameIdx(0), // Not the total frames, 0 <= m_CurrentFrameIdx < m_FramesInFlight
       m_FrameCounter(0),
       m_FramebufferResized(false),
+      m_FrameArena(Settings::FRAME_ARENA_CAPACITY),
       m_DescriptorPool(VK_NULL_HANDLE),
-      m_MipLevels(1),
-      m_TextureImage(VK_NULL_HANDLE),
-      m_TextureImageMemory(VK_NULL_HANDLE),
-      m_TextureImageView(VK_NULL_HANDLE),
+      m_DescriptorSet(VK_NULL_HANDLE),
+      m_DynamicOffsets{},
+      m_RecordingThreadCount(1),
+      m_CacheCommandBuffers(Settings::CACHE_COMMAND_BUFFERS),
+      m_CachedFrameCount(0),
+      m_RecordedFrameCount(0),
+      m_RecordTotalMs(0.0),
+      m_TextureTableLayout(VK_NULL_HANDLE),
+      m_TextureTablePool(VK_NULL_HANDLE),
+      m_TextureTables(),
+      m_TextureTableCapacity(0),
       m_TextureSampler(VK_NULL_HANDLE),
+      m_VirtualTextureLayout(VK_NULL_HANDLE),
+      m_CompressTextures(false),
+      m_SupportsTextureCompression(false),
+      m_CpuMipmaps(Settings::GENERATE_MIPMAPS_ON_CPU),
+      m_SupportsComputeMipmaps(false),
       m_MSAASamples(VK_SAMPLE_COUNT_1_BIT),
       m_ColorImage(VK_NULL_HANDLE),
       m_ColorImageMemory(VK_NULL_HANDLE),
@@ -86,8 +113,16 @@ Engine::Engine()
       m_TakeScreenshotNextFrame(false),
       m_EngineVersion(VK_MAKE_VERSION(1, 0, 0)),
       m_ApplicationVersion(VK_MAKE_VERSION(1, 0, 0)),
-      m_Stage(Settings::STARTING_STAGE),
-      m_PushConstants() {
+      m_UseInstancing(Settings::USE_INSTANCING),
+      m_UseIndirectDraws(false),
+      m_SupportsIndirectDraws(false),
+      m_SupportsMultiDrawIndirect(false),
+      m_MaxDrawIndirectCount(1),
+      m_IndirectCommands(),
+      m_BenchmarkInstanceCount(0),
+      m_BenchmarkMesh(nullptr),
+      m_LastRecordTimeMs(0.0),
+      m_Stage(Settings::STARTING_STAGE) {
     m_StartTime = std::chrono::high_resolution_clock::now();
 }
 
@@ -116,8 +151,7 @@ DEF Engine::initWindow() -> void {
 
     // GLFW defaults to creating OpenGL context otherwise
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    // Disables window resizing
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, Settings::WINDOW_RESIZABLE ? GLFW_TRUE : GLFW_FALSE);
 
     m_Window = glfwCreateWindow(
         Settings::DEFAULT_WINDOW_WIDTH,
@@ -224,6 +258,9 @@ DEF Engine::initVulkan() -> void {
     PRINT_BOLD_GREEN("Physical and Logical Device Setup");
     VULKAN_SETUP(pickPhysicalDevice);
     VULKAN_SETUP(createLogicalDevice);
+    VULKAN_SETUP(createMemoryTracker);
+    VULKAN_SETUP(createObjectCache);
+    VULKAN_SETUP(createStagingPool);
 
     PRINT_BOLD_GREEN("Swap Chain Setup");
     VULKAN_SETUP(createSwapChain);
@@ -232,6 +269,8 @@ DEF Engine::initVulkan() -> void {
     PRINT_BOLD_GREEN("Render Pass and Pipeline Setup");
     VULKAN_SETUP(createRenderPass);
     VULKAN_SETUP(createDescriptorSetLayout);
+    VULKAN_SETUP(createPipelineCache);
+    VULKAN_SETUP(loadShaderBundle);
     VULKAN_SETUP(createGraphicsPipeline);
 
     VULKAN_SETUP(createCommandPool);
@@ -239,9 +278,17 @@ DEF Engine::initVulkan() -> void {
     VULKAN_SETUP(createDepthResources);
     VULKAN_SETUP(createFramebuffers);
 
-    VULKAN_SETUP(createTextureImage);
-    VULKAN_SETUP(createTextureImageView);
     VULKAN_SETUP(createTextureSampler);
+    VULKAN_SETUP(createTextureTable);
+    VULKAN_SETUP(createDownsampler);
+
+    VULKAN_SETUP(createThreadPool);
+    VULKAN_SETUP(createTextureManager);
+    VULKAN_SETUP(createVirtualTextureCache);
+    constexpr array materialTextures = {FilePaths::PAINTED_PLASTER_DIFFUSE, FilePaths::METAL_DIFFUSE};
+    const vector<uint32_t> materialSlots = registerTextures(materialTextures);
+    const uint32_t plasterMaterial = materialSlots[0];
+    const uint32_t metalMaterial = materialSlots[1];
 
     cout << "Instantiating Models!\n";
     Transform torusTransform{
@@ -250,16 +297,19 @@ DEF Engine::initVulkan() -> void {
         vec3(1.0f, 1.0f, 1.0f)};
     auto torusModel = std::make_unique<ModelNT>(this, FilePaths::MODEL_BASIC_TORUS, m_Models.size(), torusTransform);
     torusModel->setRotationAnimationVector(vec3(1.0f, 0.5f, 0.0f));
+    torusModel->setMaterialID(plasterMaterial);
     m_Models.push_back(std::move(torusModel));
 
     Transform sphereTransform{
         vec3(3.0f, 0.0f, 0.0f),
         vec3(0.0f, 0.0f, 0.0f),
         vec3(1.0f, 1.0f, 1.0f)};
-    m_Models.push_back(std::make_unique<ModelNT>(this, FilePaths::MODEL_BASIC_SPHERE, m_Models.size(), sphereTransform));
+    auto sphereModel = std::make_unique<ModelNT>(this, FilePaths::MODEL_BASIC_SPHERE, m_Models.size(), sphereTransform);
+    sphereModel->setMaterialID(metalMaterial);
+    m_Models.push_back(std::move(sphereModel));
     cout << "Successfully instantiated Models!\n";
 
-    VULKAN_SETUP(createUniformBuffers);
+    VULKAN_SETUP(createFrameAllocator);
 
     PRINT_BOLD_GREEN("Descriptor Pool and Sets Setup");
     VULKAN_SETUP(createDescriptorPool);
@@ -267,6 +317,7 @@ DEF Engine::initVulkan() -> void {
 
     PRINT_BOLD_GREEN("Command Buffers and Sync Objects Setup");
     VULKAN_SETUP(createCommandBuffers);
+    VULKAN_SETUP(createRecordingContexts);
     VULKAN_SETUP(createSyncObjects);
 
     PRINT_BOLD_GREEN("* * * * * * * * * * * * * * * * * *");
@@ -325,7 +376,8 @@ DEF Engine::createDepthResources() -> void {
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         m_DepthImage,
-        m_DepthImageMemory);
+        m_DepthImageMemory,
+        MemoryCategory::Attachments);
     m_DepthImageView = createImageView(m_DepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
@@ -342,7 +394,8 @@ DEF Engine::createColorResources() -> void {
         VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         m_ColorImage,
-        m_ColorImageMemory);
+        m_ColorImageMemory,
+        MemoryCategory::Attachments);
     m_ColorImageView = createImageView(m_ColorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
 
@@ -356,7 +409,8 @@ DEF Engine::createImage(
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory
+    VkDeviceMemory &imageMemory,
+    const MemoryCategory category
 ) -> void {
     const VkImageCreateInfo imageInfo{
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -386,6 +440,7 @@ DEF Engine::createImage(
     if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
         throw runtime_error("failed to allocate image memory!");
     }
+    m_MemoryTracker->onAllocate(imageMemory, memRequirements.size, allocInfo.memoryTypeIndex, category);
 
     vkBindImageMemory(m_Device, image, imageMemory, 0);
 }
@@ -412,68 +467,331 @@ DEF Engine::createImageView(VkImage image, VkFormat format, VkImageAspectFlags a
     return imageView;
 }
 
-DEF Engine::createTextureImage() -> void {
-    if (!std::filesystem::exists(FilePaths::PAINTED_PLASTER_DIFFUSE)) {
-        throw runtime_error("Texture file not found: " + std::string(FilePaths::PAINTED_PLASTER_DIFFUSE));
+DEF Engine::registerTexture(const char *textureFilepath, const TextureUsage usage) -> uint32_t {
+    return registerTextures(std::span(&textureFilepath, 1), usage).front();
+}
+
+DEF Engine::registerTextures(const std::span<const char *const> textureFilepaths, const TextureUsage usage) -> vector<uint32_t> {
+    vector<uint32_t> slots(textureFilepaths.size());
+    for (size_t i = 0; i < textureFilepaths.size(); i++) slots[i] = m_TextureManager->acquire(textureFilepaths[i], usage);
+    m_TextureManager->waitForLoads();
+
+    for (size_t i = 0; i < textureFilepaths.size(); i++) {
+        fprintf(stdout, "\tRegistered texture '%s' in slot %u.\n", textureFilepaths[i], slots[i]);
     }
+    return slots;
+}
 
-    int texWidth = 0;
-    int texHeight = 0;
-    int texChannels = 0;
-    stbi_uc *pixels = stbi_load(FilePaths::PAINTED_PLASTER_DIFFUSE, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if (!pixels) throw runtime_error("failed to load texture image!");
-    VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
+DEF Engine::setTextureCompression(const bool compressTextures) -> void {
+    if (compressTextures && !m_SupportsTextureCompression) {
+        fprintf(stderr, "Texture compression needs textureCompressionBC, which the device doesn't support, keeping RGBA8 textures.\n");
+        m_CompressTextures = false;
+        return;
+    }
+    m_CompressTextures = compressTextures;
+}
 
-    // m_MipLevels = How often we can divide max(width, height) by 2, could also take the ceil here instead of floor + 1
-    m_MipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+DEF Engine::loadTextures(const std::span<const char *const> textureFilepaths, const TextureUsage usage) -> vector<Texture> {
+    const auto loadStart = std::chrono::high_resolution_clock::now();
+    StagedTextures staged = stageTextures(textureFilepaths, usage, m_CompressTextures, m_CpuMipmaps);
+    const auto decodeEnd = std::chrono::high_resolution_clock::now();
 
-    VkBuffer stagingBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-    createBuffer(
-        imageSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory);
+    vector<double> uploadMs;
+    const vector<Texture> textures = uploadTextures(staged, uploadMs);
+    const auto loadEnd = std::chrono::high_resolution_clock::now();
 
-    void *data = nullptr;
-    vkMapMemory(m_Device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, imageSize);
-    vkUnmapMemory(m_Device, stagingBufferMemory);
+    const vector<TextureLoader::Image> &images = staged.loader->getImages();
+    const double decodeWallMs = std::chrono::duration<double, std::milli>(decodeEnd - loadStart).count();
+    const double uploadWallMs = std::chrono::duration<double, std::milli>(loadEnd - decodeEnd).count();
+    const double totalMs = std::chrono::duration<double, std::milli>(loadEnd - loadStart).count();
+    const double stagingMB = static_cast<double>(staged.loader->getStagingSize()) / (1024.0 * 1024.0);
+    for (size_t i = 0; i < images.size(); i++) {
+        const char *source = !images[i].compressed ? "decoded" : images[i].cached ? "cached" : "cooked";
+        const char *mipSource = images[i].levels.size() == textures[i].mipLevels ? "CPU" : "blit";
+        fprintf(stdout, "\tLoaded texture '%s' (%s, %s, %s mips): %ux%u, %u mips, %.2f MB VRAM, decode %.2f ms, mips %.2f ms, cook %.2f ms, staging write %.2f ms, upload %.2f ms\n",
+                images[i].filepath.c_str(), TextureLoader::getFormatName(images[i].format), source, mipSource,
+                images[i].width, images[i].height, textures[i].mipLevels,
+                static_cast<double>(textures[i].memorySize) / (1024.0 * 1024.0),
+                images[i].decodeMs, images[i].mipMs, images[i].cookMs, images[i].stagingWriteMs, uploadMs[i]);
+    }
+    fprintf(stdout, "\tLoaded %zu textures on %u threads in %.2f ms (decode %.2f ms, upload %.2f ms), %.2f MB at %.1f MB/s\n",
+            images.size(), m_TexturePool->getThreadCount(), totalMs, decodeWallMs, uploadWallMs, stagingMB, stagingMB / (totalMs / 1000.0));
 
-    stbi_image_free(pixels);
+    return textures;
+}
 
-    createImage(
-        texWidth,
-        texHeight,
-        m_MipLevels,
-        VK_SAMPLE_COUNT_1_BIT,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        m_TextureImage,
-        m_TextureImageMemory);
-    transitionImageLayout(
-        m_TextureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        m_MipLevels);
-    copyBufferToImage(
-        stagingBuffer,
-        m_TextureImage,
-        static_cast<uint32_t>(texWidth),
-        static_cast<uint32_t>(texHeight));
+DEF Engine::stageTextures(
+    const std::span<const char *const> textureFilepaths,
+    const TextureUsage usage,
+    const bool compress,
+    const bool cpuMipmaps) const -> StagedTextures {
+
+    // Blitting needs linear filtering support for the format, without it the CPU has to build the mips
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(
+        m_PhysicalDevice,
+        usage == TextureUsage::NormalMap ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB,
+        &formatProperties);
+    const bool canBlitMipmaps = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    StagedTextures staged{
+        .loader = std::make_unique<TextureLoader>(m_TexturePool.get()),
+        .staging = {.buffer = VK_NULL_HANDLE, .memory = VK_NULL_HANDLE, .mapped = nullptr, .size = 0}};
+    const VkDeviceSize stagingSize = staged.loader->plan(textureFilepaths, usage, compress, cpuMipmaps || !canBlitMipmaps);
+
+    // Decode everything straight into one mapped staging buffer, the workers write disjoint slices of it
+    staged.staging = m_StagingPool->acquire(stagingSize);
+    try {
+        staged.loader->decodeInto(staged.staging.mapped);
+    } catch (...) {
+        m_StagingPool->release(staged.staging);
+        throw;
+    }
+    return staged;
+}
+
+DEF Engine::uploadTextures(StagedTextures &staged, vector<double> &uploadMs) -> vector<Texture> {
+    const vector<TextureLoader::Image> &images = staged.loader->getImages();
+
+    // A timestamp before the first and after every texture's commands gives the GPU time each upload took
+    const QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_PhysicalDevice);
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
+    vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
+    const bool useTimestamps = queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits > 0;
+
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    const auto timestampCount = static_cast<uint32_t>(images.size() + 1);
+    if (useTimestamps) {
+        const VkQueryPoolCreateInfo queryPoolInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = timestampCount};
+        if (vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+            throw runtime_error("failed to create texture upload query pool!");
+        }
+    }
+
+    // Layout transitions, copies and mip chains of every texture go into a single submission
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    const vector<Texture> textures = recordTextureUploads(commandBuffer, staged, timestampPool);
+    endSingleTimeCommands(commandBuffer);
+
+    m_StagingPool->release(staged.staging);
+    staged.staging = StagingBuffer{.buffer = VK_NULL_HANDLE, .memory = VK_NULL_HANDLE, .mapped = nullptr, .size = 0};
+
+    uploadMs.assign(images.size(), 0.0);
+    if (useTimestamps) {
+        vector<uint64_t> timestamps(timestampCount);
+        vkGetQueryPoolResults(
+            m_Device,
+            timestampPool,
+            0,
+            timestampCount,
+            timestamps.size() * sizeof(uint64_t),
+            timestamps.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        vkDestroyQueryPool(m_Device, timestampPool, nullptr);
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+        for (size_t i = 0; i < images.size(); i++) {
+            uploadMs[i] = static_cast<double>(timestamps[i + 1] - timestamps[i]) * properties.limits.timestampPeriod / 1e6;
+        }
+    }
+    return textures;
+}
+
+DEF Engine::recordTextureUploads(VkCommandBuffer commandBuffer, const StagedTextures &staged, VkQueryPool timestampPool) -> vector<Texture> {
+    const vector<TextureLoader::Image> &images = staged.loader->getImages();
+    VkBuffer stagingBuffer = staged.staging.buffer;
+
+    vector<Texture> textures(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        textures[i].format = images[i].format;
+        textures[i].width = images[i].width;
+        textures[i].height = images[i].height;
+        textures[i].mipLevels = images[i].mipLevels;
+        // Every texture can be a copy source, which the texture manager needs to move mips into a smaller image
+        const VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        createImage(
+            images[i].width,
+            images[i].height,
+            textures[i].mipLevels,
+            VK_SAMPLE_COUNT_1_BIT,
+            textures[i].format,
+            VK_IMAGE_TILING_OPTIMAL,
+            imageUsage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            textures[i].image,
+            textures[i].memory,
+            MemoryCategory::Textures);
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(m_Device, textures[i].image, &memRequirements);
+        textures[i].memorySize = memRequirements.size;
+    }
+
+    if (timestampPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, timestampPool, 0, static_cast<uint32_t>(images.size() + 1));
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, 0);
+    }
+
+    vector<VkImageMemoryBarrier> toTransferDst(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        toTransferDst[i] = VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = textures[i].image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = textures[i].mipLevels,
+                .baseArrayLayer = 0,
+                .layerCount = 1}};
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(toTransferDst.size()), toTransferDst.data());
+
+    for (size_t i = 0; i < images.size(); i++) {
+        vector<VkBufferImageCopy> regions;
+        regions.reserve(images[i].levels.size());
+        for (uint32_t level = 0; level < images[i].levels.size(); level++) {
+            const TextureLoader::Level &source = images[i].levels[level];
+            regions.push_back(VkBufferImageCopy{
+                .bufferOffset = source.stagingOffset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .baseArrayLayer = 0, .layerCount = 1},
+                .imageOffset = {.x = 0, .y = 0, .z = 0},
+                .imageExtent = {.width = source.width, .height = source.height, .depth = 1}});
+        }
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            stagingBuffer,
+            textures[i].image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
+
+        if (images[i].levels.size() == textures[i].mipLevels) {
+            const VkImageMemoryBarrier toShaderRead{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = textures[i].image,
+                .subresourceRange = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = textures[i].mipLevels,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1}};
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &toShaderRead);
+        } else {
+            generateMipmaps(
+                commandBuffer,
+                textures[i].image,
+                textures[i].format,
+                static_cast<int32_t>(images[i].width),
+                static_cast<int32_t>(images[i].height),
+                textures[i].mipLevels);
+        }
 
-    vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-    vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+        if (timestampPool != VK_NULL_HANDLE) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, static_cast<uint32_t>(i + 1));
+        }
+    }
+
+    for (Texture &texture : textures) {
+        texture.view = createImageView(texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
+    }
 
-    generateMipmaps(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, m_MipLevels);
+    return textures;
 }
 
-DEF Engine::createTextureImageView() -> void {
-    m_TextureImageView = createImageView(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLevels);
+DEF Engine::destroyTexture(const Texture &texture) const -> void {
+    vkDestroyImageView(m_Device, texture.view, nullptr);
+    vkDestroyImage(m_Device, texture.image, nullptr);
+    freeMemory(texture.memory);
+}
+
+DEF Engine::readTextureLevel(const Texture &texture, const uint32_t level, const uint32_t width, const uint32_t height) const -> vector<uint8_t> {
+    const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+    const StagingBuffer readback = m_StagingPool->acquire(size);
+
+    VkImageMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture.image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1}};
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    const VkBufferImageCopy region{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .baseArrayLayer = 0, .layerCount = 1},
+        .imageOffset = {.x = 0, .y = 0, .z = 0},
+        .imageExtent = {.width = width, .height = height, .depth = 1}};
+    vkCmdCopyImageToBuffer(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+    endSingleTimeCommands(commandBuffer);
+
+    vector<uint8_t> pixels(size);
+    memcpy(pixels.data(), readback.mapped, size);
+    m_StagingPool->release(readback);
+    return pixels;
 }
 
 DEF Engine::createTextureSampler() -> void {
@@ -494,16 +812,14 @@ DEF Engine::createTextureSampler() -> void {
         .compareEnable = VK_FALSE,
         .compareOp = VK_COMPARE_OP_ALWAYS,
         .minLod = 0,
-        .maxLod = static_cast<float>(m_MipLevels),
+        .maxLod = VK_LOD_CLAMP_NONE, // The sampler is shared by textures with different mip counts
         .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
         .unnormalizedCoordinates = VK_FALSE};
 
-    if (vkCreateSampler(m_Device, &samplerInfo, nullptr, &m_TextureSampler) != VK_SUCCESS) {
-        throw runtime_error("failed to create texture sampler!");
-    }
+    m_TextureSampler = m_ObjectCache->getSampler(samplerInfo);
 }
 
-DEF Engine::generateMipmaps(VkImage image, VkFormat imageFormat, const int32_t texWidth, const int32_t texHeight, const uint32_t mipLevels) -> void {
+DEF Engine::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, const int32_t texWidth, const int32_t texHeight, const uint32_t mipLevels) const -> void {
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, imageFormat, &formatProperties);
 
@@ -511,7 +827,6 @@ DEF Engine::generateMipmaps(VkImage image, VkFormat imageFormat, const int32_t t
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
 
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
     VkImageMemoryBarrier barrier{
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
@@ -611,8 +926,6 @@ DEF Engine::generateMipmaps(VkImage image, VkFormat imageFormat, const int32_t t
         nullptr,
         1,
         &barrier);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
 DEF Engine::getMaxUsableSampleCount() const -> VkSampleCountFlagBits {
@@ -663,141 +976,280 @@ DEF Engine::endSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void {
     vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
 }
 
-void Engine::createDescriptorSets() {
-    const size_t numModels = m_Models.size();
-    const size_t totalSets = Settings::MAX_FRAMES_IN_FLIGHT * numModels;
+DEF Engine::submitSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void {
+    vkEndCommandBuffer(commandBuffer);
 
-    std::vector layouts(totalSets, m_DescriptorSetLayout);
+    const VkSubmitInfo submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer};
+    if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw runtime_error("failed to submit single time command buffer!");
+    }
+}
+
+DEF Engine::freeSingleTimeCommands(VkCommandBuffer commandBuffer) const -> void {
+    vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
+}
+
+void Engine::createDescriptorSets() {
+    // Both buffer bindings are dynamic, the per-frame offsets into the frame allocator are supplied when binding.
+    // A single set therefore serves every frame in flight and every model, and never has to be rewritten.
     const VkDescriptorSetAllocateInfo allocInfo{
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
         .descriptorPool = m_DescriptorPool,
-        .descriptorSetCount = static_cast<uint32_t>(totalSets),
-        .pSetLayouts = layouts.data()};
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_DescriptorSetLayout};
 
-    m_DescriptorSets.resize(totalSets);
-    if (vkAllocateDescriptorSets(m_Device, &allocInfo, m_DescriptorSets.data()) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(m_Device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
-    for (size_t i = 0; i < Settings::MAX_FRAMES_IN_FLIGHT; i++) {
-        for (size_t j = 0; j < numModels; j++) {
-            const size_t bufferIndex = i * numModels + j;
-            VkDescriptorBufferInfo bufferInfo{
-                .buffer = m_UniformBuffers[bufferIndex],
-                .offset = 0,
-                .range = sizeof(UniformBufferObject)};
-
-            VkDescriptorImageInfo imageInfo{
-                .sampler = m_TextureSampler,
-                .imageView = m_TextureImageView,
-                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-
-            std::array descriptorWrites{
-                VkWriteDescriptorSet{
-                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                    .dstSet = m_DescriptorSets[bufferIndex],
-                    .dstBinding = 0,
-                    .dstArrayElement = 0,
-                    .descriptorCount = 1,
-                    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    .pBufferInfo = &bufferInfo},
-                VkWriteDescriptorSet{
-                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                    .dstSet = m_DescriptorSets[bufferIndex],
-                    .dstBinding = 1,
-                    .dstArrayElement = 0,
-                    .descriptorCount = 1,
-                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    .pImageInfo = &imageInfo}};
-
-            vkUpdateDescriptorSets(
-                m_Device,
-                descriptorWrites.size(),
-                descriptorWrites.data(),
-                0,
-                nullptr);
-        }
-    }
+    VkDescriptorBufferInfo cameraBufferInfo{
+        .buffer = m_FrameAllocator->getBuffer(),
+        .offset = 0,
+        .range = sizeof(CameraUBO)};
+
+    // The range is static for every dynamic offset, so it has to cover the largest object array we ever bind
+    VkDescriptorBufferInfo objectBufferInfo{
+        .buffer = m_FrameAllocator->getBuffer(),
+        .offset = 0,
+        .range = sizeof(ObjectData) * Settings::MAX_OBJECTS};
+
+    std::array descriptorWrites{
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = m_DescriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .pBufferInfo = &cameraBufferInfo},
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = m_DescriptorSet,
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            .pBufferInfo = &objectBufferInfo}};
+
+    vkUpdateDescriptorSets(
+        m_Device,
+        descriptorWrites.size(),
+        descriptorWrites.data(),
+        0,
+        nullptr);
 }
 
 void Engine::createDescriptorPool() {
-    const size_t numModels = m_Models.size();
-    const size_t totalSets = Settings::MAX_FRAMES_IN_FLIGHT * numModels;
-
+    // Independent of the number of models and frames in flight, see createDescriptorSets
     std::array poolSizes{
         VkDescriptorPoolSize{
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = static_cast<uint32_t>(totalSets)},
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = 1},
         VkDescriptorPoolSize{
-            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = static_cast<uint32_t>(totalSets)}};
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            .descriptorCount = 1}};
 
     VkDescriptorPoolCreateInfo poolInfo{
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
         .pPoolSizes = poolSizes.data(),
-        .maxSets = static_cast<uint32_t>(totalSets)};
+        .maxSets = 1};
 
     if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
     }
 }
 
-void Engine::createUniformBuffers() {
-    const size_t numModels = m_Models.size();
-    const size_t totalBuffers = Settings::MAX_FRAMES_IN_FLIGHT * numModels;
-
-    m_UniformBuffers.resize(totalBuffers);
-    m_UniformBuffersMemory.resize(totalBuffers);
-    m_UniformBuffersMapped.resize(totalBuffers);
-
-    for (size_t i = 0; i < Settings::MAX_FRAMES_IN_FLIGHT; i++) {
-        for (size_t j = 0; j < numModels; j++) {
-            constexpr VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-            const size_t bufferIndex = i * numModels + j;
-            createBuffer(
-                bufferSize,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                m_UniformBuffers[bufferIndex],
-                m_UniformBuffersMemory[bufferIndex]);
-
-            if (vkMapMemory(
-                    m_Device,
-                    m_UniformBuffersMemory[bufferIndex],
-                    0,
-                    bufferSize,
-                    0,
-                    &m_UniformBuffersMapped[bufferIndex]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to map uniform buffer memory!");
-            }
-        }
-    }
+DEF Engine::createFrameAllocator() -> void {
+    m_FrameAllocator = std::make_unique<FrameAllocator>(this, Settings::FRAME_ALLOCATOR_CAPACITY, sizeof(ObjectData) * Settings::MAX_OBJECTS);
 }
 
 DEF Engine::createDescriptorSetLayout() -> void {
-    constexpr VkDescriptorSetLayoutBinding uboLayoutBinding{
+    constexpr VkDescriptorSetLayoutBinding cameraLayoutBinding{
         .binding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
         .descriptorCount = 1,
         .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT};
 
-    constexpr VkDescriptorSetLayoutBinding samplerLayoutBinding{
+    constexpr VkDescriptorSetLayoutBinding objectLayoutBinding{
         .binding = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
         .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
         .pImmutableSamplers = nullptr};
 
-    array bindings = {uboLayoutBinding, samplerLayoutBinding};
+    array bindings = {cameraLayoutBinding, objectLayoutBinding};
     const VkDescriptorSetLayoutCreateInfo layoutInfo{
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
         .bindingCount = static_cast<uint32_t>(bindings.size()),
         .pBindings = bindings.data()};
 
-    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS) {
-        throw runtime_error("failed to create descriptor set layout!");
+    m_DescriptorSetLayout = m_ObjectCache->getDescriptorSetLayout(layoutInfo);
+
+    // Virtual textures, only the page tables get written while the sets are bound
+    const array virtualTextureBindings = {
+        VkDescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr},
+        VkDescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = Settings::MAX_VIRTUAL_TEXTURES,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr},
+        VkDescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr},
+        VkDescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr}};
+    constexpr array<VkDescriptorBindingFlags, 4> virtualTextureFlags = {
+        0,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+        0,
+        0};
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo virtualTextureFlagsInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(virtualTextureFlags.size()),
+        .pBindingFlags = virtualTextureFlags.data()};
+    const VkDescriptorSetLayoutCreateInfo virtualTextureLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &virtualTextureFlagsInfo,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = static_cast<uint32_t>(virtualTextureBindings.size()),
+        .pBindings = virtualTextureBindings.data()};
+
+    m_VirtualTextureLayout = m_ObjectCache->getDescriptorSetLayout(virtualTextureLayoutInfo);
+
+    // Bindless texture table, the update-after-bind limits are separate from (and often lower than) the regular ones
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+    VkPhysicalDeviceProperties2 properties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vulkan12Properties};
+    vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &properties);
+    // The per-stage limits cover every set of the pipeline layout, the virtual textures take the page cache and tables
+    constexpr uint32_t virtualTextureSamplers = 1 + Settings::MAX_VIRTUAL_TEXTURES;
+    const uint32_t samplerLimit = std::min({
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers});
+    if (samplerLimit <= virtualTextureSamplers) {
+        throw runtime_error(std::format(
+            "The device allows {} update-after-bind samplers, the virtual textures alone take {} and leave none for the texture table!",
+            samplerLimit, virtualTextureSamplers));
+    }
+    m_TextureTableCapacity = std::min({
+        Settings::MAX_BINDLESS_TEXTURES,
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages - virtualTextureSamplers,
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers - virtualTextureSamplers,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages - virtualTextureSamplers,
+        vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers - virtualTextureSamplers});
+
+    const VkDescriptorSetLayoutBinding textureTableBinding{
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = m_TextureTableCapacity,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = nullptr};
+
+    // Slots are filled as textures get registered, so most of the table is unwritten at any point in time
+    constexpr VkDescriptorBindingFlags textureTableFlags =
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo textureTableFlagsInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindingFlags = &textureTableFlags};
+
+    const VkDescriptorSetLayoutCreateInfo textureTableLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &textureTableFlagsInfo,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = 1,
+        .pBindings = &textureTableBinding};
+
+    m_TextureTableLayout = m_ObjectCache->getDescriptorSetLayout(textureTableLayoutInfo);
+}
+
+DEF Engine::createTextureTable() -> void {
+    const VkDescriptorPoolSize poolSize{
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = m_TextureTableCapacity * Settings::MAX_FRAMES_IN_FLIGHT};
+
+    const VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = Settings::MAX_FRAMES_IN_FLIGHT,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize};
+
+    if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_TextureTablePool) != VK_SUCCESS) {
+        throw runtime_error("failed to create texture table pool!");
+    }
+
+    array<uint32_t, Settings::MAX_FRAMES_IN_FLIGHT> descriptorCounts{};
+    descriptorCounts.fill(m_TextureTableCapacity);
+    array<VkDescriptorSetLayout, Settings::MAX_FRAMES_IN_FLIGHT> layouts{};
+    layouts.fill(m_TextureTableLayout);
+
+    const VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+        .descriptorSetCount = static_cast<uint32_t>(descriptorCounts.size()),
+        .pDescriptorCounts = descriptorCounts.data()};
+
+    const VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = &variableCountInfo,
+        .descriptorPool = m_TextureTablePool,
+        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+        .pSetLayouts = layouts.data()};
+
+    if (vkAllocateDescriptorSets(m_Device, &allocInfo, m_TextureTables.data()) != VK_SUCCESS) {
+        throw runtime_error("failed to allocate texture tables!");
     }
+    fprintf(stdout, "\tTexture tables have %u slots.\n", m_TextureTableCapacity);
+}
+
+DEF Engine::createDownsampler() -> void {
+    if (!m_SupportsComputeMipmaps) {
+        fprintf(stderr, "Compute mips need shaderStorageImageWriteWithoutFormat and shaderStorageImageArrayDynamicIndexing, only blits are available.\n");
+        return;
+    }
+    m_Downsampler = std::make_unique<Downsampler>(this, getShaderModule(FilePaths::SHADER_COMP_DOWNSAMPLE), m_PipelineCache);
+}
+
+DEF Engine::generateMipmapsCompute(
+    VkImage image,
+    const VkFormat format,
+    const uint32_t width,
+    const uint32_t height,
+    const uint32_t mipLevels,
+    const VkImageLayout baseLayout) -> void {
+
+    if (!m_Downsampler) throw runtime_error("compute mip generation isn't supported by the device!");
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    m_Downsampler->record(commandBuffer, image, format, width, height, mipLevels, baseLayout);
+    endSingleTimeCommands(commandBuffer);
+    // The queue is idle, so nothing recorded earlier is still using its resources either
+    m_Downsampler->reset();
 }
 
 DEF Engine::findMemoryType(const uint32_t typeFilter, VkMemoryPropertyFlags properties) const -> uint32_t {
@@ -817,7 +1269,8 @@ DEF Engine::createBuffer(
     const VkBufferUsageFlags usage,
     const VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory
+    VkDeviceMemory &bufferMemory,
+    const MemoryCategory category
 ) const -> void {
     const VkBufferCreateInfo bufferInfo{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -840,10 +1293,24 @@ DEF Engine::createBuffer(
     if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
         throw runtime_error("failed to allocate buffer memory!");
     }
+    m_MemoryTracker->onAllocate(bufferMemory, memRequirements.size, allocInfo.memoryTypeIndex, category);
 
     vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
 }
 
+DEF Engine::freeMemory(VkDeviceMemory memory) const -> void {
+    m_MemoryTracker->onFree(memory);
+    vkFreeMemory(m_Device, memory, nullptr);
+}
+
+DEF Engine::uploadBuffer(VkBuffer dstBuffer, const void *data, const VkDeviceSize size) const -> void {
+    const StagingBuffer staging = m_StagingPool->acquire(size);
+    memcpy(staging.mapped, data, size);
+    copyBuffer(staging.buffer, dstBuffer, size);
+    // copyBuffer waits for the queue, so the buffer can be reused right away
+    m_StagingPool->release(staging);
+}
+
 DEF Engine::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSize size) const -> void {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
@@ -854,28 +1321,6 @@ DEF Engine::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSiz
     endSingleTimeCommands(commandBuffer);
 }
 
-DEF Engine::copyBufferToImage(VkBuffer buffer, VkImage image, const uint32_t width, const uint32_t height) const -> void {
-    const VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    const VkBufferImageCopy region{
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
-        .imageOffset = {.x = 0, .y = 0, .z = 0},
-        .imageExtent = {.width = width, .height = height, .depth = 1}};
-
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region);
-
-    endSingleTimeCommands(commandBuffer);
-}
-
 DEF Engine::transitionImageLayout(
     VkImage image,
     VkFormat format,
@@ -970,6 +1415,132 @@ DEF Engine::createSyncObjects() -> void {
         const VkResult result_3 = vkCreateFence(m_Device, &fenceInfo, nullptr, &m_InFlightFences[i]);
         if (result_3 != VK_SUCCESS) throw runtime_error("failed to create InFlight fence!");
     }
+
+    // Frame numbers start at 1, so nothing has to wait for frame 0
+    VkSemaphoreTypeCreateInfo timelineInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0};
+    const VkSemaphoreCreateInfo timelineSemaphoreInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &timelineInfo};
+    if (vkCreateSemaphore(m_Device, &timelineSemaphoreInfo, nullptr, &m_FrameTimeline) != VK_SUCCESS) {
+        throw runtime_error("failed to create frame timeline semaphore!");
+    }
+    fprintf(stdout, "\t%u of them in flight, waiting on the %s.\n", m_FramesInFlight, m_UseTimelineSemaphore ? "timeline semaphore" : "fences");
+}
+
+DEF Engine::isFrameComplete(const uint64_t frame) -> bool {
+    if (frame <= m_CompletedFrame) return true;
+    uint64_t completed = 0;
+    if (vkGetSemaphoreCounterValue(m_Device, m_FrameTimeline, &completed) != VK_SUCCESS) {
+        throw runtime_error("failed to query the frame timeline semaphore!");
+    }
+    m_CompletedFrame = std::max(m_CompletedFrame, completed);
+    return frame <= m_CompletedFrame;
+}
+
+DEF Engine::waitForFrame(const uint64_t frame) -> void {
+    if (frame <= m_CompletedFrame) return;
+    const VkSemaphoreWaitInfo waitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_FrameTimeline,
+        .pValues = &frame};
+    if (vkWaitSemaphores(m_Device, &waitInfo, NO_TIMEOUT) != VK_SUCCESS) throw runtime_error("failed to wait for the frame timeline semaphore!");
+    m_CompletedFrame = frame;
+}
+
+DEF Engine::setFramesInFlight(const uint32_t framesInFlight) -> void {
+    if (framesInFlight < 1 || framesInFlight > Settings::MAX_FRAMES_IN_FLIGHT) {
+        throw runtime_error("Frames in flight have to be between 1 and Settings::MAX_FRAMES_IN_FLIGHT!");
+    }
+    if (framesInFlight == m_FramesInFlight) return;
+
+    // Frame indices past the new count would never be waited for again
+    waitForFrame(m_FrameCounter);
+    m_FramesInFlight = framesInFlight;
+    m_CurrentFrameIdx = 0;
+    // The swap chain has as many images as there are frames in flight, as far as the surface allows
+    recreateSwapChain();
+}
+
+DEF Engine::setTimelineSemaphoreWaits(const bool useTimelineSemaphore) -> void {
+    if (useTimelineSemaphore == m_UseTimelineSemaphore) return;
+    // Fences aren't submitted while waiting on the timeline, the ones left signalled would lie about frames in flight
+    waitForFrame(m_FrameCounter);
+    m_UseTimelineSemaphore = useTimelineSemaphore;
+}
+
+DEF Engine::createTextureManager() -> void {
+    m_TextureManager = std::make_unique<TextureManager>(this, m_TextureTables, m_TextureTableCapacity, m_TextureSampler, Settings::TEXTURE_VRAM_BUDGET);
+    fprintf(stdout, "\tTexture VRAM budget of %.0f MB.\n", static_cast<double>(Settings::TEXTURE_VRAM_BUDGET) / (1024.0 * 1024.0));
+}
+
+DEF Engine::createVirtualTextureCache() -> void {
+    const uint32_t graphicsFamily = findQueueFamilies(m_PhysicalDevice).graphicsFamily.value();
+    m_VirtualTextures = std::make_unique<VirtualTextureCache>(this, m_VirtualTextureLayout, graphicsFamily);
+}
+
+DEF Engine::createThreadPool() -> void {
+    // The queues are FIFO, a texture reload sharing the recording pool would make the frame's recordings wait behind
+    // its decode and compression tasks. With a pool of their own the scheduler interleaves both.
+    const uint32_t threadCount = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, Settings::MAX_RECORDING_THREADS);
+    m_ThreadPool = std::make_unique<ThreadPool>(threadCount);
+    const uint32_t textureThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    m_TexturePool = std::make_unique<ThreadPool>(textureThreadCount);
+    fprintf(stdout, "\tStarted %u recording and %u texture worker threads.\n", threadCount, textureThreadCount);
+}
+
+DEF Engine::createRecordingContexts() -> void {
+    const uint32_t threadCount = m_ThreadPool->getThreadCount();
+    m_RecordingThreadCount = threadCount;
+    fprintf(stdout, "\tRecording with up to %u threads.\n", threadCount);
+
+    // Command pools aren't thread safe, so every thread gets its own. There's a set of them per frame and swap chain
+    // image, like the cached command buffers, so that resetting a pool never affects a command buffer the GPU is still
+    // executing, nor a cached one of another image that executes the secondaries.
+    m_RecordingContexts.resize(Settings::MAX_FRAMES_IN_FLIGHT);
+    for (size_t frame = 0; frame < Settings::MAX_FRAMES_IN_FLIGHT; frame++) {
+        for (uint32_t image = 0; image < static_cast<uint32_t>(m_SwapChainImages.size()); image++) {
+            getRecordingContexts(static_cast<uint32_t>(frame), image);
+        }
+    }
+}
+
+DEF Engine::getRecordingContexts(const uint32_t frameIdx, const uint32_t imageIndex) -> vector<RecordingContext> & {
+    // A recreated swap chain can have more images than there are contexts, those are created on first use
+    vector<vector<RecordingContext>> &frameContexts = m_RecordingContexts[frameIdx];
+    if (frameContexts.size() <= imageIndex) frameContexts.resize(imageIndex + 1);
+    vector<RecordingContext> &contexts = frameContexts[imageIndex];
+    if (!contexts.empty()) return contexts;
+
+    const QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_PhysicalDevice);
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()};
+
+    contexts.resize(m_ThreadPool->getThreadCount());
+    for (RecordingContext &context : contexts) {
+        if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &context.commandPool) != VK_SUCCESS) {
+            throw runtime_error("failed to create recording command pool!");
+        }
+
+        const VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = context.commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1};
+        if (vkAllocateCommandBuffers(m_Device, &allocInfo, &context.commandBuffer) != VK_SUCCESS) {
+            throw runtime_error("failed to allocate secondary command buffer!");
+        }
+    }
+    return contexts;
+}
+
+DEF Engine::setRecordingThreadCount(const uint32_t threadCount) -> void {
+    m_RecordingThreadCount = std::clamp<uint32_t>(threadCount, 1, m_ThreadPool->getThreadCount());
 }
 
 DEF Engine::createCommandBuffers() -> void {
@@ -984,9 +1555,12 @@ DEF Engine::createCommandBuffers() -> void {
     if (vkAllocateCommandBuffers(m_Device, &allocInfo, m_CommandBuffers.data()) != VK_SUCCESS) {
         throw runtime_error("failed to allocate command buffers!");
     }
+
+    // Allocated on first use, see acquireCommandBuffer
+    m_CachedCommandBuffers.resize(Settings::MAX_FRAMES_IN_FLIGHT);
 }
 
-void Engine::recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+DEF Engine::recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageIndex, RecordingStats &stats) -> uint32_t {
     VkCommandBufferBeginInfo beginInfo{
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
 
@@ -1008,9 +1582,223 @@ void Engine::recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageI
         .clearValueCount = static_cast<uint32_t>(clearValues.size()),
         .pClearValues = clearValues.data()};
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    stats = RecordingStats{};
+
+    // Splitting the draws only pays off once every thread has a reasonable amount of them to record
+    const uint32_t drawCount = getDrawCount();
+    const uint32_t threadCount = std::min(m_RecordingThreadCount, std::max(1u, drawCount / Settings::MIN_DRAWS_PER_RECORDING_THREAD));
+
+    if (threadCount > 1) {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        stats = recordSecondaryCommandBuffers(imageIndex, drawCount, threadCount);
+
+        array<VkCommandBuffer, Settings::MAX_RECORDING_THREADS> secondaryCommandBuffers{};
+        for (uint32_t i = 0; i < threadCount; i++) {
+            secondaryCommandBuffers[i] = m_RecordingContexts[m_CurrentFrameIdx][imageIndex][i].commandBuffer;
+        }
+        vkCmdExecuteCommands(commandBuffer, threadCount, secondaryCommandBuffers.data());
+    } else {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        bindFrameState(commandBuffer, stats);
+        stats += recordDrawRange(commandBuffer, 0, drawCount);
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+    m_VirtualTextures->recordFeedbackBarrier(commandBuffer, m_CurrentFrameIdx);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+    return threadCount;
+}
+
+DEF Engine::acquireCommandBuffer(const uint32_t imageIndex) -> VkCommandBuffer {
+    if (!m_CacheCommandBuffers) {
+        VkCommandBuffer commandBuffer = m_CommandBuffers[m_CurrentFrameIdx];
+        const auto recordStart = std::chrono::high_resolution_clock::now();
+        vkResetCommandBuffer(commandBuffer, 0);
+        recordCommandBuffers(commandBuffer, imageIndex, m_RecordingStats);
+        m_RecordTotalMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+        m_RecordedFrameCount += 1;
+        return commandBuffer;
+    }
+
+    // One cached buffer per frame in flight and swap chain image, because it references both the frame's region of
+    // the frame allocator (through the dynamic offsets) and the image's framebuffer
+    vector<CachedCommandBuffer> &frameCache = m_CachedCommandBuffers[m_CurrentFrameIdx];
+    if (frameCache.size() <= imageIndex) frameCache.resize(imageIndex + 1, CachedCommandBuffer{});
+    CachedCommandBuffer &cached = frameCache[imageIndex];
+
+    const RecordingKey key{
+        .pipeline = m_GraphicsPipeline,
+        .framebuffer = m_SwapChainFramebuffers[imageIndex],
+        .extentWidth = m_SwapChainExtent.width,
+        .extentHeight = m_SwapChainExtent.height,
+        .stage = m_Stage,
+        .useInstancing = m_UseInstancing,
+        .useIndirectDraws = m_UseIndirectDraws,
+        .dynamicOffsets = m_DynamicOffsets,
+        .indirectOffset = m_UseIndirectDraws ? m_IndirectCommands.offset : 0,
+        .batchLayoutHash = hashDrawBatches()};
+
+    if (cached.valid && cached.key == key) {
+        m_CachedFrameCount += 1;
+        m_RecordingStats = cached.stats;
+        return cached.commandBuffer;
+    }
+
+    if (cached.commandBuffer == VK_NULL_HANDLE) {
+        const VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = m_CommandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1};
+        if (vkAllocateCommandBuffers(m_Device, &allocInfo, &cached.commandBuffer) != VK_SUCCESS) {
+            throw runtime_error("failed to allocate cached command buffer!");
+        }
+    }
+
+    const auto recordStart = std::chrono::high_resolution_clock::now();
+    vkResetCommandBuffer(cached.commandBuffer, 0);
+    const uint32_t threadCount = recordCommandBuffers(cached.commandBuffer, imageIndex, m_RecordingStats);
+    m_RecordTotalMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+    m_RecordedFrameCount += 1;
+
+    cached.key = key;
+    cached.stats = m_RecordingStats;
+    cached.valid = true;
+    cached.usesSecondaryCommandBuffers = threadCount > 1;
+    return cached.commandBuffer;
+}
+
+DEF Engine::hashDrawBatches() const -> uint64_t {
+    // FNV-1a over what a recorded command buffer depends on, the instance data itself lives in the object buffer
+    uint64_t hash = 14695981039346656037ULL;
+    const auto combine = [&hash](const uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+    for (const DrawBatch &batch : m_DrawBatches) {
+        combine(reinterpret_cast<uintptr_t>(batch.mesh));
+        combine(batch.firstInstance);
+        combine(batch.instanceCount);
+    }
+    combine(m_DrawBatches.size());
+    return hash;
+}
+
+DEF Engine::printCommandBufferCacheStats() const -> void {
+    const double averageRecordMs = m_RecordedFrameCount > 0 ? m_RecordTotalMs / static_cast<double>(m_RecordedFrameCount) : 0.0;
+    fprintf(stdout, "Command buffers: %llu frames served from cache, %llu re-recorded (%.3f ms avg), ~%.1f ms CPU time saved\n",
+            static_cast<unsigned long long>(m_CachedFrameCount),
+            static_cast<unsigned long long>(m_RecordedFrameCount),
+            averageRecordMs,
+            averageRecordMs * static_cast<double>(m_CachedFrameCount));
+}
+
+DEF Engine::recordSecondaryCommandBuffers(const uint32_t imageIndex, const uint32_t drawCount, const uint32_t threadCount) -> RecordingStats {
+    vector<RecordingContext> &contexts = getRecordingContexts(m_CurrentFrameIdx, imageIndex);
+
+    // The pools get reset below, which invalidates the secondaries that the cached buffer of this frame and image
+    // still executes, if this recording isn't the one replacing it anyway
+    vector<CachedCommandBuffer> &frameCache = m_CachedCommandBuffers[m_CurrentFrameIdx];
+    if (imageIndex < frameCache.size() && frameCache[imageIndex].usesSecondaryCommandBuffers) frameCache[imageIndex].valid = false;
+
+    array<std::future<void>, Settings::MAX_RECORDING_THREADS> recordings;
+    array<RecordingStats, Settings::MAX_RECORDING_THREADS> threadStats{};
+    for (uint32_t i = 0; i < threadCount; i++) {
+        const auto firstDraw = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * i / threadCount);
+        const auto endDraw = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (i + 1) / threadCount);
+        RecordingContext &context = contexts[i];
+        RecordingStats &stats = threadStats[i];
+        recordings[i] = m_ThreadPool->enqueue([this, &context, &stats, imageIndex, firstDraw, endDraw] {
+            recordSecondaryCommandBuffer(context, imageIndex, firstDraw, endDraw - firstDraw, stats);
+        });
+    }
+
+    // get() rethrows whatever went wrong on the workers, but only once all of them are done, they still write into
+    // threadStats and the contexts
+    std::exception_ptr error;
+    RecordingStats stats{};
+    for (uint32_t i = 0; i < threadCount; i++) {
+        try {
+            recordings[i].get();
+            stats += threadStats[i];
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+    return stats;
+}
+
+DEF Engine::recordSecondaryCommandBuffer(const RecordingContext &context, const uint32_t imageIndex, const uint32_t firstDraw, const uint32_t drawCount, RecordingStats &stats) const -> void {
+    // Each pool is only ever touched by the thread recording this slice, and the frame's fence has signalled
+    vkResetCommandPool(m_Device, context.commandPool, 0);
+
+    const VkCommandBufferInheritanceInfo inheritanceInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = m_RenderPass,
+        .subpass = 0,
+        .framebuffer = m_SwapChainFramebuffers[imageIndex]};
+
+    // Not one time submit, a cached primary buffer executes them again every time it's reused
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo};
+
+    if (vkBeginCommandBuffer(context.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+
+    // Secondary command buffers don't inherit any state from the primary one
+    bindFrameState(context.commandBuffer, stats);
+    stats += recordDrawRange(context.commandBuffer, firstDraw, drawCount);
+
+    if (vkEndCommandBuffer(context.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+}
 
+DEF Engine::bindFrameState(VkCommandBuffer commandBuffer, RecordingStats &stats) const -> void {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+    stats.pipelineBinds += 1;
+
+    // Camera and object data are the same set for every draw, only the dynamic offsets move from frame to frame
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_PipelineLayout,
+        0,
+        1,
+        &m_DescriptorSet,
+        static_cast<uint32_t>(m_DynamicOffsets.size()),
+        m_DynamicOffsets.data());
+
+    // The frame's texture table is bound once, every draw picks its texture by the material ID in the object data
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_PipelineLayout,
+        1,
+        1,
+        &m_TextureTables[m_CurrentFrameIdx],
+        0,
+        nullptr);
+
+    // Only differs per frame in flight by the feedback region the fragments write into
+    VkDescriptorSet virtualTextureSet = m_VirtualTextures->getDescriptorSet(m_CurrentFrameIdx);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_PipelineLayout,
+        2,
+        1,
+        &virtualTextureSet,
+        0,
+        nullptr);
+    stats.descriptorSetBinds += 3;
 
     VkViewport viewport{
         .x = 0.0f,
@@ -1025,31 +1813,169 @@ void Engine::recordCommandBuffers(VkCommandBuffer commandBuffer, uint32_t imageI
         .offset = {0, 0},
         .extent = m_SwapChainExtent};
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
 
-    updatePushConstants();
-    vkCmdPushConstants(
-        commandBuffer,
-        m_PipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(PushConstants),
-        &m_PushConstants);
+DEF Engine::getDrawCount() const -> uint32_t {
+    uint32_t drawCount = 0;
+    for (const DrawBatch &batch : m_DrawBatches) {
+        drawCount += m_UseInstancing ? 1 : batch.instanceCount;
+    }
+    return drawCount;
+}
 
-    for (size_t j = 0; j < m_Models.size(); j++) {
-        size_t descriptorSetIndex = m_CurrentFrameIdx * m_Models.size() + j;
-        VkDescriptorSet descriptorSet = m_DescriptorSets[descriptorSetIndex];
+DEF Engine::recordDrawRange(VkCommandBuffer commandBuffer, const uint32_t firstDraw, const uint32_t drawCount) const -> RecordingStats {
+    RecordingStats stats{};
+    const MeshNT *boundMesh = nullptr;
 
-        if (descriptorSet == VK_NULL_HANDLE) {
-            throw std::runtime_error("Invalid descriptor set handle!");
+    // Draw indices run over all batches, a batch is one draw when instanced and one draw per instance otherwise
+    const uint32_t endDraw = firstDraw + drawCount;
+    uint32_t batchFirstDraw = 0;
+    for (const DrawBatch &batch : m_DrawBatches) {
+        if (batchFirstDraw >= endDraw) break;
+
+        const uint32_t batchDrawCount = m_UseInstancing ? 1 : batch.instanceCount;
+        const uint32_t rangeBegin = std::max(firstDraw, batchFirstDraw);
+        const uint32_t rangeEnd = std::min(endDraw, batchFirstDraw + batchDrawCount);
+        if (rangeBegin < rangeEnd) {
+            enqueueDrawBatch(commandBuffer, batch, rangeBegin - batchFirstDraw, rangeEnd - rangeBegin, boundMesh, stats);
         }
+        batchFirstDraw += batchDrawCount;
+    }
+    return stats;
+}
 
-        m_Models[j]->enqueueIntoCommandBuffer(commandBuffer, descriptorSet);
+DEF Engine::enqueueDrawBatch(VkCommandBuffer commandBuffer, const DrawBatch &batch, const uint32_t firstDraw, const uint32_t drawCount, const MeshNT *&boundMesh, RecordingStats &stats) const -> void {
+    // The queue is sorted by mesh, so a run of draws only binds its buffers once
+    if (batch.mesh != boundMesh) {
+        batch.mesh->bind(commandBuffer);
+        boundMesh = batch.mesh;
+        stats.vertexBufferBinds += 1;
+        stats.indexBufferBinds += 1;
     }
 
-    vkCmdEndRenderPass(commandBuffer);
+    if (m_UseIndirectDraws) {
+        constexpr VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+        const VkDeviceSize offset = m_IndirectCommands.offset + (batch.firstCommand + firstDraw) * stride;
+        // Without multi-draw m_MaxDrawIndirectCount is 1, which makes this one call per command
+        for (uint32_t issued = 0; issued < drawCount;) {
+            const uint32_t count = std::min(drawCount - issued, m_MaxDrawIndirectCount);
+            vkCmdDrawIndexedIndirect(commandBuffer, m_IndirectCommands.buffer, offset + issued * stride, count, stride);
+            stats.indirectDrawCalls += 1;
+            issued += count;
+        }
+        stats.draws += drawCount;
+        return;
+    }
 
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-        throw std::runtime_error("failed to record command buffer!");
+    // Without instancing every instance gets its own draw, which is what we did before instancing
+    const uint32_t instancesPerDraw = m_UseInstancing ? batch.instanceCount : 1;
+
+    for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+        batch.mesh->draw(commandBuffer, batch.firstInstance + i, instancesPerDraw);
+    }
+    stats.draws += drawCount;
+}
+
+DEF Engine::buildDrawBatches() -> TransientAllocation {
+    m_DrawBatches.clear();
+
+    // The objects of this frame in scene order, they only get sorted into the object buffer below
+    const size_t objectCount = m_BenchmarkInstanceCount > 0 ? m_BenchmarkInstanceCount : m_Models.size();
+    if (objectCount > Settings::MAX_OBJECTS) throw runtime_error("Too many objects for the object buffer binding!");
+    const std::span<ObjectData> sceneObjects = m_FrameArena.allocateArray<ObjectData>(objectCount);
+    const std::span<MeshNT *> sceneMeshes = m_FrameArena.allocateArray<MeshNT *>(objectCount);
+
+    if (m_BenchmarkInstanceCount > 0) {
+        // Cube shaped grid of spheres centered around the origin
+        constexpr float spacing = 2.5f;
+        const auto gridSize = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(m_BenchmarkInstanceCount))));
+        const float offset = static_cast<float>(gridSize - 1) * spacing * 0.5f;
+        // Without explicit materials the spheres cycle through every slot that currently holds a texture
+        const vector<uint32_t> &materials = m_BenchmarkMaterials.empty() ? getTextureSlots() : m_BenchmarkMaterials;
+        if (materials.empty()) throw runtime_error("Benchmark instances need at least one texture!");
+        const auto materialCount = static_cast<uint32_t>(materials.size());
+        for (uint32_t i = 0; i < m_BenchmarkInstanceCount; i++) {
+            const vec3 position = vec3(
+                                      static_cast<float>(i % gridSize),
+                                      static_cast<float>((i / gridSize) % gridSize),
+                                      static_cast<float>(i / (gridSize * gridSize))) *
+                                      spacing -
+                                  vec3(offset);
+            const uint32_t materialID = materials[i % materialCount];
+            sceneObjects[i] = ObjectData{
+                .model = glm::translate(mat4(1.0f), position),
+                .materialID = materialID};
+            sceneMeshes[i] = m_BenchmarkMesh;
+            // Virtual textures are streamed by their feedback instead
+            if ((materialID & Settings::VIRTUAL_MATERIAL_BIT) == 0) m_TextureManager->markUsed(materialID);
+        }
+    } else {
+        for (size_t i = 0; i < objectCount; i++) {
+            const auto &model = m_Models[i];
+            sceneObjects[i] = ObjectData{
+                .model = model->getMatrix(),
+                .materialID = model->getMaterialID()};
+            sceneMeshes[i] = model->getMesh();
+            m_TextureManager->markUsed(model->getMaterialID());
+        }
+    }
+
+    const TransientAllocation objectAllocation = m_FrameAllocator->allocateStorage(sizeof(ObjectData) * objectCount);
+    auto *objects = static_cast<ObjectData *>(objectAllocation.mapped);
+
+    // Everything is opaque and drawn with the pipeline of the current stage, its ID in the PipelineLibrary
+    const auto pipelineID = static_cast<uint32_t>(m_Stage);
+    const vec3 viewDirection = normalize(m_CameraCenter - m_CameraEye);
+    m_RenderQueue.clear();
+    m_RenderQueue.reserve(objectCount);
+    for (size_t i = 0; i < objectCount; i++) {
+        const vec3 position = vec3(sceneObjects[i].model[3]);
+        const float viewDepth = dot(position - m_CameraEye, viewDirection);
+        m_RenderQueue.push(
+            RenderQueue::makeKey(pipelineID, sceneMeshes[i]->getMeshID(), sceneObjects[i].materialID, viewDepth),
+            static_cast<uint32_t>(i));
+    }
+    m_RenderQueue.sort();
+
+    // Objects go into the object buffer in sorted order, so every run of packets sharing a mesh is one contiguous batch
+    const vector<DrawPacket> &packets = m_RenderQueue.getPackets();
+    for (uint32_t i = 0; i < static_cast<uint32_t>(packets.size()); i++) {
+        const uint32_t objectIndex = packets[i].objectIndex;
+        objects[i] = sceneObjects[objectIndex];
+
+        MeshNT *mesh = sceneMeshes[objectIndex];
+        if (m_DrawBatches.empty() || m_DrawBatches.back().mesh != mesh) {
+            m_DrawBatches.push_back(DrawBatch{
+                .mesh = mesh,
+                .firstInstance = i,
+                .instanceCount = 0,
+                .firstCommand = 0});
+        }
+        m_DrawBatches.back().instanceCount += 1;
+    }
+
+    if (m_UseIndirectDraws) writeIndirectCommands();
+    return objectAllocation;
+}
+
+DEF Engine::writeIndirectCommands() -> void {
+    const uint32_t drawCount = getDrawCount();
+    m_IndirectCommands = m_FrameAllocator->allocate(sizeof(VkDrawIndexedIndirectCommand) * drawCount, sizeof(uint32_t));
+    auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(m_IndirectCommands.mapped);
+
+    // firstInstance carries the object index, so the shaders read their object data through gl_InstanceIndex
+    // exactly like with direct draws
+    uint32_t commandIdx = 0;
+    for (DrawBatch &batch : m_DrawBatches) {
+        batch.firstCommand = commandIdx;
+        const uint32_t indexCount = batch.mesh->getIndexCount();
+        if (m_UseInstancing) {
+            commands[commandIdx++] = VkDrawIndexedIndirectCommand{indexCount, batch.instanceCount, 0, 0, batch.firstInstance};
+            continue;
+        }
+        for (uint32_t i = 0; i < batch.instanceCount; i++) {
+            commands[commandIdx++] = VkDrawIndexedIndirectCommand{indexCount, 1, 0, 0, batch.firstInstance + i};
+        }
     }
 }
 
@@ -1157,38 +2083,80 @@ DEF Engine::createRenderPass() -> void {
         .dependencyCount = 1,
         .pDependencies = &dependency};
 
-    if (vkCreateRenderPass(m_Device, &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) {
-        throw runtime_error("failed to create render pass!");
-    }
+    m_RenderPass = m_ObjectCache->getRenderPass(renderPassInfo);
+}
+
+DEF Engine::createPipelineLayout() -> void {
+    // Set 0 holds the per-frame buffers, set 1 the bindless texture table, set 2 the virtual textures
+    array setLayouts = {m_DescriptorSetLayout, m_TextureTableLayout, m_VirtualTextureLayout};
+    const VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+        .pSetLayouts = setLayouts.data()};
+    m_PipelineLayout = m_ObjectCache->getPipelineLayout(pipelineLayoutInfo);
 }
 
 DEF Engine::createGraphicsPipeline() -> void {
+    // The modules outlive the pipelines, background compilations keep referencing them
+    // Created once and reused by every rebuild, see getShaderModule
     fprintf(stdout, "Trying to create Shader modules.\n");
-    fprintf(stdout, "Trying to read .spv files.\n");
-    vector<char> vertShaderCode = Util::readFile(FilePaths::SHADER_VERT_PHONG_STAGES);
-    vector<char> fragShaderCode = Util::readFile(FilePaths::SHADER_FRAG_PHONG_STAGES);
+    const auto shaderStart = std::chrono::high_resolution_clock::now();
+    m_StageVertShaderModule = getShaderModule(FilePaths::SHADER_VERT_PHONG_STAGES);
+    m_StageFragShaderModule = getShaderModule(FilePaths::SHADER_FRAG_PHONG_STAGES);
+    const std::chrono::duration<double, std::milli> shaderElapsed = std::chrono::high_resolution_clock::now() - shaderStart;
+    fprintf(stdout, "\tShader modules took %.2f ms\n", shaderElapsed.count());
+
+    fprintf(stdout, "\tInitializing Render Pipeline.\n");
+    createPipelineLayout();
+
+    if (!m_PipelineLibrary) m_PipelineLibrary = std::make_unique<PipelineLibrary>(m_Device, Settings::PIPELINE_COMPILE_THREADS);
+
+    // Only the fallback is built up front, it's what every stage shows until its own pipeline is done
+    const auto pipelineStart = std::chrono::high_resolution_clock::now();
+    m_PipelineLibrary->setFallback(static_cast<uint32_t>(Settings::FALLBACK_STAGE), createStagePipeline(Settings::FALLBACK_STAGE));
+    const std::chrono::duration<double, std::milli> pipelineElapsed = std::chrono::high_resolution_clock::now() - pipelineStart;
+    fprintf(stdout, "\tFallback pipeline (stage %d) took %.2f ms (%s pipeline cache)\n",
+            Settings::FALLBACK_STAGE,
+            pipelineElapsed.count(),
+            m_PipelineCacheWarm ? "warm" : "cold");
+    m_PipelineCacheWarm = true;
+    m_GraphicsPipeline = m_PipelineLibrary->getFallback();
+
+    // The fallback already is the fallback stage's pipeline, only the others are compiled in the background
+    for (int stage = 0; stage < Settings::STAGE_COUNT; stage++) {
+        if (stage == Settings::FALLBACK_STAGE) continue;
+        m_PipelineLibrary->request(static_cast<uint32_t>(stage), [this, stage] { return createStagePipeline(stage); });
+    }
+}
 
-    fprintf(stdout, "\tTrying to create Vertex Shader.\n");
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{
+DEF Engine::createStagePipeline(const int stage) const -> VkPipeline {
+    // Runs on the pipeline library's workers, so it only reads state that stays put while compilations are pending
+    const VkPipelineShaderStageCreateInfo vertShaderStageInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = vertShaderModule,
+        .module = m_StageVertShaderModule,
         .pName = "main"};
 
-    fprintf(stdout, "\tTrying to create Fragment Shader.\n");
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{
+    // Constant 0 of the fragment shader selects the stage, so every pipeline only keeps the code of its own stage
+    const int32_t stageValue = stage;
+    constexpr VkSpecializationMapEntry stageEntry{
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(int32_t)};
+    const VkSpecializationInfo specializationInfo{
+        .mapEntryCount = 1,
+        .pMapEntries = &stageEntry,
+        .dataSize = sizeof(int32_t),
+        .pData = &stageValue};
+    const VkPipelineShaderStageCreateInfo fragShaderStageInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .module = fragShaderModule,
-        .pName = "main"};
+        .module = m_StageFragShaderModule,
+        .pName = "main",
+        .pSpecializationInfo = &specializationInfo};
 
     array shaderStages = {vertShaderStageInfo, fragShaderStageInfo};
-    fprintf(stdout, "Successfully created the shader modules.\n");
 
-    fprintf(stdout, "Trying to Initialize Fixed Functions.\n");
-    fprintf(stdout, "\tInitializing Vertex Input.\n");
     auto bindingDescription = VertexNT::getBindingDescription();
     auto attributeDescriptions = VertexNT::getAttributeDescriptions();
 
@@ -1199,7 +2167,6 @@ DEF Engine::createGraphicsPipeline() -> void {
         .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()),
         .pVertexAttributeDescriptions = attributeDescriptions.data()};
 
-    fprintf(stdout, "\tInitializing Input Assembly.\n");
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
         .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -1219,7 +2186,6 @@ DEF Engine::createGraphicsPipeline() -> void {
         .viewportCount = 1,
         .scissorCount = 1};
 
-    fprintf(stdout, "\tInitializing Rasterizer.\n");
     VkPipelineRasterizationStateCreateInfo rasterizer{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
         .depthClampEnable = VK_FALSE,
@@ -1241,13 +2207,11 @@ DEF Engine::createGraphicsPipeline() -> void {
         .depthBoundsTestEnable = VK_FALSE,
         .stencilTestEnable = VK_FALSE};
 
-    fprintf(stdout, "\tInitializing Multisampling.\n");
     VkPipelineMultisampleStateCreateInfo multisampling{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
         .rasterizationSamples = m_MSAASamples,
         .sampleShadingEnable = VK_FALSE};
 
-    fprintf(stdout, "\tInitializing Color Blending.\n");
     VkPipelineColorBlendAttachmentState colorBlendAttachment{
         .blendEnable = VK_FALSE,
         .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
@@ -1267,27 +2231,9 @@ DEF Engine::createGraphicsPipeline() -> void {
         .pAttachments = &colorBlendAttachment,
         .blendConstants = {0.0F, 0.0F, 0.0F, 0.0F}};
 
-    // Define the push constant range
-    VkPushConstantRange pushConstantRange = {
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        .offset = 0,
-        .size = sizeof(PushConstants)};
-
-    fprintf(stdout, "\tInitializing Render Pipeline.\n");
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &m_DescriptorSetLayout,
-        .pushConstantRangeCount = 1,
-        .pPushConstantRanges = &pushConstantRange};
-
-    if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-        throw runtime_error("failed to create pipeline layout!");
-    }
-
-    VkGraphicsPipelineCreateInfo pipelineInfo{
+    const VkGraphicsPipelineCreateInfo pipelineInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = 2,
+        .stageCount = static_cast<uint32_t>(shaderStages.size()),
         .pStages = shaderStages.data(),
         .pVertexInputState = &vertexInputInfo,
         .pInputAssemblyState = &inputAssembly,
@@ -1302,16 +2248,119 @@ DEF Engine::createGraphicsPipeline() -> void {
         .subpass = 0,
         .basePipelineHandle = VK_NULL_HANDLE};
 
-    if (vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS) {
+    // The pipeline cache is internally synchronized, so the workers can share it
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_Device, m_PipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw runtime_error("failed to create graphics pipeline!");
     }
+    return pipeline;
+}
+
+DEF Engine::destroyGraphicsPipelines() -> void {
+    // Waits for pending compilations, they reference the layout and render pass that are about to go away
+    if (m_PipelineLibrary) m_PipelineLibrary->clear();
+    m_GraphicsPipeline = VK_NULL_HANDLE;
+}
+
+DEF Engine::setStage(const int stage) -> void {
+    if (stage < 0 || stage >= Settings::STAGE_COUNT) {
+        fprintf(stderr, "Stage %d doesn't exist, staying at stage %d.\n", stage, m_Stage);
+        return;
+    }
+    // The pipeline itself is picked up at the start of the next frame, see drawFrame
+    m_Stage = stage;
+}
+
+DEF Engine::createPipelineCache() -> void {
+    vector<char> initialData;
+    if (std::filesystem::exists(FilePaths::PIPELINE_CACHE)) {
+        initialData = Util::readFile(FilePaths::PIPELINE_CACHE);
+        if (!isPipelineCacheCompatible(initialData)) {
+            fprintf(stdout, "Pipeline cache on disk was created by another device or driver, starting cold.\n");
+            initialData.clear();
+        }
+    } else {
+        fprintf(stdout, "No pipeline cache on disk, starting cold.\n");
+    }
+
+    const VkPipelineCacheCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.empty() ? nullptr : initialData.data()};
+
+    if (vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_PipelineCache) != VK_SUCCESS) {
+        throw runtime_error("failed to create pipeline cache!");
+    }
+    m_PipelineCacheWarm = !initialData.empty();
+    if (m_PipelineCacheWarm) fprintf(stdout, "Loaded %zu bytes of pipeline cache from disk.\n", initialData.size());
+}
+
+DEF Engine::isPipelineCacheCompatible(const vector<char> &data) const -> bool {
+    // Drivers are supposed to reject foreign data themselves, but not all of them do so gracefully
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header)) return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+
+    return header.headerSize >= sizeof(header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+DEF Engine::savePipelineCache() const -> void {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        fprintf(stderr, "Failed to query the pipeline cache size, not saving it.\n");
+        return;
+    }
+    vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to read the pipeline cache, not saving it.\n");
+        return;
+    }
+
+    if (!Util::writeFileAtomically(FilePaths::PIPELINE_CACHE, std::as_bytes(std::span(data.data(), dataSize)))) {
+        fprintf(stderr, "Failed to write the pipeline cache to '%s'.\n", FilePaths::PIPELINE_CACHE);
+        return;
+    }
+    fprintf(stdout, "Saved %zu bytes of pipeline cache to '%s'.\n", dataSize, FilePaths::PIPELINE_CACHE);
+}
+
+DEF Engine::loadShaderBundle() -> void {
+    if (!std::filesystem::exists(FilePaths::SHADER_BUNDLE)) {
+        fprintf(stdout, "No shader bundle at '%s', loading the loose .spv files instead.\n", FilePaths::SHADER_BUNDLE);
+        return;
+    }
+    m_ShaderBundle = std::make_unique<ShaderBundle>(FilePaths::SHADER_BUNDLE);
+    fprintf(stdout, "Mapped %zu shader modules (%zu bytes) from '%s'.\n",
+            m_ShaderBundle->getModuleCount(),
+            m_ShaderBundle->getSize(),
+            FilePaths::SHADER_BUNDLE);
+}
+
+DEF Engine::getShaderModule(const char *shaderFilepath) -> VkShaderModule {
+    const auto found = m_ShaderModules.find(shaderFilepath);
+    if (found != m_ShaderModules.end()) return found->second;
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    const std::span<const std::byte> bundled = m_ShaderBundle ? m_ShaderBundle->find(shaderFilepath) : std::span<const std::byte>{};
+    if (!bundled.empty()) {
+        shaderModule = createShaderModule(bundled);
+    } else {
+        if (m_ShaderBundle) fprintf(stderr, "'%s' is missing from the shader bundle, reading the file.\n", shaderFilepath);
+        const vector<char> code = Util::readFile(shaderFilepath);
+        shaderModule = createShaderModule(std::as_bytes(std::span(code)));
+    }
 
-    fprintf(stdout, "Cleaning up shader modules.\n");
-    vkDestroyShaderModule(m_Device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_Device, vertShaderModule, nullptr);
+    m_ShaderModules.emplace(shaderFilepath, shaderModule);
+    return shaderModule;
 }
 
-DEF Engine::createShaderModule(const vector<char> &code) const -> VkShaderModule {
+DEF Engine::createShaderModule(const std::span<const std::byte> code) const -> VkShaderModule {
     const VkShaderModuleCreateInfo createInfo{
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
         .codeSize = code.size(),
@@ -1341,8 +2390,8 @@ void Engine::createSwapChain() {
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    // Limit the number of swap chain images to MAX_FRAMES_IN_FLIGHT
-    uint32_t imageCount = Settings::MAX_FRAMES_IN_FLIGHT;
+    // Limit the number of swap chain images to the frames in flight
+    uint32_t imageCount = m_FramesInFlight;
 
     // Ensure imageCount is within the allowed range
     if (imageCount < swapChainSupport.capabilities.minImageCount) {
@@ -1366,7 +2415,8 @@ void Engine::createSwapChain() {
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = presentMode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE,
+        // Lets the driver reuse resources of the previous swap chain and keep presenting while we resize
+        .oldSwapchain = m_SwapChain,
     };
 
     QueueFamilyIndices queueIndices = findQueueFamilies(m_PhysicalDevice);
@@ -1389,10 +2439,16 @@ void Engine::createSwapChain() {
         createInfo.pQueueFamilyIndices = nullptr;
     }
 
-    if (vkCreateSwapchainKHR(m_Device, &createInfo, nullptr, &m_SwapChain) != VK_SUCCESS) {
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+    if (vkCreateSwapchainKHR(m_Device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
     }
 
+    // The old swap chain is retired by the creation above, but presents queued from its images may still be pending.
+    // The first frame on the new swap chain is submitted behind them, it's destroyed once that frame completed.
+    if (m_SwapChain != VK_NULL_HANDLE) m_RetiredSwapChains.push_back(RetiredSwapChain{.swapChain = m_SwapChain, .frame = getFrameNumber()});
+    m_SwapChain = swapChain;
+
     vkGetSwapchainImagesKHR(m_Device, m_SwapChain, &imageCount, nullptr);
     m_SwapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(m_Device, m_SwapChain, &imageCount, m_SwapChainImages.data());
@@ -1401,66 +2457,43 @@ void Engine::createSwapChain() {
     m_SwapChainExtent = extent;
 }
 
+DEF Engine::destroyRetiredSwapChains(const bool all) -> void {
+    for (auto retired = m_RetiredSwapChains.begin(); retired != m_RetiredSwapChains.end();) {
+        if (!all && !isFrameComplete(retired->frame)) {
+            ++retired;
+            continue;
+        }
+        vkDestroySwapchainKHR(m_Device, retired->swapChain, nullptr);
+        retired = m_RetiredSwapChains.erase(retired);
+    }
+}
+
 void Engine::cleanupSwapChain() {
+    // Only what depends on the swap chain images or extent, the swap chain itself is handed over as oldSwapchain
     vkDestroyImageView(m_Device, m_ColorImageView, nullptr);
     vkDestroyImage(m_Device, m_ColorImage, nullptr);
-    vkFreeMemory(m_Device, m_ColorImageMemory, nullptr);
+    freeMemory(m_ColorImageMemory);
 
     vkDestroyImageView(m_Device, m_DepthImageView, nullptr);
     vkDestroyImage(m_Device, m_DepthImage, nullptr);
-    vkFreeMemory(m_Device, m_DepthImageMemory, nullptr);
+    freeMemory(m_DepthImageMemory);
 
     for (const auto framebuffer : m_SwapChainFramebuffers) {
         vkDestroyFramebuffer(m_Device, framebuffer, nullptr);
     }
     m_SwapChainFramebuffers.clear();
 
-    const auto commandBufferCount = static_cast<uint32_t>(m_CommandBuffers.size());
-    if (commandBufferCount > 0) {
-        vkFreeCommandBuffers(m_Device, m_CommandPool, commandBufferCount, m_CommandBuffers.data());
-        m_CommandBuffers.clear();
+    // Recorded command buffers reference the framebuffers, a new one may well reuse the old handle
+    for (vector<CachedCommandBuffer> &frameCache : m_CachedCommandBuffers) {
+        for (CachedCommandBuffer &cached : frameCache) cached.valid = false;
     }
 
-    vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
-    m_GraphicsPipeline = VK_NULL_HANDLE;
-
-    vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
-    m_PipelineLayout = VK_NULL_HANDLE;
-
-    vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
-    m_RenderPass = VK_NULL_HANDLE;
-
     for (const auto imageView : m_SwapChainImageViews) {
         vkDestroyImageView(m_Device, imageView, nullptr);
     }
     m_SwapChainImageViews.clear();
-
-    vkDestroySwapchainKHR(m_Device, m_SwapChain, nullptr);
-    m_SwapChain = VK_NULL_HANDLE;
-
-    // Destroy uniform buffers
-    for (size_t i = 0; i < m_UniformBuffers.size(); i++) {
-        if (m_UniformBuffers[i] != VK_NULL_HANDLE) {
-            vkDestroyBuffer(m_Device, m_UniformBuffers[i], nullptr);
-            m_UniformBuffers[i] = VK_NULL_HANDLE;
-        }
-        if (m_UniformBuffersMemory[i] != VK_NULL_HANDLE) {
-            vkFreeMemory(m_Device, m_UniformBuffersMemory[i], nullptr);
-            m_UniformBuffersMemory[i] = VK_NULL_HANDLE;
-        }
-    }
-    m_UniformBuffers.clear();
-    m_UniformBuffersMemory.clear();
-    m_UniformBuffersMapped.clear();
-
-    // Destroy descriptor pool
-    if (m_DescriptorPool != VK_NULL_HANDLE) {
-        vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
-        m_DescriptorPool = VK_NULL_HANDLE;
-    }
-
-    m_DescriptorSets.clear();
 }
+
 void Engine::recreateSwapChain() {
     int width = 0, height = 0;
     glfwGetFramebufferSize(m_Window, &width, &height);
@@ -1469,24 +2502,40 @@ void Engine::recreateSwapChain() {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(m_Device);
+    // Only the frames in flight can still reference the attachments and framebuffers, no need to idle the whole device
+    waitForFrame(m_FrameCounter);
 
     cleanupSwapChain();
 
+    const VkFormat previousImageFormat = m_SwapChainImageFormat;
     createSwapChain();
     createImageViews();
-    createRenderPass();
-    createGraphicsPipeline();
+
+    // Viewport and scissor are dynamic state, so the pipeline only has to change if the surface format did
+    if (m_SwapChainImageFormat != previousImageFormat) {
+        fprintf(stdout, "Swap chain format changed, recreating render pass and pipeline.\n");
+        // The previous render pass stays in the object cache, switching back to the format is a lookup
+        destroyGraphicsPipelines();
+        createRenderPass();
+        createGraphicsPipeline();
+    }
+
     createColorResources();
     createDepthResources();
     createFramebuffers();
+}
 
-    // Recreate uniform buffers and descriptor sets
-    createUniformBuffers();
-    createDescriptorPool();
-    createDescriptorSets();
+DEF Engine::createMemoryTracker() -> void {
+    m_MemoryTracker = std::make_unique<MemoryTracker>(m_PhysicalDevice, m_SupportsMemoryBudget);
+    if (!m_SupportsMemoryBudget) fprintf(stderr, "VK_EXT_memory_budget is not supported, heaps are only compared against their size.\n");
+}
 
-    // No need to recreate command buffers if you reset them each frame
+DEF Engine::createObjectCache() -> void {
+    m_ObjectCache = std::make_unique<VulkanObjectCache>(m_Device);
+}
+
+DEF Engine::createStagingPool() -> void {
+    m_StagingPool = std::make_unique<StagingPool>(this);
 }
 
 DEF Engine::createSurface() -> void {
@@ -1518,14 +2567,59 @@ DEF Engine::createLogicalDevice() -> void {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{.samplerAnisotropy = VK_TRUE};
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+
+    // Indirect draws are optional, without multi-draw every command is issued by its own call
+    m_SupportsIndirectDraws = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+    m_SupportsMultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    m_MaxDrawIndirectCount = m_SupportsMultiDrawIndirect ? std::max(properties.limits.maxDrawIndirectCount, 1u) : 1;
+    // Covers every BC format, textures fall back to RGBA8 without it
+    m_SupportsTextureCompression = supportedFeatures.textureCompressionBC == VK_TRUE;
+    // The downsampler writes whatever format the image has and picks the level's image by index
+    m_SupportsComputeMipmaps = supportedFeatures.shaderStorageImageWriteWithoutFormat == VK_TRUE &&
+                               supportedFeatures.shaderStorageImageArrayDynamicIndexing == VK_TRUE;
+
+    VkPhysicalDeviceFeatures deviceFeatures{
+        .multiDrawIndirect = supportedFeatures.multiDrawIndirect,
+        .drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance,
+        .samplerAnisotropy = VK_TRUE,
+        .textureCompressionBC = supportedFeatures.textureCompressionBC,
+        .fragmentStoresAndAtomics = VK_TRUE,
+        .shaderStorageImageWriteWithoutFormat = supportedFeatures.shaderStorageImageWriteWithoutFormat,
+        .shaderStorageImageArrayDynamicIndexing = supportedFeatures.shaderStorageImageArrayDynamicIndexing};
+
+    // Descriptor indexing for the bindless texture table, and the timeline semaphore frames are tracked with
+    VkPhysicalDeviceVulkan12Features vulkan12Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .descriptorBindingVariableDescriptorCount = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
+        .timelineSemaphore = VK_TRUE};
+
+    // The memory budget is optional, the memory tracker falls back to heap sizes without it
+    vector<const char *> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, nullptr);
+    vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    m_SupportsMemoryBudget = std::ranges::any_of(availableExtensions, [](const VkExtensionProperties &extension) {
+        return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+    });
+    if (m_SupportsMemoryBudget) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
     VkDeviceCreateInfo createInfo{
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &vulkan12Features,
         .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-        .ppEnabledExtensionNames = deviceExtensions.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()),
+        .ppEnabledExtensionNames = enabledExtensions.data(),
         .pEnabledFeatures = &deviceFeatures};
 
     createInfo.enabledLayerCount = 0;
@@ -1540,6 +2634,18 @@ DEF Engine::createLogicalDevice() -> void {
 
     vkGetDeviceQueue(m_Device, graphicsFamily.value(), 0, &m_GraphicsQueue);
     vkGetDeviceQueue(m_Device, presentationFamily.value(), 0, &m_PresentQueue);
+
+    setIndirectDraws(Settings::USE_INDIRECT_DRAWS);
+    setTextureCompression(Settings::COMPRESS_TEXTURES);
+}
+
+DEF Engine::setIndirectDraws(const bool useIndirectDraws) -> void {
+    if (useIndirectDraws && !m_SupportsIndirectDraws) {
+        fprintf(stderr, "Indirect draws need drawIndirectFirstInstance, which the device doesn't support, keeping direct draws.\n");
+        m_UseIndirectDraws = false;
+        return;
+    }
+    m_UseIndirectDraws = useIndirectDraws;
 }
 
 DEF Engine::pickPhysicalDevice() -> void {
@@ -1613,6 +2719,31 @@ DEF Engine::isDeviceSuitable(VkPhysicalDevice device) const -> bool {
         fprintf(stdout, "Device is unsuitable because does not support sampler Anisotropy (that is very surprising)!\n");
         return false;
     }
+    // Virtual texture feedback is counted with atomics from the fragment shader
+    if (!supportedFeatures.fragmentStoresAndAtomics) {
+        fprintf(stdout, "Device is unsuitable because it does not support fragment stores and atomics!\n");
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    VkPhysicalDeviceFeatures2 features2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &vulkan12Features};
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    if (!vulkan12Features.shaderSampledImageArrayNonUniformIndexing ||
+        !vulkan12Features.descriptorBindingSampledImageUpdateAfterBind ||
+        !vulkan12Features.descriptorBindingUpdateUnusedWhilePending ||
+        !vulkan12Features.descriptorBindingPartiallyBound ||
+        !vulkan12Features.descriptorBindingVariableDescriptorCount ||
+        !vulkan12Features.runtimeDescriptorArray) {
+        fprintf(stdout, "Device is unsuitable because it does not support the descriptor indexing features of the texture table!\n");
+        return false;
+    }
+    // Frames are tracked on a timeline semaphore, required since Vulkan 1.2 but checked all the same
+    if (!vulkan12Features.timelineSemaphore) {
+        fprintf(stdout, "Device is unsuitable because it does not support timeline semaphores!\n");
+        return false;
+    }
 
     return true;
 }
@@ -1671,7 +2802,21 @@ DEF Engine::mainLoop() -> void {
 }
 
 void Engine::drawFrame() {
-    vkWaitForFences(m_Device, 1, &m_InFlightFences[m_CurrentFrameIdx], VK_TRUE, NO_TIMEOUT);
+    // The frame that used this index last has to be done with its command buffers and frame allocator region
+    const auto waitStart = std::chrono::high_resolution_clock::now();
+    if (m_UseTimelineSemaphore) {
+        waitForFrame(m_FrameIdxFrames[m_CurrentFrameIdx]);
+    } else {
+        vkWaitForFences(m_Device, 1, &m_InFlightFences[m_CurrentFrameIdx], VK_TRUE, NO_TIMEOUT);
+        m_CompletedFrame = std::max(m_CompletedFrame, m_FrameIdxFrames[m_CurrentFrameIdx]);
+    }
+    m_LastFrameWaitMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - waitStart).count();
+    // Nothing of the previous frame's host scratch outlives its submission
+    m_FrameArena.reset();
+
+    // Pipelines finished in the background only switch in here, so a frame never changes pipelines halfway through
+    m_PipelineLibrary->beginFrame();
+    m_GraphicsPipeline = m_PipelineLibrary->acquire(static_cast<uint32_t>(m_Stage));
 
     uint32_t imageIndex = 0;
     const VkResult resultNextImage = vkAcquireNextImageKHR(
@@ -1687,35 +2832,64 @@ void Engine::drawFrame() {
         return;
     }
     if (resultNextImage != VK_SUCCESS && resultNextImage != VK_SUBOPTIMAL_KHR) throw std::runtime_error("failed to acquire swap chain image!");
-
-    vkResetFences(m_Device, 1, &m_InFlightFences[m_CurrentFrameIdx]);
-
-    vkResetCommandBuffer(m_CommandBuffers[m_CurrentFrameIdx], 0);
-    recordCommandBuffers(m_CommandBuffers[m_CurrentFrameIdx], imageIndex);
-
-    for (size_t i = 0; i < m_Models.size(); i++) {
-        UniformBufferObject ubo = m_Models[i]->getUBO();
-        const size_t bufferIndex = getCurrentFrameIdx() * m_Models.size() + i;
-        memcpy(m_UniformBuffersMapped[bufferIndex], &ubo, sizeof(ubo));
-    }
+    // Only checked once an image of the newest swap chain was acquired
+    if (!m_RetiredSwapChains.empty()) destroyRetiredSwapChains(false);
+
+    if (!m_UseTimelineSemaphore) vkResetFences(m_Device, 1, &m_InFlightFences[m_CurrentFrameIdx]);
+
+    // Everything the GPU read from this frame's region has been consumed once the frame that used it completed
+    m_FrameAllocator->beginFrame(m_CurrentFrameIdx);
+    // Same goes for the feedback the frame wrote last time it used this index
+    m_VirtualTextures->beginFrame(m_CurrentFrameIdx);
+    const TransientAllocation cameraAllocation = updateCameraUniforms();
+    const TransientAllocation objectAllocation = buildDrawBatches();
+    // Before recording, so the command buffer samples the textures this frame marked as used at their final residency
+    m_TextureManager->update(m_CurrentFrameIdx);
+    m_MemoryTracker->update();
+    m_StagingPool->update();
+    // Offsets into the frame allocator's buffer, in binding order of the dynamic descriptors
+    m_DynamicOffsets = {static_cast<uint32_t>(cameraAllocation.offset), static_cast<uint32_t>(objectAllocation.offset)};
+
+    const auto recordStart = std::chrono::high_resolution_clock::now();
+    VkCommandBuffer commandBuffer = acquireCommandBuffer(imageIndex);
+    const std::chrono::duration<double, std::milli> recordElapsed = std::chrono::high_resolution_clock::now() - recordStart;
+    m_LastRecordTimeMs = recordElapsed.count();
+
+    // Pages and page tables are copied ahead of the frame in the same submission, the barriers it records order them
+    array<VkCommandBuffer, 2> commandBuffers{};
+    uint32_t commandBufferCount = 0;
+    if (VkCommandBuffer uploads = m_VirtualTextures->recordUploads(); uploads != VK_NULL_HANDLE) commandBuffers[commandBufferCount++] = uploads;
+    commandBuffers[commandBufferCount++] = commandBuffer;
 
     array waitSemaphores = {m_ImageAvailableSemaphores[m_CurrentFrameIdx]};
     array waitStages = {static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT)};
-    array signalSemaphores = {m_RenderFinishedSemaphores[m_CurrentFrameIdx]};
+    // Presentation can only wait on the binary one, the values of binary semaphores are ignored
+    const uint64_t frame = getFrameNumber();
+    array signalSemaphores = {m_RenderFinishedSemaphores[m_CurrentFrameIdx], m_FrameTimeline};
+    array signalValues = {uint64_t{0}, frame};
+
+    const VkTimelineSemaphoreSubmitInfo timelineInfo{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size()),
+        .pSignalSemaphoreValues = signalValues.data()};
 
     VkSubmitInfo submitInfo{
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineInfo,
         .waitSemaphoreCount = 1,
         .pWaitSemaphores = waitSemaphores.data(),
         .pWaitDstStageMask = waitStages.data(),
-        .commandBufferCount = 1,
-        .pCommandBuffers = &m_CommandBuffers[m_CurrentFrameIdx],
-        .signalSemaphoreCount = 1,
+        .commandBufferCount = commandBufferCount,
+        .pCommandBuffers = commandBuffers.data(),
+        .signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size()),
         .pSignalSemaphores = signalSemaphores.data()};
 
-    if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_InFlightFences[m_CurrentFrameIdx]) != VK_SUCCESS) {
+    VkFence fence = m_UseTimelineSemaphore ? VK_NULL_HANDLE : m_InFlightFences[m_CurrentFrameIdx];
+    if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    m_FrameIdxFrames[m_CurrentFrameIdx] = frame;
+    m_FrameCounter = frame;
 
     array swapChains = {m_SwapChain};
     const VkPresentInfoKHR presentInfo{
@@ -1735,27 +2909,18 @@ void Engine::drawFrame() {
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    m_CurrentFrameIdx = (m_CurrentFrameIdx + 1) % Settings::MAX_FRAMES_IN_FLIGHT;
-    m_FrameCounter += 1;
+    m_CurrentFrameIdx = (m_CurrentFrameIdx + 1) % m_FramesInFlight;
 }
 
 DEF Engine::captureFramebuffer(uint32_t imageIndex) const -> void {
-    VkBuffer stagingBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-
     uint32_t width = m_SwapChainExtent.width;
     uint32_t height = m_SwapChainExtent.height;
     auto imageSize = width * height * 4;
 
     VkImage image = m_SwapChainImages[imageIndex];
 
-    // Create a staging buffer to copy the image data into
-    createBuffer(
-        imageSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory);
+    // A staging buffer to copy the image data into
+    const StagingBuffer staging = m_StagingPool->acquire(imageSize);
 
     // Transition the image to be copied
     transitionImageLayout(
@@ -1785,7 +2950,7 @@ DEF Engine::captureFramebuffer(uint32_t imageIndex) const -> void {
         commandBuffer,
         image,
         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        stagingBuffer,
+        staging.buffer,
         1,
         &region);
 
@@ -1799,11 +2964,8 @@ DEF Engine::captureFramebuffer(uint32_t imageIndex) const -> void {
         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
         1);
 
-    // Map the buffer memory so we can read from it
-    void *data = nullptr;
-    vkMapMemory(m_Device, stagingBufferMemory, 0, imageSize, 0, &data);
-
-    const auto *pixelData = static_cast<const uint8_t *>(data);
+    // Staging buffers stay mapped
+    const auto *pixelData = reinterpret_cast<const uint8_t *>(staging.mapped);
 
     std::ostringstream filename_builder;
     filename_builder << "./Screencaps/Raw/" << m_FrameCounter << ".bin";
@@ -1822,9 +2984,7 @@ DEF Engine::captureFramebuffer(uint32_t imageIndex) const -> void {
         std::cerr << "Failed to open file: " << filename << "\n";
     }
 
-    vkUnmapMemory(m_Device, stagingBufferMemory);
-    vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-    vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+    m_StagingPool->release(staging);
 }
 
 void Engine::cleanup() {
@@ -1836,6 +2996,41 @@ void Engine::cleanup() {
 
     cleanupSwapChain();
 
+    destroyRetiredSwapChains(true);
+    vkDestroySwapchainKHR(m_Device, m_SwapChain, nullptr);
+    m_SwapChain = VK_NULL_HANDLE;
+
+    printCommandBufferCacheStats();
+    vkFreeCommandBuffers(m_Device, m_CommandPool, static_cast<uint32_t>(m_CommandBuffers.size()), m_CommandBuffers.data());
+    m_CommandBuffers.clear();
+    // Freed together with the command pool
+    m_CachedCommandBuffers.clear();
+
+    m_PipelineLibrary->printStats();
+    destroyGraphicsPipelines();
+    m_PipelineLibrary.reset();
+    m_Downsampler.reset();
+
+    for (const auto &[shaderFilepath, shaderModule] : m_ShaderModules) {
+        vkDestroyShaderModule(m_Device, shaderModule, nullptr);
+    }
+    m_ShaderModules.clear();
+    m_StageFragShaderModule = VK_NULL_HANDLE;
+    m_StageVertShaderModule = VK_NULL_HANDLE;
+    m_ShaderBundle.reset();
+
+    m_PipelineLayout = VK_NULL_HANDLE;
+
+    savePipelineCache();
+    vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
+    m_PipelineCache = VK_NULL_HANDLE;
+
+    m_RenderPass = VK_NULL_HANDLE;
+
+    vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
+    m_DescriptorPool = VK_NULL_HANDLE;
+    m_DescriptorSet = VK_NULL_HANDLE;
+
     for (size_t i = 0; i < Settings::MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(m_Device, m_ImageAvailableSemaphores[i], nullptr);
         vkDestroySemaphore(m_Device, m_RenderFinishedSemaphores[i], nullptr);
@@ -1844,29 +3039,64 @@ void Engine::cleanup() {
     m_ImageAvailableSemaphores.clear();
     m_RenderFinishedSemaphores.clear();
     m_InFlightFences.clear();
+    vkDestroySemaphore(m_Device, m_FrameTimeline, nullptr);
+    m_FrameTimeline = VK_NULL_HANDLE;
 
-    vkDestroySampler(m_Device, m_TextureSampler, nullptr);
     m_TextureSampler = VK_NULL_HANDLE;
 
-    vkDestroyImageView(m_Device, m_TextureImageView, nullptr);
-    m_TextureImageView = VK_NULL_HANDLE;
+    m_TextureManager->printStats();
+    m_TextureManager.reset();
+
+    m_VirtualTextures->printStats();
+    m_VirtualTextures.reset();
+    m_VirtualTextureLayout = VK_NULL_HANDLE;
 
-    vkDestroyImage(m_Device, m_TextureImage, nullptr);
-    vkFreeMemory(m_Device, m_TextureImageMemory, nullptr);
-    m_TextureImage = VK_NULL_HANDLE;
-    m_TextureImageMemory = VK_NULL_HANDLE;
+    vkDestroyDescriptorPool(m_Device, m_TextureTablePool, nullptr);
+    m_TextureTablePool = VK_NULL_HANDLE;
+    m_TextureTables.fill(VK_NULL_HANDLE);
 
-    vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
+    m_TextureTableLayout = VK_NULL_HANDLE;
     m_DescriptorSetLayout = VK_NULL_HANDLE;
 
+    m_FrameArena.printStats();
+    if (m_FrameAllocator) {
+        m_FrameAllocator->printStats();
+        m_FrameAllocator.reset();
+    }
+
     for (auto &model : m_Models) {
         model.reset();
     }
     m_Models.clear();
+    // Meshes are owned by the cache once the models are gone
+    m_MeshCache.clear();
+
+    // Destroying a pool frees its command buffers
+    for (const vector<vector<RecordingContext>> &frameContexts : m_RecordingContexts) {
+        for (const vector<RecordingContext> &imageContexts : frameContexts) {
+            for (const RecordingContext &context : imageContexts) vkDestroyCommandPool(m_Device, context.commandPool, nullptr);
+        }
+    }
+    m_RecordingContexts.clear();
+    m_ThreadPool.reset();
+    m_TexturePool.reset();
+
+    // After the texture manager, which returns the staging buffers of unfinished loads
+    m_StagingPool->printStats();
+    m_StagingPool.reset();
 
     vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
     m_CommandPool = VK_NULL_HANDLE;
 
+    // Last, everything above may have used its objects
+    m_ObjectCache->printStats();
+    m_ObjectCache.reset();
+
+    // Every allocation should be gone by now, whatever is left leaked
+    m_MemoryTracker->printReport();
+    m_MemoryTracker->printLeaks();
+    m_MemoryTracker.reset();
+
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
         m_DebugMessenger = VK_NULL_HANDLE;
@@ -2077,16 +3307,38 @@ DEF Engine::lookAround(const float yawOffset, const float pitchOffset) -> void {
     m_CameraCenter = m_CameraEye + normalize(lookDirection);
 }
 
-DEF Engine::updatePushConstants() -> void {
-    m_PushConstants.cameraCenter = m_CameraCenter;
-    m_PushConstants.cameraEye = m_CameraEye;
-    m_PushConstants.cameraUp = m_CameraUp;
-    m_PushConstants.stage = m_Stage;
-
+DEF Engine::updateCameraUniforms() -> TransientAllocation {
     const std::chrono::time_point currentTime = std::chrono::high_resolution_clock::now();
     const float deltaTime = std::chrono::duration<float>(currentTime - m_StartTime).count();
 
-    m_PushConstants.time = deltaTime;
+    const mat4 view = lookAt(m_CameraEye, m_CameraCenter, m_CameraUp);
+    mat4 proj = glm::perspective(
+        PI_QUARTER,
+        static_cast<float>(m_SwapChainExtent.width) / static_cast<float>(m_SwapChainExtent.height),
+        Settings::CLIPPING_PLANE_NEAR,
+        Settings::CLIPPING_PLANE_FAR);
+    // GLM was designed for OpenGL, where the Y coordinate of the clip coordinates is inverted
+    proj[1][1] *= -1;
+
+    const CameraUBO camera{
+        .view = view,
+        .proj = proj,
+        .viewProj = proj * view,
+        .position = m_CameraEye,
+        .time = deltaTime};
+    const TransientAllocation allocation = m_FrameAllocator->allocateUniform(sizeof(camera));
+    memcpy(allocation.mapped, &camera, sizeof(camera));
+    return allocation;
+}
+
+DEF Engine::acquireMesh(const char *meshFilepath) -> std::shared_ptr<MeshNT> {
+    const auto found = m_MeshCache.find(meshFilepath);
+    if (found != m_MeshCache.end()) return found->second;
+
+    auto mesh = std::make_shared<MeshNT>(this, meshFilepath);
+    mesh->setMeshID(static_cast<uint32_t>(m_MeshCache.size()));
+    m_MeshCache.emplace(meshFilepath, mesh);
+    return mesh;
 }
 
 DEF Engine::update(const float frameTime) const -> void {
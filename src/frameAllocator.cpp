@@ -0,0 +1,91 @@
+#include "Constants.h"
+
+#include "engine/engine.h"
+#include "engine/frameAllocator.h"
+
+FrameAllocator::FrameAllocator(Engine *engine, const VkDeviceSize frameCapacity, const VkDeviceSize maxBindingRange)
+    : m_Engine(engine),
+      m_Buffer(VK_NULL_HANDLE),
+      m_Memory(VK_NULL_HANDLE),
+      m_Mapped(nullptr),
+      m_FrameCapacity(frameCapacity),
+      m_FrameIdx(0),
+      m_Head(0),
+      m_HighWaterMark(0),
+      m_AllocationCount(0) {
+    m_Device = m_Engine->getDevice();
+    if (m_Device == VK_NULL_HANDLE) throw runtime_error("Initializing frame allocator before engine device got initialized!");
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_Engine->getPhysicalDevice(), &properties);
+    m_MinUniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+    m_MinStorageAlignment = properties.limits.minStorageBufferOffsetAlignment;
+
+    // Every region has to start at an offset that is valid for any kind of binding
+    m_FrameCapacity = (m_FrameCapacity + 255) & ~static_cast<VkDeviceSize>(255);
+    const VkDeviceSize totalSize = m_FrameCapacity * Settings::MAX_FRAMES_IN_FLIGHT + maxBindingRange;
+    // Dynamic offsets are 32 bit
+    if (totalSize > std::numeric_limits<uint32_t>::max()) throw runtime_error("Frame allocator is too large to be bound with dynamic offsets!");
+
+    m_Engine->createBuffer(
+        totalSize,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_Buffer,
+        m_Memory,
+        MemoryCategory::Uniforms);
+
+    void *data = nullptr;
+    if (vkMapMemory(m_Device, m_Memory, 0, totalSize, 0, &data) != VK_SUCCESS) {
+        throw runtime_error("failed to map frame allocator memory!");
+    }
+    m_Mapped = static_cast<std::byte *>(data);
+}
+
+FrameAllocator::~FrameAllocator() {
+    vkUnmapMemory(m_Device, m_Memory);
+    vkDestroyBuffer(m_Device, m_Buffer, nullptr);
+    m_Engine->freeMemory(m_Memory);
+}
+
+DEF FrameAllocator::beginFrame(const uint32_t frameIdx) -> void {
+    m_FrameIdx = frameIdx;
+    m_Head = 0;
+}
+
+DEF FrameAllocator::allocate(const VkDeviceSize size, const VkDeviceSize alignment) -> TransientAllocation {
+    // Alignments in Vulkan are always powers of two
+    const VkDeviceSize alignedHead = (m_Head + alignment - 1) & ~(alignment - 1);
+    if (alignedHead + size > m_FrameCapacity) {
+        fprintf(stderr,
+                "FrameAllocator overflow in frame %u: requested %llu bytes (alignment %llu) with %llu of %llu bytes used, "
+                "high-water mark is %llu bytes. Increase Settings::FRAME_ALLOCATOR_CAPACITY.\n",
+                m_FrameIdx,
+                static_cast<unsigned long long>(size),
+                static_cast<unsigned long long>(alignment),
+                static_cast<unsigned long long>(m_Head),
+                static_cast<unsigned long long>(m_FrameCapacity),
+                static_cast<unsigned long long>(m_HighWaterMark));
+        throw runtime_error("FrameAllocator ran out of memory!");
+    }
+
+    const VkDeviceSize offset = static_cast<VkDeviceSize>(m_FrameIdx) * m_FrameCapacity + alignedHead;
+    m_Head = alignedHead + size;
+    m_HighWaterMark = std::max(m_HighWaterMark, m_Head);
+    m_AllocationCount += 1;
+
+    return TransientAllocation{
+        .buffer = m_Buffer,
+        .offset = offset,
+        .size = size,
+        .mapped = m_Mapped + offset};
+}
+
+DEF FrameAllocator::printStats() const -> void {
+    fprintf(stdout, "FrameAllocator: %llu allocations, high-water mark %.2f KiB of %.2f KiB per frame (%.1f%%)\n",
+            static_cast<unsigned long long>(m_AllocationCount),
+            static_cast<double>(m_HighWaterMark) / 1024.0,
+            static_cast<double>(m_FrameCapacity) / 1024.0,
+            100.0 * static_cast<double>(m_HighWaterMark) / static_cast<double>(m_FrameCapacity));
+}
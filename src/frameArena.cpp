@@ -0,0 +1,62 @@
+#include "Constants.h"
+
+#include "engine/frameArena.h"
+
+FrameArena::FrameArena(const size_t capacity)
+    : m_Head(0),
+      m_Capacity(0),
+      m_Used(0),
+      m_HighWaterMark(0),
+      m_OverflowCount(0) {
+    if (capacity == 0) throw runtime_error("Frame arena needs a capacity!");
+    addBlock(capacity);
+}
+
+DEF FrameArena::addBlock(const size_t size) -> void {
+    m_Blocks.push_back(Block{.data = std::make_unique_for_overwrite<std::byte[]>(size), .size = size});
+    m_Head = 0;
+    m_Capacity += size;
+}
+
+DEF FrameArena::reset() -> void {
+    if (m_Blocks.size() > 1) {
+        // The blocks are released before the merged one is allocated, so both are never alive at the same time
+        const size_t capacity = m_Capacity;
+        m_Blocks.clear();
+        m_Capacity = 0;
+        addBlock(capacity);
+        m_OverflowCount++;
+        fprintf(stdout, "FrameArena grew to %.2f KiB, increase Settings::FRAME_ARENA_CAPACITY to avoid it.\n", static_cast<double>(capacity) / 1024.0);
+    }
+    m_Head = 0;
+    m_Used = 0;
+}
+
+DEF FrameArena::allocate(const size_t size, const size_t alignment) -> void * {
+    if (!std::has_single_bit(alignment)) throw runtime_error("Frame arena alignment has to be a power of two!");
+
+    // Aligned by address, the blocks themselves only have the alignment of operator new
+    const auto alignUp = [alignment](const uintptr_t address) { return (address + alignment - 1) & ~(alignment - 1); };
+    auto base = reinterpret_cast<uintptr_t>(m_Blocks.back().data.get());
+    uintptr_t start = alignUp(base + m_Head);
+    if (start + size > base + m_Blocks.back().size) {
+        // Room for the worst case padding, so the allocation surely fits the new block
+        addBlock(std::max(m_Blocks.back().size, size + alignment));
+        base = reinterpret_cast<uintptr_t>(m_Blocks.back().data.get());
+        start = alignUp(base);
+    }
+
+    const size_t end = start + size - base;
+    m_Used += end - m_Head;
+    m_Head = end;
+    m_HighWaterMark = std::max(m_HighWaterMark, m_Used);
+    return m_Blocks.back().data.get() + (start - base);
+}
+
+DEF FrameArena::printStats() const -> void {
+    fprintf(stdout, "FrameArena: high-water mark %.2f KiB of %.2f KiB (%.1f%%), grew %llu times\n",
+            static_cast<double>(m_HighWaterMark) / 1024.0,
+            static_cast<double>(m_Capacity) / 1024.0,
+            100.0 * static_cast<double>(m_HighWaterMark) / static_cast<double>(m_Capacity),
+            static_cast<unsigned long long>(m_OverflowCount));
+}
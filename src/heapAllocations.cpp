@@ -0,0 +1,55 @@
+#include "Constants.h"
+
+#include "engine/heapAllocations.h"
+
+// The array, nothrow and aligned array forms of new and delete default to calling these, so they are counted as well
+
+namespace {
+    // Relaxed, the counters only have to add up, not order anything
+    std::atomic<uint64_t> allocationCount{0};
+    std::atomic<uint64_t> allocatedBytes{0};
+
+    DEF count(const size_t size) -> void {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+} // namespace
+
+DEF HeapAllocations::getCount() -> uint64_t {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+DEF HeapAllocations::getBytes() -> uint64_t {
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+void *operator new(const size_t size) {
+    count(size);
+    // Zero sized allocations still have to return a unique pointer
+    if (void *pointer = std::malloc(std::max<size_t>(size, 1))) return pointer;
+    throw std::bad_alloc();
+}
+
+void *operator new(const size_t size, const std::align_val_t alignment) {
+    count(size);
+    // aligned_alloc wants a multiple of the alignment as size
+    const auto align = static_cast<size_t>(alignment);
+    if (void *pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) & ~(align - 1))) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
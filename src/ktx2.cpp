@@ -0,0 +1,222 @@
+#include "Constants.h"
+
+#include "engine/blockCompression.h"
+#include "engine/ktx2.h"
+
+namespace {
+    constexpr array<uint8_t, 12> IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    // Keys starting with "KTX" or "ktx" are reserved by the spec
+    constexpr auto SOURCE_STAMP_KEY = "engine.sourceStamp";
+
+    // Khronos Data Format values used by the descriptors below
+    constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+    constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+    constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+    constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+    struct Header {
+        array<uint8_t, 12> identifier;
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "KTX2 header has to match the file layout");
+
+    struct LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    struct Sample {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channel;
+    };
+
+    DEF isSrgb(const VkFormat format) -> bool {
+        return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+
+    // Basic descriptor block of the Khronos Data Format spec, which KTX2 requires even though Vulkan only needs vkFormat
+    DEF makeDataFormatDescriptor(const VkFormat format) -> vector<uint32_t> {
+        uint32_t colorModel = KHR_DF_MODEL_BC7;
+        vector<Sample> samples;
+        switch (format) {
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                colorModel = KHR_DF_MODEL_BC1A;
+                samples = {{0, 64, 0}};
+                break;
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+                colorModel = KHR_DF_MODEL_BC3;
+                // Alpha is never sRGB encoded, which the linear qualifier says
+                samples = {{0, 64, 15 | (isSrgb(format) ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0)}, {64, 64, 0}};
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                colorModel = KHR_DF_MODEL_BC5;
+                samples = {{0, 64, 0}, {64, 64, 1}};
+                break;
+            default:
+                samples = {{0, 128, 0}};
+                break;
+        }
+
+        const auto blockSize = static_cast<uint32_t>(BlockCompression::getBlockSize(format));
+        const auto descriptorBlockSize = static_cast<uint32_t>(24 + 16 * samples.size());
+        vector<uint32_t> words{
+            4 + descriptorBlockSize, // dfdTotalSize
+            0,                       // vendorId and descriptorType, both Khronos basic
+            2 | descriptorBlockSize << 16,
+            colorModel | KHR_DF_PRIMARIES_BT709 << 8 | (isSrgb(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16,
+            3 | 3 << 8, // 4x4x1x1 texel blocks, stored minus one
+            blockSize,  // bytesPlane0
+            0};
+        for (const Sample &sample : samples) {
+            words.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+            words.push_back(0);          // Sample position
+            words.push_back(0);          // sampleLower
+            words.push_back(UINT32_MAX); // sampleUpper
+        }
+        return words;
+    }
+
+    DEF appendKeyValue(vector<std::byte> &data, const string_view key, const string_view value) -> void {
+        const auto length = static_cast<uint32_t>(key.size() + 1 + value.size() + 1);
+        const auto *lengthBytes = reinterpret_cast<const std::byte *>(&length);
+        data.insert(data.end(), lengthBytes, lengthBytes + sizeof(length));
+        const auto *keyBytes = reinterpret_cast<const std::byte *>(key.data());
+        data.insert(data.end(), keyBytes, keyBytes + key.size());
+        data.push_back(std::byte{0});
+        const auto *valueBytes = reinterpret_cast<const std::byte *>(value.data());
+        data.insert(data.end(), valueBytes, valueBytes + value.size());
+        data.push_back(std::byte{0});
+        data.resize((data.size() + 3) & ~size_t{3});
+    }
+
+    DEF alignUp(const size_t value, const size_t alignment) -> size_t {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+DEF Ktx2::readInfo(const std::filesystem::path &filepath) -> optional<Info> {
+    std::error_code error;
+    const uintmax_t fileSize = std::filesystem::file_size(filepath, error);
+    if (error || fileSize < sizeof(Header)) return std::nullopt;
+
+    std::ifstream file(filepath, std::ios::binary);
+    Header header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(Header));
+    if (!file || header.identifier != IDENTIFIER) return std::nullopt;
+
+    const auto format = static_cast<VkFormat>(header.vkFormat);
+    if (!BlockCompression::isSupported(format) || header.supercompressionScheme != 0 || header.pixelDepth != 0 ||
+        header.layerCount > 1 || header.faceCount != 1 || header.levelCount == 0) {
+        return std::nullopt;
+    }
+
+    vector<LevelIndex> levelIndex(header.levelCount);
+    file.read(reinterpret_cast<char *>(levelIndex.data()), static_cast<std::streamsize>(levelIndex.size() * sizeof(LevelIndex)));
+    if (!file) return std::nullopt;
+
+    Info info{.format = format, .width = header.pixelWidth, .height = header.pixelHeight, .levels = {}, .sourceStamp = {}};
+    for (const LevelIndex &level : levelIndex) {
+        if (level.byteOffset > fileSize || level.byteLength > fileSize - level.byteOffset) return std::nullopt;
+        info.levels.push_back({.byteOffset = level.byteOffset, .byteLength = level.byteLength});
+    }
+
+    if (static_cast<uintmax_t>(header.kvdByteOffset) + header.kvdByteLength > fileSize) return std::nullopt;
+    vector<char> keyValueData(header.kvdByteLength);
+    file.seekg(header.kvdByteOffset);
+    file.read(keyValueData.data(), static_cast<std::streamsize>(keyValueData.size()));
+    if (!file) return std::nullopt;
+
+    for (size_t offset = 0; offset + sizeof(uint32_t) <= keyValueData.size();) {
+        uint32_t length = 0;
+        std::memcpy(&length, keyValueData.data() + offset, sizeof(length));
+        offset += sizeof(length);
+        if (length > keyValueData.size() - offset) return std::nullopt;
+
+        // Key and value are both zero terminated
+        const string_view entry(keyValueData.data() + offset, length);
+        const size_t keyEnd = entry.find('\0');
+        if (keyEnd != string_view::npos && entry.substr(0, keyEnd) == SOURCE_STAMP_KEY) {
+            const string_view value = entry.substr(keyEnd + 1);
+            info.sourceStamp = string(value.substr(0, value.find('\0')));
+        }
+        offset = alignUp(offset + length, 4);
+    }
+    return info;
+}
+
+DEF Ktx2::write(
+    const std::filesystem::path &filepath,
+    const VkFormat format,
+    const uint32_t width,
+    const uint32_t height,
+    const std::span<const std::span<const std::byte>> levels,
+    const string &sourceStamp) -> bool {
+
+    const vector<uint32_t> dataFormatDescriptor = makeDataFormatDescriptor(format);
+    vector<std::byte> keyValueData;
+    appendKeyValue(keyValueData, "KTXwriter", Settings::PROJECT_NAME);
+    appendKeyValue(keyValueData, SOURCE_STAMP_KEY, sourceStamp);
+
+    Header header{
+        .identifier = IDENTIFIER,
+        .vkFormat = static_cast<uint32_t>(format),
+        .typeSize = 1,
+        .pixelWidth = width,
+        .pixelHeight = height,
+        .pixelDepth = 0,
+        .layerCount = 0,
+        .faceCount = 1,
+        .levelCount = static_cast<uint32_t>(levels.size()),
+        .supercompressionScheme = 0,
+        .dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + levels.size() * sizeof(LevelIndex)),
+        .dfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size() * sizeof(uint32_t)),
+        .kvdByteOffset = 0,
+        .kvdByteLength = static_cast<uint32_t>(keyValueData.size()),
+        .sgdByteOffset = 0,
+        .sgdByteLength = 0};
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+
+    // Smallest level first so a streaming reader gets a usable image early, each one aligned to the block size
+    const size_t alignment = BlockCompression::getBlockSize(format);
+    vector<LevelIndex> levelIndex(levels.size());
+    size_t fileSize = header.kvdByteOffset + header.kvdByteLength;
+    for (size_t level = levels.size(); level-- > 0;) {
+        fileSize = alignUp(fileSize, alignment);
+        levelIndex[level] = {.byteOffset = fileSize, .byteLength = levels[level].size(), .uncompressedByteLength = levels[level].size()};
+        fileSize += levels[level].size();
+    }
+
+    vector<std::byte> data(fileSize);
+    std::memcpy(data.data(), &header, sizeof(Header));
+    std::memcpy(data.data() + sizeof(Header), levelIndex.data(), levelIndex.size() * sizeof(LevelIndex));
+    std::memcpy(data.data() + header.dfdByteOffset, dataFormatDescriptor.data(), header.dfdByteLength);
+    std::memcpy(data.data() + header.kvdByteOffset, keyValueData.data(), keyValueData.size());
+    for (size_t level = 0; level < levels.size(); level++) {
+        std::memcpy(data.data() + levelIndex[level].byteOffset, levels[level].data(), levels[level].size());
+    }
+
+    // Renamed into place, a crash mid-write never leaves a truncated texture that would pass as cached
+    return Util::writeFileAtomically(filepath, data);
+}
@@ -15,6 +15,15 @@ DEF main() -> int {
         return EXIT_FAILURE;
     }
 
+    if constexpr (Settings::RUN_BENCHMARKS) {
+        try {
+            engine.runBenchmarks();
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
     GLFWwindow *mainWindow = engine.getWindow();
     Game game(&engine);
 
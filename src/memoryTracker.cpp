@@ -0,0 +1,225 @@
+#include "Constants.h"
+
+#include "engine/memoryTracker.h"
+
+namespace {
+    constexpr size_t CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::Count);
+    static_assert(Settings::MEMORY_CATEGORY_WARNING_BYTES.size() == CATEGORY_COUNT, "One warning threshold per memory category");
+
+    DEF toMB(const VkDeviceSize bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    DEF describeProperties(const VkMemoryPropertyFlags flags) -> string {
+        constexpr array<std::pair<VkMemoryPropertyFlagBits, const char *>, 5> names = {{
+            {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "device local"},
+            {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "host visible"},
+            {VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "host coherent"},
+            {VK_MEMORY_PROPERTY_HOST_CACHED_BIT, "host cached"},
+            {VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, "lazily allocated"},
+        }};
+        string description;
+        for (const auto &[bit, name] : names) {
+            if ((flags & bit) == 0) continue;
+            if (!description.empty()) description += ", ";
+            description += name;
+        }
+        return description.empty() ? "no properties" : description;
+    }
+} // namespace
+
+MemoryTracker::MemoryTracker(VkPhysicalDevice physicalDevice, const bool memoryBudget)
+    : m_PhysicalDevice(physicalDevice),
+      m_MemoryProperties(),
+      m_HasMemoryBudget(memoryBudget),
+      m_Categories(),
+      m_CategoryWarnings(),
+      m_Frame(0) {
+    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &m_MemoryProperties);
+    m_Types.resize(m_MemoryProperties.memoryTypeCount, Usage{.bytes = 0, .peakBytes = 0, .allocations = 0});
+    m_HeapWarnings.resize(m_MemoryProperties.memoryHeapCount, false);
+}
+
+DEF MemoryTracker::onAllocate(VkDeviceMemory memory, const VkDeviceSize size, const uint32_t memoryTypeIndex, const MemoryCategory category) -> void {
+    std::lock_guard lock(m_Mutex);
+    m_Allocations.emplace(memory, Allocation{.size = size, .memoryTypeIndex = memoryTypeIndex, .category = category});
+    add(m_Categories[static_cast<size_t>(category)], size);
+    add(m_Types[memoryTypeIndex], size);
+}
+
+DEF MemoryTracker::onFree(VkDeviceMemory memory) -> void {
+    if (memory == VK_NULL_HANDLE) return;
+
+    std::lock_guard lock(m_Mutex);
+    const auto found = m_Allocations.find(memory);
+    if (found == m_Allocations.end()) {
+        fprintf(stderr, "Freeing device memory the memory tracker never saw allocated!\n");
+        return;
+    }
+    const Allocation &allocation = found->second;
+    remove(m_Categories[static_cast<size_t>(allocation.category)], allocation.size);
+    remove(m_Types[allocation.memoryTypeIndex], allocation.size);
+    m_Allocations.erase(found);
+}
+
+DEF MemoryTracker::add(Usage &usage, const VkDeviceSize size) -> void {
+    usage.bytes += size;
+    usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+    usage.allocations++;
+}
+
+DEF MemoryTracker::remove(Usage &usage, const VkDeviceSize size) -> void {
+    usage.bytes -= size;
+    usage.allocations--;
+}
+
+DEF MemoryTracker::update() -> void {
+    m_Frame++;
+    if (m_Frame % Settings::MEMORY_CHECK_INTERVAL_FRAMES == 0) checkThresholds();
+    if (Settings::MEMORY_REPORT_INTERVAL_FRAMES > 0 && m_Frame % Settings::MEMORY_REPORT_INTERVAL_FRAMES == 0) dumpReport(FilePaths::MEMORY_REPORT);
+}
+
+DEF MemoryTracker::checkThresholds() -> void {
+    const HeapBudgets heaps = getHeapBudgets();
+    for (size_t heap = 0; heap < getHeapCount(); heap++) {
+        const HeapBudget &budget = heaps[heap];
+        const bool over = static_cast<double>(budget.usage) > Settings::MEMORY_HEAP_WARNING_FRACTION * static_cast<double>(budget.budget);
+        if (over && !m_HeapWarnings[heap]) {
+            fprintf(stderr, "Memory heap %zu is at %.2f of %.2f MB (%.0f%%), %.2f MB of it allocated by the engine!\n",
+                    heap,
+                    toMB(budget.usage),
+                    toMB(budget.budget),
+                    100.0 * static_cast<double>(budget.usage) / static_cast<double>(std::max<VkDeviceSize>(budget.budget, 1)),
+                    toMB(budget.tracked));
+        }
+        m_HeapWarnings[heap] = over;
+    }
+
+    for (size_t category = 0; category < CATEGORY_COUNT; category++) {
+        const VkDeviceSize bytes = getCategoryUsage(static_cast<MemoryCategory>(category)).bytes;
+        const bool over = bytes > Settings::MEMORY_CATEGORY_WARNING_BYTES[category];
+        if (over && !m_CategoryWarnings[category]) {
+            fprintf(stderr, "%s use %.2f MB of device memory, more than the %.2f MB expected!\n",
+                    getCategoryName(static_cast<MemoryCategory>(category)),
+                    toMB(bytes),
+                    toMB(Settings::MEMORY_CATEGORY_WARNING_BYTES[category]));
+        }
+        m_CategoryWarnings[category] = over;
+    }
+}
+
+DEF MemoryTracker::getCategoryUsage(const MemoryCategory category) const -> Usage {
+    std::lock_guard lock(m_Mutex);
+    return m_Categories[static_cast<size_t>(category)];
+}
+
+DEF MemoryTracker::getHeapBudgets() const -> HeapBudgets {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 properties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = m_HasMemoryBudget ? &budgetProperties : nullptr};
+    if (m_HasMemoryBudget) vkGetPhysicalDeviceMemoryProperties2(m_PhysicalDevice, &properties);
+
+    HeapBudgets heaps{};
+    std::lock_guard lock(m_Mutex);
+    for (uint32_t type = 0; type < m_MemoryProperties.memoryTypeCount; type++) {
+        heaps[m_MemoryProperties.memoryTypes[type].heapIndex].tracked += m_Types[type].bytes;
+    }
+    for (uint32_t heap = 0; heap < m_MemoryProperties.memoryHeapCount; heap++) {
+        heaps[heap].size = m_MemoryProperties.memoryHeaps[heap].size;
+        heaps[heap].budget = m_HasMemoryBudget ? budgetProperties.heapBudget[heap] : heaps[heap].size;
+        heaps[heap].usage = m_HasMemoryBudget ? budgetProperties.heapUsage[heap] : heaps[heap].tracked;
+    }
+    return heaps;
+}
+
+DEF MemoryTracker::getReport() const -> string {
+    const HeapBudgets heaps = getHeapBudgets();
+
+    std::lock_guard lock(m_Mutex);
+    string report = std::format("Device memory after {} frames, {} allocations ({}):\n",
+                                m_Frame,
+                                m_Allocations.size(),
+                                m_HasMemoryBudget ? "driver budget from VK_EXT_memory_budget" : "no driver budget, heap sizes instead");
+
+    report += "\tBy category:\n";
+    for (size_t category = 0; category < CATEGORY_COUNT; category++) {
+        const Usage &usage = m_Categories[category];
+        report += std::format("\t\t{:<12} {:10.2f} MB in {:5} allocations, peak {:10.2f} MB\n",
+                              getCategoryName(static_cast<MemoryCategory>(category)),
+                              toMB(usage.bytes),
+                              usage.allocations,
+                              toMB(usage.peakBytes));
+    }
+
+    report += "\tBy heap:\n";
+    for (size_t heap = 0; heap < getHeapCount(); heap++) {
+        const HeapBudget &budget = heaps[heap];
+        const bool deviceLocal = (m_MemoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        report += std::format("\t\tHeap {} ({}): {:.2f} MB allocated by the engine, {:.2f} MB used of {:.2f} MB budget, {:.2f} MB heap\n",
+                              heap,
+                              deviceLocal ? "device local" : "host",
+                              toMB(budget.tracked),
+                              toMB(budget.usage),
+                              toMB(budget.budget),
+                              toMB(budget.size));
+    }
+
+    report += "\tBy memory type:\n";
+    for (uint32_t type = 0; type < m_MemoryProperties.memoryTypeCount; type++) {
+        const Usage &usage = m_Types[type];
+        if (usage.peakBytes == 0) continue;
+        report += std::format("\t\tType {} (heap {}, {}): {:.2f} MB in {} allocations, peak {:.2f} MB\n",
+                              type,
+                              m_MemoryProperties.memoryTypes[type].heapIndex,
+                              describeProperties(m_MemoryProperties.memoryTypes[type].propertyFlags),
+                              toMB(usage.bytes),
+                              usage.allocations,
+                              toMB(usage.peakBytes));
+    }
+    return report;
+}
+
+DEF MemoryTracker::printReport() const -> void {
+    fprintf(stdout, "%s", getReport().c_str());
+}
+
+DEF MemoryTracker::dumpReport(const char *filepath) const -> void {
+    const std::filesystem::path path(filepath);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    std::ofstream file(path, std::ios::app);
+    file << getReport() << "\n";
+    if (!file) fprintf(stderr, "Failed to write the memory report to '%s'.\n", filepath);
+}
+
+DEF MemoryTracker::printLeaks() const -> void {
+    std::lock_guard lock(m_Mutex);
+    if (m_Allocations.empty()) {
+        fprintf(stdout, "Memory tracker: every allocation was freed.\n");
+        return;
+    }
+
+    array<Usage, CATEGORY_COUNT> leaked{};
+    for (const auto &[memory, allocation] : m_Allocations) add(leaked[static_cast<size_t>(allocation.category)], allocation.size);
+    fprintf(stderr, "Memory tracker: %zu allocations were never freed!\n", m_Allocations.size());
+    for (size_t category = 0; category < CATEGORY_COUNT; category++) {
+        if (leaked[category].allocations == 0) continue;
+        fprintf(stderr, "\t%s: %.2f MB in %u allocations\n",
+                getCategoryName(static_cast<MemoryCategory>(category)),
+                toMB(leaked[category].bytes),
+                leaked[category].allocations);
+    }
+}
+
+DEF MemoryTracker::getCategoryName(const MemoryCategory category) -> const char * {
+    switch (category) {
+        case MemoryCategory::Meshes: return "Meshes";
+        case MemoryCategory::Textures: return "Textures";
+        case MemoryCategory::Uniforms: return "Uniforms";
+        case MemoryCategory::Attachments: return "Attachments";
+        case MemoryCategory::Staging: return "Staging";
+        default: return "Other";
+    }
+}
@@ -6,7 +6,7 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
-MeshNT::MeshNT(Engine *engine, const char *assetFilepath) : m_Engine(engine), m_Filepath(assetFilepath) {
+MeshNT::MeshNT(Engine *engine, const char *assetFilepath) : m_Engine(engine), m_Filepath(assetFilepath), m_MeshID(0) {
     m_Device = m_Engine->getDevice();
     if (m_Device == VK_NULL_HANDLE) throw std::runtime_error("Initializing mesh before engine device got initialized!");
     loadModel();
@@ -19,18 +19,41 @@ MeshNT::MeshNT(Engine *engine, const char *assetFilepath) : m_Engine(engine), m_
 MeshNT::~MeshNT() {
     std::cout << "Cleaning up Mesh.\n";
     vkDestroyBuffer(m_Device, m_IndexBuffer, nullptr);
-    vkFreeMemory(m_Device, m_IndexBufferMemory, nullptr);
+    m_Engine->freeMemory(m_IndexBufferMemory);
     vkDestroyBuffer(m_Device, m_VertexBuffer, nullptr);
-    vkFreeMemory(m_Device, m_VertexBufferMemory, nullptr);
+    m_Engine->freeMemory(m_VertexBufferMemory);
     std::cout << "Finished cleaning up Mesh.\n";
 }
 
-VkBuffer              MeshNT::getVertexBuffer()            const { return m_VertexBuffer;       }
-VkBuffer              MeshNT::getVertexIndexBuffer()       const { return m_IndexBuffer;        }
-VkDeviceMemory        MeshNT::getVertexBufferMemory()      const { return m_VertexBufferMemory; }
-VkDeviceMemory        MeshNT::getVertexIndexBufferMemory() const { return m_IndexBufferMemory;  }
-std::vector<VertexNT> MeshNT::getVertices()                const { return m_Vertices;           }
-std::vector<uint32_t> MeshNT::getVertexIndices()           const { return m_VertexIndices;      }
+VkBuffer                  MeshNT::getVertexBuffer()            const { return m_VertexBuffer;       }
+VkBuffer                  MeshNT::getVertexIndexBuffer()       const { return m_IndexBuffer;        }
+VkDeviceMemory            MeshNT::getVertexBufferMemory()      const { return m_VertexBufferMemory; }
+VkDeviceMemory            MeshNT::getVertexIndexBufferMemory() const { return m_IndexBufferMemory;  }
+std::span<const VertexNT> MeshNT::getVertices()                const { return m_Vertices;           }
+std::span<const uint32_t> MeshNT::getVertexIndices()           const { return m_VertexIndices;      }
+
+DEF MeshNT::enqueueIntoCommandBuffer(VkCommandBuffer commandBuffer, const uint32_t firstInstance, const uint32_t instanceCount) const -> void {
+    bind(commandBuffer);
+    draw(commandBuffer, firstInstance, instanceCount);
+}
+
+DEF MeshNT::bind(VkCommandBuffer commandBuffer) const -> void {
+    std::array vertexBuffers = {m_VertexBuffer};
+    std::array<VkDeviceSize, 1> offsets = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers.data(), offsets.data());
+
+    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+DEF MeshNT::draw(VkCommandBuffer commandBuffer, const uint32_t firstInstance, const uint32_t instanceCount) const -> void {
+    vkCmdDrawIndexed(
+        commandBuffer,
+        getIndexCount(),
+        instanceCount,
+        0,
+        0,
+        firstInstance);
+}
 
 void MeshNT::loadModel() {
     if (!std::filesystem::exists(m_Filepath)) {
@@ -93,59 +116,27 @@ void MeshNT::loadModel() {
 void MeshNT::createVertexBuffer() {
     VkDeviceSize bufferSize = sizeof(m_Vertices[0]) * m_Vertices.size();
 
-    VkBuffer stagingBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-    m_Engine->createBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory);
-
-    void *data = nullptr;
-    vkMapMemory(m_Device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_Vertices.data(), static_cast<uint32_t>(bufferSize));
-    vkUnmapMemory(m_Device, stagingBufferMemory);
-
     m_Engine->createBuffer(
         bufferSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         m_VertexBuffer,
-        m_VertexBufferMemory);
+        m_VertexBufferMemory,
+        MemoryCategory::Meshes);
 
-    m_Engine->copyBuffer(stagingBuffer, m_VertexBuffer, bufferSize);
-
-    vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-    vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+    m_Engine->uploadBuffer(m_VertexBuffer, m_Vertices.data(), bufferSize);
 }
 
 void MeshNT::createIndexBuffer() {
     VkDeviceSize bufferSize = sizeof(m_VertexIndices[0]) * m_VertexIndices.size();
 
-    VkBuffer stagingBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-    m_Engine->createBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory);
-
-    void *data = nullptr;
-    vkMapMemory(m_Device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_VertexIndices.data(), static_cast<uint32_t>(bufferSize));
-    vkUnmapMemory(m_Device, stagingBufferMemory);
-
     m_Engine->createBuffer(
         bufferSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         m_IndexBuffer,
-        m_IndexBufferMemory);
-
-    m_Engine->copyBuffer(stagingBuffer, m_IndexBuffer, bufferSize);
+        m_IndexBufferMemory,
+        MemoryCategory::Meshes);
 
-    vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-    vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+    m_Engine->uploadBuffer(m_IndexBuffer, m_VertexIndices.data(), bufferSize);
 }
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "Constants.h"
+
+#include "engine/mipGenerator.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIP_GENERATOR_NEON
+#endif
+
+namespace {
+    // Linear values are quantized this finely before encoding, a step stays below a fifth of an 8 bit sRGB level
+    constexpr uint32_t ENCODE_TABLE_SIZE = 16384;
+    // Levels smaller than this many texels aren't worth handing to the workers
+    constexpr uint32_t MIN_PARALLEL_TEXELS = 128 * 128;
+
+    DEF srgbToLinear(const float value) -> float {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    DEF linearToSrgb(const float value) -> float {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    struct Tables {
+        array<float, 256> srgbDecode;
+        array<float, 256> unormDecode;
+        array<uint8_t, ENCODE_TABLE_SIZE> srgbEncode;
+    };
+
+    DEF getTables() -> const Tables & {
+        static const Tables tables = [] {
+            Tables result{};
+            for (uint32_t i = 0; i < 256; i++) {
+                result.srgbDecode[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+                result.unormDecode[i] = static_cast<float>(i) / 255.0f;
+            }
+            for (uint32_t i = 0; i < ENCODE_TABLE_SIZE; i++) {
+                const float linear = static_cast<float>(i) / static_cast<float>(ENCODE_TABLE_SIZE - 1);
+                result.srgbEncode[i] = static_cast<uint8_t>(std::lround(linearToSrgb(linear) * 255.0f));
+            }
+            return result;
+        }();
+        return tables;
+    }
+
+    // One RGBA texel, the four channels go through the filter in a single vector register
+    DEF averageTexels(const float *a, const float *b, const float *c, const float *d, float *output) -> void {
+#if defined(MIP_GENERATOR_SSE2)
+        const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)), _mm_add_ps(_mm_loadu_ps(c), _mm_loadu_ps(d)));
+        _mm_storeu_ps(output, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#elif defined(MIP_GENERATOR_NEON)
+        const float32x4_t sum = vaddq_f32(vaddq_f32(vld1q_f32(a), vld1q_f32(b)), vaddq_f32(vld1q_f32(c), vld1q_f32(d)));
+        vst1q_f32(output, vmulq_n_f32(sum, 0.25f));
+#else
+        for (int channel = 0; channel < 4; channel++) output[channel] = (a[channel] + b[channel] + c[channel] + d[channel]) * 0.25f;
+#endif
+    }
+
+    // Clamps to [0, 1] and scales color to the encode table and alpha to 8 bits, rounding to nearest
+    DEF quantizeTexel(const float *texel, const float colorScale, array<int32_t, 4> &quantized) -> void {
+#if defined(MIP_GENERATOR_SSE2)
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texel), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        const __m128 scaled = _mm_mul_ps(clamped, _mm_set_ps(255.0f, colorScale, colorScale, colorScale));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(quantized.data()), _mm_cvtps_epi32(scaled));
+#elif defined(MIP_GENERATOR_NEON)
+        const float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(texel), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+        const array<float, 4> scale = {colorScale, colorScale, colorScale, 255.0f};
+        vst1q_s32(quantized.data(), vcvtnq_s32_f32(vmulq_f32(clamped, vld1q_f32(scale.data()))));
+#else
+        for (int channel = 0; channel < 4; channel++) {
+            const float scale = channel < 3 ? colorScale : 255.0f;
+            quantized[channel] = static_cast<int32_t>(std::lround(std::clamp(texel[channel], 0.0f, 1.0f) * scale));
+        }
+#endif
+    }
+
+    // Filters rows [firstRow, endRow) of the level below `source`, which is either the RGBA8 base level or the
+    // linear floats of the previous level
+    DEF filterRows(
+        const uint8_t *base,
+        const float *source,
+        const uint32_t sourceWidth,
+        const uint32_t sourceHeight,
+        const bool srgb,
+        const uint32_t firstRow,
+        const uint32_t endRow,
+        float *linearOutput,
+        uint8_t *output) -> void {
+
+        const Tables &tables = getTables();
+        const array<float, 256> &colorDecode = srgb ? tables.srgbDecode : tables.unormDecode;
+        const float colorScale = srgb ? static_cast<float>(ENCODE_TABLE_SIZE - 1) : 255.0f;
+        const uint32_t width = std::max(sourceWidth / 2, 1u);
+
+        array<array<float, 4>, 4> decoded{};
+        array<int32_t, 4> quantized{};
+        for (uint32_t y = firstRow; y < endRow; y++) {
+            // Odd sizes drop the last row and column like the blits do, clamping covers levels that are a single texel wide
+            const array<uint32_t, 2> rows = {std::min(y * 2, sourceHeight - 1), std::min(y * 2 + 1, sourceHeight - 1)};
+            for (uint32_t x = 0; x < width; x++) {
+                const array<uint32_t, 2> columns = {std::min(x * 2, sourceWidth - 1), std::min(x * 2 + 1, sourceWidth - 1)};
+                array<const float *, 4> texels{};
+                for (uint32_t i = 0; i < 4; i++) {
+                    const size_t index = static_cast<size_t>(rows[i / 2]) * sourceWidth + columns[i % 2];
+                    if (base != nullptr) {
+                        const uint8_t *texel = base + index * 4;
+                        decoded[i] = {colorDecode[texel[0]], colorDecode[texel[1]], colorDecode[texel[2]], tables.unormDecode[texel[3]]};
+                        texels[i] = decoded[i].data();
+                    } else {
+                        texels[i] = source + index * 4;
+                    }
+                }
+
+                float *linear = linearOutput + (static_cast<size_t>(y) * width + x) * 4;
+                averageTexels(texels[0], texels[1], texels[2], texels[3], linear);
+
+                quantizeTexel(linear, colorScale, quantized);
+                uint8_t *texel = output + (static_cast<size_t>(y) * width + x) * 4;
+                for (int channel = 0; channel < 3; channel++) {
+                    texel[channel] = srgb ? tables.srgbEncode[quantized[channel]] : static_cast<uint8_t>(quantized[channel]);
+                }
+                texel[3] = static_cast<uint8_t>(quantized[3]);
+            }
+        }
+    }
+} // namespace
+
+DEF MipGenerator::generate(
+    const uint8_t *rgba,
+    const uint32_t width,
+    const uint32_t height,
+    const uint32_t mipLevels,
+    const bool srgb,
+    ThreadPool &threadPool) -> vector<vector<uint8_t>> {
+
+    vector<vector<uint8_t>> levels;
+    vector<float> previousLinear;
+    vector<float> linear;
+    uint32_t sourceWidth = width;
+    uint32_t sourceHeight = height;
+
+    for (uint32_t level = 1; level < mipLevels; level++) {
+        const uint32_t levelWidth = std::max(sourceWidth / 2, 1u);
+        const uint32_t levelHeight = std::max(sourceHeight / 2, 1u);
+        linear.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+        vector<uint8_t> &output = levels.emplace_back(static_cast<size_t>(levelWidth) * levelHeight * 4);
+
+        // The first level reads the 8 bit base directly, every later one the floats of the level before
+        const uint8_t *base = level == 1 ? rgba : nullptr;
+        const float *source = previousLinear.data();
+        float *linearOutput = linear.data();
+        uint8_t *levelOutput = output.data();
+
+        // A level depends on all of the previous one, so the tiles of one level run in parallel and levels in sequence
+        if (levelWidth * levelHeight < MIN_PARALLEL_TEXELS) {
+            filterRows(base, source, sourceWidth, sourceHeight, srgb, 0, levelHeight, linearOutput, levelOutput);
+        } else {
+            const uint32_t tileCount = std::min(levelHeight, threadPool.getThreadCount() * 4);
+            const uint32_t rowsPerTile = (levelHeight + tileCount - 1) / tileCount;
+            vector<std::future<void>> tiles;
+            tiles.reserve(tileCount);
+            for (uint32_t firstRow = 0; firstRow < levelHeight; firstRow += rowsPerTile) {
+                const uint32_t endRow = std::min(firstRow + rowsPerTile, levelHeight);
+                tiles.push_back(threadPool.enqueue([=] {
+                    filterRows(base, source, sourceWidth, sourceHeight, srgb, firstRow, endRow, linearOutput, levelOutput);
+                }));
+            }
+            for (std::future<void> &tile : tiles) tile.wait();
+            for (std::future<void> &tile : tiles) tile.get();
+        }
+
+        std::swap(previousLinear, linear);
+        sourceWidth = levelWidth;
+        sourceHeight = levelHeight;
+    }
+    return levels;
+}
+
+DEF MipGenerator::reference(const uint8_t *rgba, const uint32_t width, const uint32_t height, const uint32_t level, const bool srgb) -> vector<uint8_t> {
+    const Tables &tables = getTables();
+    const array<float, 256> &colorDecode = srgb ? tables.srgbDecode : tables.unormDecode;
+    const uint32_t footprint = 1u << level;
+    const uint32_t levelWidth = std::max(width >> level, 1u);
+    const uint32_t levelHeight = std::max(height >> level, 1u);
+
+    vector<uint8_t> result(static_cast<size_t>(levelWidth) * levelHeight * 4);
+    for (uint32_t y = 0; y < levelHeight; y++) {
+        for (uint32_t x = 0; x < levelWidth; x++) {
+            array<double, 4> sum{};
+            uint32_t count = 0;
+            for (uint32_t sourceY = y * footprint; sourceY < std::min((y + 1) * footprint, height); sourceY++) {
+                for (uint32_t sourceX = x * footprint; sourceX < std::min((x + 1) * footprint, width); sourceX++) {
+                    const uint8_t *texel = rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4;
+                    for (int channel = 0; channel < 3; channel++) sum[channel] += colorDecode[texel[channel]];
+                    sum[3] += tables.unormDecode[texel[3]];
+                    count++;
+                }
+            }
+
+            uint8_t *texel = result.data() + (static_cast<size_t>(y) * levelWidth + x) * 4;
+            for (int channel = 0; channel < 4; channel++) {
+                const auto average = static_cast<float>(sum[channel] / count);
+                const float encoded = srgb && channel < 3 ? linearToSrgb(average) : average;
+                texel[channel] = static_cast<uint8_t>(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+            }
+        }
+    }
+    return result;
+}
+
+DEF MipGenerator::psnr(const std::span<const uint8_t> image, const std::span<const uint8_t> reference) -> double {
+    if (image.size() != reference.size() || image.empty()) throw runtime_error("PSNR needs two images of the same size!");
+
+    double squaredError = 0.0;
+    for (size_t i = 0; i < image.size(); i++) {
+        if (i % 4 == 3) continue;
+        const double difference = static_cast<double>(image[i]) - static_cast<double>(reference[i]);
+        squaredError += difference * difference;
+    }
+    const double meanSquaredError = squaredError / static_cast<double>(image.size() / 4 * 3);
+    if (meanSquaredError == 0.0) return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
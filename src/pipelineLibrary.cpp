@@ -0,0 +1,122 @@
+#include "Constants.h"
+
+#include "engine/pipelineLibrary.h"
+
+PipelineLibrary::PipelineLibrary(VkDevice device, const uint32_t threadCount)
+    : m_Device(device),
+      m_Workers(std::make_unique<ThreadPool>(threadCount)),
+      m_Fallback(VK_NULL_HANDLE),
+      m_FallbackFrameCount(0),
+      m_FrameCount(0) {}
+
+PipelineLibrary::~PipelineLibrary() {
+    clear();
+}
+
+DEF PipelineLibrary::setFallback(const uint32_t pipelineID, VkPipeline pipeline) -> void {
+    if (m_Entries.contains(pipelineID)) throw runtime_error(std::format("Pipeline {} was requested before it became the fallback!", pipelineID));
+
+    m_Fallback = pipeline;
+    Entry &entry = m_Entries[pipelineID];
+    entry.pipeline = pipeline;
+    entry.requested = std::chrono::high_resolution_clock::now();
+}
+
+DEF PipelineLibrary::request(const uint32_t pipelineID, BuildFunction build) -> void {
+    if (m_Entries.contains(pipelineID)) return;
+
+    Entry &entry = m_Entries[pipelineID];
+    entry.requested = std::chrono::high_resolution_clock::now();
+    entry.build = m_Workers->enqueue([this, pipelineID, build = std::move(build)] {
+        VkPipeline pipeline = build();
+        const auto finished = std::chrono::high_resolution_clock::now();
+
+        std::lock_guard lock(m_FinishedMutex);
+        m_Finished.push_back(FinishedBuild{pipelineID, pipeline, finished});
+    });
+}
+
+DEF PipelineLibrary::beginFrame() -> void {
+    publishFinished();
+
+    // A failed build never shows up as finished, get() surfaces its exception instead of falling back forever
+    for (auto &[pipelineID, entry] : m_Entries) {
+        if (entry.pipeline == VK_NULL_HANDLE && entry.build.valid() &&
+            entry.build.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            entry.build.get();
+        }
+    }
+}
+
+DEF PipelineLibrary::acquire(const uint32_t pipelineID) -> VkPipeline {
+    m_FrameCount += 1;
+
+    const auto found = m_Entries.find(pipelineID);
+    if (found == m_Entries.end()) throw runtime_error(std::format("Pipeline {} was never requested!", pipelineID));
+    if (found->second.pipeline != VK_NULL_HANDLE) return found->second.pipeline;
+
+    if (m_Fallback == VK_NULL_HANDLE) throw runtime_error("Pipeline library has no fallback pipeline!");
+    m_FallbackFrameCount += 1;
+    return m_Fallback;
+}
+
+DEF PipelineLibrary::isReady(const uint32_t pipelineID) const -> bool {
+    const auto found = m_Entries.find(pipelineID);
+    return found != m_Entries.end() && found->second.pipeline != VK_NULL_HANDLE;
+}
+
+DEF PipelineLibrary::waitIdle() -> void {
+    for (auto &[pipelineID, entry] : m_Entries) {
+        if (entry.build.valid()) entry.build.get();
+    }
+    publishFinished();
+}
+
+DEF PipelineLibrary::clear() -> void {
+    // Every build has to be done before the pipelines it produced can be destroyed, even if some of them failed
+    for (auto &[pipelineID, entry] : m_Entries) {
+        if (entry.build.valid()) entry.build.wait();
+    }
+    publishFinished();
+
+    // The fallback is one of the entries
+    for (const auto &[pipelineID, entry] : m_Entries) {
+        vkDestroyPipeline(m_Device, entry.pipeline, nullptr);
+    }
+    m_Entries.clear();
+    m_Fallback = VK_NULL_HANDLE;
+}
+
+DEF PipelineLibrary::printStats() const -> void {
+    fprintf(stdout, "Pipeline library: %llu of %llu frames rendered with the fallback pipeline\n",
+            static_cast<unsigned long long>(m_FallbackFrameCount),
+            static_cast<unsigned long long>(m_FrameCount));
+
+    vector<uint32_t> pipelineIDs;
+    for (const auto &[pipelineID, entry] : m_Entries) pipelineIDs.push_back(pipelineID);
+    std::ranges::sort(pipelineIDs);
+    for (const uint32_t pipelineID : pipelineIDs) {
+        const Entry &entry = m_Entries.at(pipelineID);
+        if (entry.pipeline == VK_NULL_HANDLE) {
+            fprintf(stdout, "\tPipeline %u: still compiling\n", pipelineID);
+        } else if (entry.pipeline == m_Fallback) {
+            fprintf(stdout, "\tPipeline %u: fallback, built up front\n", pipelineID);
+        } else {
+            fprintf(stdout, "\tPipeline %u: ready %.2f ms after the request\n", pipelineID, entry.latencyMs);
+        }
+    }
+}
+
+DEF PipelineLibrary::publishFinished() -> void {
+    vector<FinishedBuild> finished;
+    {
+        std::lock_guard lock(m_FinishedMutex);
+        finished.swap(m_Finished);
+    }
+
+    for (const FinishedBuild &build : finished) {
+        Entry &entry = m_Entries.at(build.pipelineID);
+        entry.pipeline = build.pipeline;
+        entry.latencyMs = std::chrono::duration<double, std::milli>(build.finished - entry.requested).count();
+    }
+}
@@ -0,0 +1,77 @@
+#include "Constants.h"
+
+#include "engine/renderQueue.h"
+
+DEF RecordingStats::operator+=(const RecordingStats &other) -> RecordingStats & {
+    pipelineBinds += other.pipelineBinds;
+    descriptorSetBinds += other.descriptorSetBinds;
+    vertexBufferBinds += other.vertexBufferBinds;
+    indexBufferBinds += other.indexBufferBinds;
+    draws += other.draws;
+    indirectDrawCalls += other.indirectDrawCalls;
+    return *this;
+}
+
+DEF RenderQueue::makeKey(const uint32_t pipelineID, const uint32_t meshID, const uint32_t materialID, const float viewDepth) -> uint64_t {
+    // Masking would silently merge IDs into one sort group, so whatever doesn't fit its field is an error
+    const uint32_t materialIndex = materialID & ~Settings::VIRTUAL_MATERIAL_BIT;
+    if (pipelineID > 0xFu) throw runtime_error("Pipeline ID doesn't fit the 4 bits of the draw key!");
+    if (meshID > 0xFFFu) throw runtime_error("Mesh ID doesn't fit the 12 bits of the draw key!");
+    if (materialIndex > 0xFFFFu) throw runtime_error("Material ID doesn't fit the 16 bits of the draw key!");
+
+    // The bit pattern of a non-negative float grows with its value, so it sorts correctly as an integer.
+    // Everything behind the camera is clamped to zero, its order doesn't matter. Masking the sign bit, which only -0.0
+    // still has, leaves bit 31 to the material.
+    const uint32_t depthBits = std::bit_cast<uint32_t>(std::max(viewDepth, 0.0f)) & 0x7FFFFFFFu;
+    const bool isVirtual = (materialID & Settings::VIRTUAL_MATERIAL_BIT) != 0;
+
+    return (static_cast<uint64_t>(pipelineID) << 60) |
+           (static_cast<uint64_t>(meshID) << 48) |
+           (static_cast<uint64_t>(isVirtual) << 47) |
+           (static_cast<uint64_t>(materialIndex) << 31) |
+           static_cast<uint64_t>(depthBits);
+}
+
+DEF RenderQueue::sort() -> void {
+    constexpr uint32_t passCount = sizeof(uint64_t);
+    constexpr uint32_t bucketCount = 256;
+
+    const size_t packetCount = m_Packets.size();
+    if (packetCount < 2) return;
+
+    // All histograms in a single read of the keys
+    array<array<uint32_t, bucketCount>, passCount> histograms{};
+    for (const DrawPacket &packet : m_Packets) {
+        for (uint32_t pass = 0; pass < passCount; pass++) {
+            histograms[pass][(packet.key >> (pass * 8)) & 0xFFu] += 1;
+        }
+    }
+
+    m_Scratch.resize(packetCount);
+    DrawPacket *source = m_Packets.data();
+    DrawPacket *destination = m_Scratch.data();
+
+    for (uint32_t pass = 0; pass < passCount; pass++) {
+        array<uint32_t, bucketCount> &histogram = histograms[pass];
+
+        // A byte shared by all keys would just copy the packets over
+        const uint32_t firstKeyBucket = (source[0].key >> (pass * 8)) & 0xFFu;
+        if (histogram[firstKeyBucket] == packetCount) continue;
+
+        // Exclusive prefix sum turns the counts into write cursors
+        uint32_t offset = 0;
+        for (uint32_t &count : histogram) {
+            const uint32_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t i = 0; i < packetCount; i++) {
+            const uint32_t bucket = (source[i].key >> (pass * 8)) & 0xFFu;
+            destination[histogram[bucket]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != m_Packets.data()) m_Packets.swap(m_Scratch);
+}
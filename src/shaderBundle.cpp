@@ -0,0 +1,80 @@
+#include "Constants.h"
+
+#include "engine/shaderBundle.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr uint32_t BUNDLE_VERSION = 1;
+} // namespace
+
+ShaderBundle::ShaderBundle(const char *bundleFilepath)
+    : m_Data(nullptr),
+      m_Size(0) {
+    const int fileDescriptor = open(bundleFilepath, O_RDONLY);
+    if (fileDescriptor < 0) throw runtime_error(std::format("failed to open shader bundle '{}'!", bundleFilepath));
+
+    struct stat fileStatus {};
+    if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size < static_cast<off_t>(sizeof(Header))) {
+        close(fileDescriptor);
+        throw runtime_error(std::format("shader bundle '{}' is too small!", bundleFilepath));
+    }
+    m_Size = static_cast<size_t>(fileStatus.st_size);
+
+    // The mapping stays valid after closing the descriptor
+    void *mapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (mapping == MAP_FAILED) throw runtime_error(std::format("failed to map shader bundle '{}'!", bundleFilepath));
+    m_Data = static_cast<const std::byte *>(mapping);
+
+    // Everything below throws on corrupt data, so unmap ourselves, the destructor won't run
+    try {
+        Header header{};
+        std::memcpy(&header, m_Data, sizeof(Header));
+        if (std::memcmp(header.magic, "SPVB", 4) != 0 || header.version != BUNDLE_VERSION) {
+            throw runtime_error("shader bundle has an unknown format, rebuild it with scripts/compile_shaders.sh!");
+        }
+        if (sizeof(Header) + static_cast<size_t>(header.entryCount) * sizeof(Entry) > m_Size) {
+            throw runtime_error("shader bundle index is truncated!");
+        }
+
+        for (uint32_t i = 0; i < header.entryCount; i++) {
+            Entry entry{};
+            std::memcpy(&entry, m_Data + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+            if (entry.offset > m_Size || entry.size > m_Size - entry.offset) throw runtime_error("shader bundle entry is out of bounds!");
+
+            const std::span<const std::byte> data(m_Data + entry.offset, entry.size);
+            // Points at the path in the mapped index, the python side zero pads it
+            const auto *path = reinterpret_cast<const char *>(m_Data + sizeof(Header) + i * sizeof(Entry) + offsetof(Entry, path));
+            const std::string_view name(path, strnlen(path, sizeof(entry.path)));
+            if (hash(data) != entry.hash) throw runtime_error(std::format("shader bundle entry '{}' is corrupt!", name));
+
+            m_Entries.emplace(name, data);
+        }
+    } catch (...) {
+        munmap(const_cast<std::byte *>(m_Data), m_Size);
+        throw;
+    }
+}
+
+ShaderBundle::~ShaderBundle() {
+    munmap(const_cast<std::byte *>(m_Data), m_Size);
+}
+
+DEF ShaderBundle::find(const std::string_view shaderFilepath) const -> std::span<const std::byte> {
+    const auto found = m_Entries.find(shaderFilepath);
+    return found == m_Entries.end() ? std::span<const std::byte>{} : found->second;
+}
+
+DEF ShaderBundle::hash(const std::span<const std::byte> data) -> uint64_t {
+    // FNV-1a, same as scripts/bundle_shaders.py
+    uint64_t value = 14695981039346656037ULL;
+    for (const std::byte byte : data) {
+        value ^= static_cast<uint64_t>(byte);
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
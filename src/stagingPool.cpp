@@ -0,0 +1,186 @@
+#include "Constants.h"
+
+#include "engine/engine.h"
+#include "engine/stagingPool.h"
+
+namespace {
+    static_assert(std::has_single_bit(Settings::STAGING_POOL_MIN_BUFFER_SIZE) && std::has_single_bit(Settings::STAGING_POOL_MAX_BUFFER_SIZE),
+                  "Staging pool size classes are powers of two");
+
+    DEF toMB(const VkDeviceSize bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+} // namespace
+
+StagingPool::StagingPool(Engine *engine)
+    : m_Engine(engine),
+      m_IdleBytes(0),
+      m_Frame(0),
+      m_Pooling(true),
+      m_Stats() {
+    m_Device = m_Engine->getDevice();
+    if (m_Device == VK_NULL_HANDLE) throw runtime_error("Initializing staging pool before engine device got initialized!");
+}
+
+StagingPool::~StagingPool() {
+    trim();
+    if (m_Stats.bytes > 0) {
+        fprintf(stderr, "Destroying the staging pool while %.2f MB of its buffers are still in use!\n", toMB(m_Stats.bytes));
+    }
+}
+
+DEF StagingPool::getSizeClass(const VkDeviceSize size) -> uint32_t {
+    if (size > Settings::STAGING_POOL_MAX_BUFFER_SIZE) return SIZE_CLASS_COUNT - 1;
+    const VkDeviceSize classSize = std::bit_ceil(std::max(size, Settings::STAGING_POOL_MIN_BUFFER_SIZE));
+    return static_cast<uint32_t>(std::countr_zero(classSize) - std::countr_zero(Settings::STAGING_POOL_MIN_BUFFER_SIZE));
+}
+
+template <typename Predicate>
+DEF StagingPool::trimLocked(const VkDeviceSize targetIdleBytes, Predicate shouldFree) -> void {
+    while (m_IdleBytes > targetIdleBytes) {
+        // Every class is ordered by release, so its first match is its oldest
+        vector<IdleBuffer> *oldestClass = nullptr;
+        vector<IdleBuffer>::iterator oldest;
+        for (vector<IdleBuffer> &idle : m_Idle) {
+            const auto found = std::ranges::find_if(idle, [&](const IdleBuffer &buffer) { return shouldFree(buffer); });
+            if (found == idle.end()) continue;
+            if (oldestClass == nullptr || found->releaseFrame < oldest->releaseFrame) {
+                oldestClass = &idle;
+                oldest = found;
+            }
+        }
+        if (oldestClass == nullptr) return;
+
+        m_IdleBytes -= oldest->staging.size;
+        destroy(oldest->staging);
+        oldestClass->erase(oldest);
+        m_Stats.trims++;
+    }
+}
+
+DEF StagingPool::acquire(const VkDeviceSize size) -> StagingBuffer {
+    const uint32_t sizeClass = getSizeClass(size);
+    VkDeviceSize bufferSize = size;
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stats.acquires++;
+        if (m_Pooling) {
+            // Buffers of the last class, or ones allocated while pooling was off, may be smaller than their class
+            vector<IdleBuffer> &idle = m_Idle[sizeClass];
+            const auto found = std::ranges::find_if(idle, [&](const IdleBuffer &buffer) { return buffer.staging.size >= size; });
+            if (found != idle.end()) {
+                const StagingBuffer staging = found->staging;
+                m_IdleBytes -= staging.size;
+                idle.erase(found);
+                return staging;
+            }
+            if (sizeClass + 1 < SIZE_CLASS_COUNT) bufferSize = Settings::STAGING_POOL_MIN_BUFFER_SIZE << sizeClass;
+        }
+    }
+
+    try {
+        return allocate(bufferSize);
+    } catch (const runtime_error &) {
+        fprintf(stderr, "Failed to allocate a %.2f MB staging buffer, trimming the staging pool and retrying.\n", toMB(bufferSize));
+        trim();
+        return allocate(bufferSize);
+    }
+}
+
+DEF StagingPool::allocate(const VkDeviceSize size) -> StagingBuffer {
+    StagingBuffer staging{.buffer = VK_NULL_HANDLE, .memory = VK_NULL_HANDLE, .mapped = nullptr, .size = size};
+    m_Engine->createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        staging.buffer,
+        staging.memory,
+        MemoryCategory::Staging);
+
+    void *mapped = nullptr;
+    if (vkMapMemory(m_Device, staging.memory, 0, size, 0, &mapped) != VK_SUCCESS) {
+        vkDestroyBuffer(m_Device, staging.buffer, nullptr);
+        m_Engine->freeMemory(staging.memory);
+        throw runtime_error("failed to map staging buffer memory!");
+    }
+    staging.mapped = static_cast<std::byte *>(mapped);
+
+    std::lock_guard lock(m_Mutex);
+    m_Stats.allocations++;
+    m_Stats.bytes += size;
+    m_Stats.peakBytes = std::max(m_Stats.peakBytes, m_Stats.bytes);
+    return staging;
+}
+
+DEF StagingPool::destroy(const StagingBuffer &staging) -> void {
+    vkUnmapMemory(m_Device, staging.memory);
+    vkDestroyBuffer(m_Device, staging.buffer, nullptr);
+    m_Engine->freeMemory(staging.memory);
+    m_Stats.bytes -= staging.size;
+}
+
+DEF StagingPool::release(const StagingBuffer &staging) -> void {
+    std::lock_guard lock(m_Mutex);
+    if (!m_Pooling) {
+        destroy(staging);
+        return;
+    }
+
+    m_Idle[getSizeClass(staging.size)].push_back(IdleBuffer{.staging = staging, .releaseFrame = m_Frame});
+    m_IdleBytes += staging.size;
+    if (m_IdleBytes > Settings::STAGING_POOL_MAX_IDLE_BYTES) {
+        trimLocked(Settings::STAGING_POOL_MAX_IDLE_BYTES, [](const IdleBuffer &) { return true; });
+    }
+}
+
+DEF StagingPool::update() -> void {
+    std::unique_lock lock(m_Mutex);
+    m_Frame++;
+    if (m_IdleBytes == 0) return;
+
+    const uint64_t frame = m_Frame;
+    trimLocked(0, [frame](const IdleBuffer &idle) { return idle.releaseFrame + Settings::STAGING_POOL_IDLE_FRAMES <= frame; });
+    // The budget comes from the driver, so it's queried as rarely as the memory tracker checks its thresholds
+    if (m_IdleBytes == 0 || frame % Settings::MEMORY_CHECK_INTERVAL_FRAMES != 0) return;
+    lock.unlock();
+
+    if (!isUnderMemoryPressure()) return;
+    lock.lock();
+    const VkDeviceSize idleBytes = m_IdleBytes;
+    trimLocked(0, [](const IdleBuffer &) { return true; });
+    fprintf(stdout, "Memory pressure, freed %.2f MB of idle staging buffers.\n", toMB(idleBytes - m_IdleBytes));
+}
+
+DEF StagingPool::trim() -> void {
+    std::lock_guard lock(m_Mutex);
+    trimLocked(0, [](const IdleBuffer &) { return true; });
+}
+
+DEF StagingPool::isUnderMemoryPressure() const -> bool {
+    const MemoryTracker *tracker = m_Engine->getMemoryTracker();
+    const MemoryTracker::HeapBudgets heaps = tracker->getHeapBudgets();
+    return std::ranges::any_of(std::span(heaps).first(tracker->getHeapCount()), [](const MemoryTracker::HeapBudget &heap) {
+        return static_cast<double>(heap.usage) > Settings::MEMORY_HEAP_WARNING_FRACTION * static_cast<double>(heap.budget);
+    });
+}
+
+DEF StagingPool::setPooling(const bool pooling) -> void {
+    std::lock_guard lock(m_Mutex);
+    m_Pooling = pooling;
+    if (!m_Pooling) trimLocked(0, [](const IdleBuffer &) { return true; });
+}
+
+DEF StagingPool::getStats() const -> Stats {
+    std::lock_guard lock(m_Mutex);
+    return m_Stats;
+}
+
+DEF StagingPool::printStats() const -> void {
+    const Stats stats = getStats();
+    fprintf(stdout, "Staging pool: %llu acquires, %llu buffers allocated (%llu allocations avoided), %llu trimmed, peak %.2f MB\n",
+            static_cast<unsigned long long>(stats.acquires),
+            static_cast<unsigned long long>(stats.allocations),
+            static_cast<unsigned long long>(stats.acquires - std::min(stats.acquires, stats.allocations)),
+            static_cast<unsigned long long>(stats.trims),
+            toMB(stats.peakBytes));
+}
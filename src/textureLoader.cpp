@@ -0,0 +1,280 @@
+#include "Constants.h"
+
+#include "engine/blockCompression.h"
+#include "engine/ktx2.h"
+#include "engine/mipGenerator.h"
+#include "engine/textureLoader.h"
+
+#include "stb_image.h"
+
+namespace {
+    // Keeps every copy offset a multiple of the texel and block size, whatever optimalBufferCopyOffsetAlignment asks for
+    constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    DEF chooseFormat(const TextureUsage usage, const bool hasAlpha, const bool compress) -> VkFormat {
+        if (usage == TextureUsage::NormalMap) return compress ? VK_FORMAT_BC5_UNORM_BLOCK : VK_FORMAT_R8G8B8A8_UNORM;
+        if (!compress) return VK_FORMAT_R8G8B8A8_SRGB;
+        if (Settings::PREFER_BC7) return VK_FORMAT_BC7_SRGB_BLOCK;
+        return hasAlpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    }
+
+    DEF isSrgb(const VkFormat format) -> bool {
+        return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+               format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+
+    // Changes whenever the source file does, so a stale cache entry gets cooked again
+    DEF makeSourceStamp(const char *textureFilepath) -> string {
+        const auto size = std::filesystem::file_size(textureFilepath);
+        const auto lastWrite = std::filesystem::last_write_time(textureFilepath).time_since_epoch().count();
+        return std::format("{}:{}", size, lastWrite);
+    }
+
+    // FNV-1a of the canonical source path, stable across runs unlike std::hash
+    DEF hashSourcePath(const std::filesystem::path &sourcePath) -> uint64_t {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const char character : std::filesystem::weakly_canonical(sourcePath).generic_string()) {
+            hash ^= static_cast<uint8_t>(character);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+} // namespace
+
+TextureLoader::TextureLoader(ThreadPool *threadPool)
+    : m_ThreadPool(threadPool),
+      m_StagingSize(0) {
+}
+
+DEF TextureLoader::getFormatName(const VkFormat format) -> const char * {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_SRGB: return "rgba8_srgb";
+        case VK_FORMAT_R8G8B8A8_UNORM: return "rgba8";
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return "bc1_srgb";
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return "bc1";
+        case VK_FORMAT_BC3_SRGB_BLOCK: return "bc3_srgb";
+        case VK_FORMAT_BC3_UNORM_BLOCK: return "bc3";
+        case VK_FORMAT_BC5_UNORM_BLOCK: return "bc5";
+        case VK_FORMAT_BC7_SRGB_BLOCK: return "bc7_srgb";
+        case VK_FORMAT_BC7_UNORM_BLOCK: return "bc7";
+        default: return "unknown";
+    }
+}
+
+DEF TextureLoader::plan(
+    const std::span<const char *const> textureFilepaths,
+    const TextureUsage usage,
+    const bool compress,
+    const bool cpuMipmaps) -> VkDeviceSize {
+
+    m_Images.clear();
+    m_Images.reserve(textureFilepaths.size());
+    m_DecodedPixels.assign(textureFilepaths.size(), {});
+    m_StagingSize = 0;
+
+    const auto reserveStaging = [this](const VkDeviceSize size) {
+        const VkDeviceSize offset = m_StagingSize;
+        m_StagingSize = (m_StagingSize + size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+        return offset;
+    };
+
+    for (const char *textureFilepath : textureFilepaths) {
+        if (!std::filesystem::exists(textureFilepath)) {
+            throw runtime_error("Texture file not found: " + std::string(textureFilepath));
+        }
+
+        int texWidth = 0;
+        int texHeight = 0;
+        int texChannels = 0;
+        if (!stbi_info(textureFilepath, &texWidth, &texHeight, &texChannels)) {
+            throw runtime_error(std::format("failed to read the header of texture '{}'!", textureFilepath));
+        }
+
+        const bool hasAlpha = texChannels == 2 || texChannels == 4;
+        Image image{
+            .filepath = textureFilepath,
+            .format = chooseFormat(usage, hasAlpha, compress),
+            .width = static_cast<uint32_t>(texWidth),
+            .height = static_cast<uint32_t>(texHeight),
+            // How often we can divide max(width, height) by 2, could also take the ceil here instead of floor + 1
+            .mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1,
+            .levels = {},
+            .compressed = compress,
+            .cached = false,
+            .cachePath = {},
+            .sourceStamp = {},
+            .decodeMs = 0.0,
+            .mipMs = 0.0,
+            .cookMs = 0.0,
+            .stagingWriteMs = 0.0};
+
+        if (!image.compressed) {
+            // Always decoded to RGBA, whatever the file stores
+            const uint32_t stagedLevels = cpuMipmaps ? image.mipLevels : 1;
+            for (uint32_t level = 0; level < stagedLevels; level++) {
+                const uint32_t levelWidth = std::max(image.width >> level, 1u);
+                const uint32_t levelHeight = std::max(image.height >> level, 1u);
+                const VkDeviceSize size = static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4;
+                image.levels.push_back({.stagingOffset = reserveStaging(size), .size = size, .width = levelWidth, .height = levelHeight, .cacheOffset = 0});
+            }
+            m_Images.push_back(std::move(image));
+            continue;
+        }
+
+        const std::filesystem::path sourcePath(textureFilepath);
+        // Files of the same name in different directories mustn't share an entry, the path hash tells them apart
+        image.cachePath = std::filesystem::path(FilePaths::TEXTURE_CACHE) /
+                          std::format("{}.{:016x}.{}.ktx2", sourcePath.stem().string(), hashSourcePath(sourcePath), getFormatName(image.format));
+        image.sourceStamp = makeSourceStamp(textureFilepath);
+        for (uint32_t level = 0; level < image.mipLevels; level++) {
+            const uint32_t levelWidth = std::max(image.width >> level, 1u);
+            const uint32_t levelHeight = std::max(image.height >> level, 1u);
+            const VkDeviceSize size = BlockCompression::getCompressedSize(image.format, levelWidth, levelHeight);
+            image.levels.push_back({.stagingOffset = reserveStaging(size), .size = size, .width = levelWidth, .height = levelHeight, .cacheOffset = 0});
+        }
+
+        // Anything that doesn't match exactly what we would cook now is treated as a miss and overwritten
+        const optional<Ktx2::Info> cacheInfo = Ktx2::readInfo(image.cachePath);
+        image.cached = cacheInfo && cacheInfo->format == image.format && cacheInfo->width == image.width &&
+                       cacheInfo->height == image.height && cacheInfo->levels.size() == image.levels.size() &&
+                       cacheInfo->sourceStamp == image.sourceStamp;
+        for (size_t level = 0; image.cached && level < image.levels.size(); level++) {
+            image.cached = cacheInfo->levels[level].byteLength == image.levels[level].size;
+            image.levels[level].cacheOffset = cacheInfo->levels[level].byteOffset;
+        }
+        m_Images.push_back(std::move(image));
+    }
+    return m_StagingSize;
+}
+
+DEF TextureLoader::decodeInto(std::byte *stagingMemory) -> void {
+    vector<std::future<void>> loads;
+    loads.reserve(m_Images.size());
+
+    // Queued first so they keep the workers busy while this thread cooks, cooking fans its blocks out to the same pool
+    for (size_t i = 0; i < m_Images.size(); i++) {
+        Image &image = m_Images[i];
+        if (image.compressed && !image.cached) continue;
+        loads.push_back(m_ThreadPool->enqueue([this, &image, &pixels = m_DecodedPixels[i], stagingMemory] {
+            if (image.cached) readCachedImage(image, stagingMemory);
+            else decodeImage(image, stagingMemory, pixels);
+        }));
+    }
+
+    std::exception_ptr firstError;
+    for (Image &image : m_Images) {
+        if (!image.compressed || image.cached) continue;
+        try {
+            cookImage(image, stagingMemory);
+        } catch (...) {
+            if (!firstError) firstError = std::current_exception();
+        }
+    }
+
+    // Every worker has to be done with the staging memory before an error can reach the caller, who then frees it
+    for (std::future<void> &load : loads) {
+        try {
+            load.get();
+        } catch (...) {
+            if (!firstError) firstError = std::current_exception();
+        }
+    }
+    if (firstError) std::rethrow_exception(firstError);
+
+    // Needs every worker again, so it only starts once the decodes are through
+    for (size_t i = 0; i < m_Images.size(); i++) {
+        if (m_DecodedPixels[i].empty()) continue;
+        generateMipmaps(m_Images[i], m_DecodedPixels[i], stagingMemory);
+        m_DecodedPixels[i] = {};
+    }
+}
+
+DEF TextureLoader::decodeImage(Image &image, std::byte *stagingMemory, vector<uint8_t> &pixels) const -> void {
+    const auto decodeStart = std::chrono::high_resolution_clock::now();
+    int texWidth = 0;
+    int texHeight = 0;
+    int texChannels = 0;
+    stbi_uc *decoded = stbi_load(image.filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!decoded) throw runtime_error(std::format("failed to load texture image '{}'!", image.filepath));
+    const auto decodeEnd = std::chrono::high_resolution_clock::now();
+
+    // The file could have changed since plan() read its header, and the staging slice is sized after that
+    if (static_cast<uint32_t>(texWidth) != image.width || static_cast<uint32_t>(texHeight) != image.height) {
+        stbi_image_free(decoded);
+        throw runtime_error(std::format("texture '{}' changed while loading!", image.filepath));
+    }
+
+    // stb_image always decodes into its own allocation, so the rows are copied over while they're still in cache
+    std::memcpy(stagingMemory + image.levels.front().stagingOffset, decoded, image.levels.front().size);
+    // Staging memory is write combined and slow to read back, the mip generation gets its own copy
+    if (image.levels.size() > 1) pixels.assign(decoded, decoded + image.levels.front().size);
+    stbi_image_free(decoded);
+    const auto writeEnd = std::chrono::high_resolution_clock::now();
+
+    image.decodeMs = std::chrono::duration<double, std::milli>(decodeEnd - decodeStart).count();
+    image.stagingWriteMs = std::chrono::duration<double, std::milli>(writeEnd - decodeEnd).count();
+}
+
+DEF TextureLoader::readCachedImage(Image &image, std::byte *stagingMemory) const -> void {
+    const auto readStart = std::chrono::high_resolution_clock::now();
+    std::ifstream file(image.cachePath, std::ios::binary);
+    for (const Level &level : image.levels) {
+        file.seekg(static_cast<std::streamoff>(level.cacheOffset));
+        file.read(reinterpret_cast<char *>(stagingMemory + level.stagingOffset), static_cast<std::streamsize>(level.size));
+    }
+    if (!file) throw runtime_error(std::format("failed to read cached texture '{}'!", image.cachePath.string()));
+
+    image.stagingWriteMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - readStart).count();
+}
+
+DEF TextureLoader::cookImage(Image &image, std::byte *stagingMemory) const -> void {
+    const auto decodeStart = std::chrono::high_resolution_clock::now();
+    int texWidth = 0;
+    int texHeight = 0;
+    int texChannels = 0;
+    stbi_uc *pixels = stbi_load(image.filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels) throw runtime_error(std::format("failed to load texture image '{}'!", image.filepath));
+    if (static_cast<uint32_t>(texWidth) != image.width || static_cast<uint32_t>(texHeight) != image.height) {
+        stbi_image_free(pixels);
+        throw runtime_error(std::format("texture '{}' changed while loading!", image.filepath));
+    }
+    const auto decodeEnd = std::chrono::high_resolution_clock::now();
+
+    const vector<vector<uint8_t>> mips = MipGenerator::generate(pixels, image.width, image.height, image.mipLevels, isSrgb(image.format), *m_ThreadPool);
+    const auto mipEnd = std::chrono::high_resolution_clock::now();
+
+    vector<vector<std::byte>> encodedLevels(image.levels.size());
+    for (size_t level = 0; level < image.levels.size(); level++) {
+        encodedLevels[level].resize(image.levels[level].size);
+        const uint8_t *source = level == 0 ? pixels : mips[level - 1].data();
+        BlockCompression::compress(image.format, source, image.levels[level].width, image.levels[level].height, encodedLevels[level].data(), *m_ThreadPool);
+    }
+    stbi_image_free(pixels);
+    const auto cookEnd = std::chrono::high_resolution_clock::now();
+
+    vector<std::span<const std::byte>> levelData;
+    for (size_t level = 0; level < image.levels.size(); level++) {
+        std::memcpy(stagingMemory + image.levels[level].stagingOffset, encodedLevels[level].data(), encodedLevels[level].size());
+        levelData.emplace_back(encodedLevels[level]);
+    }
+    const auto writeEnd = std::chrono::high_resolution_clock::now();
+
+    image.decodeMs = std::chrono::duration<double, std::milli>(decodeEnd - decodeStart).count();
+    image.mipMs = std::chrono::duration<double, std::milli>(mipEnd - decodeEnd).count();
+    image.cookMs = std::chrono::duration<double, std::milli>(cookEnd - mipEnd).count();
+    image.stagingWriteMs = std::chrono::duration<double, std::milli>(writeEnd - cookEnd).count();
+
+    // Not being able to cache only costs the next start the cooking time again
+    if (!Ktx2::write(image.cachePath, image.format, image.width, image.height, levelData, image.sourceStamp)) {
+        fprintf(stderr, "Failed to write the texture cache '%s', cooking it again next time.\n", image.cachePath.string().c_str());
+    }
+}
+
+DEF TextureLoader::generateMipmaps(Image &image, const vector<uint8_t> &pixels, std::byte *stagingMemory) const -> void {
+    const auto mipStart = std::chrono::high_resolution_clock::now();
+    const vector<vector<uint8_t>> mips = MipGenerator::generate(pixels.data(), image.width, image.height, image.mipLevels, isSrgb(image.format), *m_ThreadPool);
+    for (size_t level = 1; level < image.levels.size(); level++) {
+        std::memcpy(stagingMemory + image.levels[level].stagingOffset, mips[level - 1].data(), image.levels[level].size);
+    }
+    image.mipMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mipStart).count();
+}
@@ -0,0 +1,573 @@
+#include "Constants.h"
+
+#include "engine/blockCompression.h"
+#include "engine/engine.h"
+#include "engine/textureManager.h"
+
+namespace {
+    DEF getLevelBytes(const Texture &texture) -> vector<VkDeviceSize> {
+        vector<VkDeviceSize> levelBytes(texture.mipLevels);
+        for (uint32_t level = 0; level < texture.mipLevels; level++) {
+            const uint32_t width = std::max(texture.width >> level, 1u);
+            const uint32_t height = std::max(texture.height >> level, 1u);
+            levelBytes[level] = BlockCompression::isSupported(texture.format)
+                                    ? BlockCompression::getCompressedSize(texture.format, width, height)
+                                    : static_cast<VkDeviceSize>(width) * height * 4;
+        }
+        return levelBytes;
+    }
+
+    DEF toMB(const VkDeviceSize bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+} // namespace
+
+TextureManager::TextureManager(
+    Engine *engine,
+    const array<VkDescriptorSet, Settings::MAX_FRAMES_IN_FLIGHT> &textureTables,
+    const uint32_t capacity,
+    VkSampler sampler,
+    const VkDeviceSize budget)
+    : m_Engine(engine),
+      m_Loader(std::make_unique<ThreadPool>(1)),
+      m_TextureTables(textureTables),
+      m_TableFrames(),
+      m_Sampler(sampler),
+      m_Placeholder(),
+      m_Entries(capacity),
+      m_CommandBuffer(VK_NULL_HANDLE),
+      m_Budget(budget),
+      m_ResidentBytes(0),
+      m_Frame(0),
+      m_Stats() {
+    m_Device = m_Engine->getDevice();
+    if (m_Device == VK_NULL_HANDLE) throw runtime_error("Initializing texture manager before engine device got initialized!");
+
+    createPlaceholder();
+
+    // Every slot starts out on the placeholder, so a stale material index never reads an unwritten descriptor.
+    // Handed out lowest first.
+    for (uint32_t table = 0; table < Settings::MAX_FRAMES_IN_FLIGHT; table++) {
+        m_TableViews[table].assign(capacity, VK_NULL_HANDLE);
+        for (uint32_t slot = 0; slot < capacity; slot++) writeDescriptor(table, slot, m_Placeholder.view);
+    }
+    m_FreeSlots.reserve(capacity);
+    for (uint32_t slot = capacity; slot-- > 0;) m_FreeSlots.push_back(slot);
+}
+
+TextureManager::~TextureManager() {
+    // Loads that finished but were never uploaded still hold their staging buffers
+    for (PendingLoad &load : m_PendingLoads) {
+        load.done.wait();
+        if (load.staged->staging.buffer != VK_NULL_HANDLE) m_Engine->getStagingPool()->release(load.staged->staging);
+    }
+    m_PendingLoads.clear();
+    m_Loader.reset();
+
+    // The engine waited for the device before destroying the manager
+    destroyRetired(true);
+    for (const RetiredTexture &retired : m_RetiredTextures) m_Engine->destroyTexture(retired.texture);
+    m_RetiredTextures.clear();
+    for (const Entry &entry : m_Entries) {
+        if (entry.texture.image != VK_NULL_HANDLE) m_Engine->destroyTexture(entry.texture);
+    }
+    m_Entries.clear();
+    m_Engine->destroyTexture(m_Placeholder);
+}
+
+DEF TextureManager::acquire(const char *textureFilepath, const TextureUsage usage) -> uint32_t {
+    const auto found = m_SlotsByFilepath.find(textureFilepath);
+    if (found != m_SlotsByFilepath.end()) {
+        m_Entries[found->second].refCount++;
+        return found->second;
+    }
+
+    if (m_FreeSlots.empty()) throw runtime_error("Bindless texture table is full!");
+    const uint32_t slot = m_FreeSlots.back();
+    m_FreeSlots.pop_back();
+
+    m_Entries[slot] = Entry{
+        .filepath = textureFilepath,
+        .usage = usage,
+        .texture = {},
+        .levelBytes = {},
+        .droppedLevels = 0,
+        .refCount = 1,
+        .lastUsedFrame = m_Frame,
+        .loading = false,
+        .occupied = true};
+    m_SlotsByFilepath.emplace(textureFilepath, slot);
+    m_OccupiedSlots.insert(std::ranges::lower_bound(m_OccupiedSlots, slot), slot);
+    requestLoad(slot);
+    return slot;
+}
+
+DEF TextureManager::release(const uint32_t slot) -> void {
+    if (slot >= m_Entries.size() || !m_Entries[slot].occupied || m_Entries[slot].refCount == 0) {
+        throw runtime_error("Releasing a texture slot that isn't referenced!");
+    }
+    m_Entries[slot].refCount--;
+}
+
+DEF TextureManager::markUsed(const uint32_t slot) -> void {
+    if (slot >= m_Entries.size()) return;
+    Entry &entry = m_Entries[slot];
+    if (!entry.occupied) return;
+
+    entry.lastUsedFrame = m_Frame;
+    if (entry.droppedLevels > 0 && !entry.loading) {
+        requestLoad(slot);
+        m_Stats.reloads++;
+    }
+}
+
+DEF TextureManager::update(const uint32_t frameIdx) -> void {
+    m_TableFrames[frameIdx] = m_Engine->getFrameNumber();
+    dispatchLoads();
+    collectLoads(false);
+    enforceBudget();
+    // Ahead of the frame's own submission, whose table gets the new views right away
+    submitCommands();
+    writeTables();
+    destroyRetired(false);
+
+    m_Stats.peakResidentBytes = std::max(m_Stats.peakResidentBytes, m_ResidentBytes);
+    m_Frame++;
+}
+
+DEF TextureManager::waitForLoads() -> void {
+    dispatchLoads();
+    collectLoads(true);
+    enforceBudget();
+    submitCommands();
+
+    // Every table is safe to write once the device is idle, and everything retired is free to go
+    vkDeviceWaitIdle(m_Device);
+    writeTables();
+    destroyRetired(true);
+
+    m_Stats.peakResidentBytes = std::max(m_Stats.peakResidentBytes, m_ResidentBytes);
+}
+
+DEF TextureManager::requestLoad(const uint32_t slot) -> void {
+    m_Entries[slot].loading = true;
+    m_RequestedLoads.push_back(slot);
+}
+
+DEF TextureManager::dispatchLoads() -> void {
+    if (m_RequestedLoads.empty()) return;
+
+    // Settings are read here on the main thread, the loader thread only gets copies
+    const bool compress = m_Engine->getTextureCompression();
+    const bool cpuMipmaps = m_Engine->getCpuMipmaps();
+
+    // One batch per usage, so each decodes all of its images in parallel
+    for (const TextureUsage usage : {TextureUsage::Color, TextureUsage::NormalMap}) {
+        PendingLoad load{.slots = {}, .staged = std::make_shared<StagedTextures>(), .done = {}};
+        vector<string> filepaths;
+        for (const uint32_t slot : m_RequestedLoads) {
+            if (m_Entries[slot].usage != usage) continue;
+            load.slots.push_back(slot);
+            filepaths.push_back(m_Entries[slot].filepath);
+        }
+        if (load.slots.empty()) continue;
+
+        load.done = m_Loader->enqueue([engine = m_Engine, staged = load.staged, filepaths = std::move(filepaths), usage, compress, cpuMipmaps] {
+            vector<const char *> textureFilepaths;
+            textureFilepaths.reserve(filepaths.size());
+            for (const string &filepath : filepaths) textureFilepaths.push_back(filepath.c_str());
+            *staged = engine->stageTextures(textureFilepaths, usage, compress, cpuMipmaps);
+        });
+        m_PendingLoads.push_back(std::move(load));
+    }
+    m_RequestedLoads.clear();
+}
+
+DEF TextureManager::collectLoads(const bool wait) -> void {
+    for (auto load = m_PendingLoads.begin(); load != m_PendingLoads.end();) {
+        if (!wait && load->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++load;
+            continue;
+        }
+        // Rethrows if decoding failed
+        load->done.get();
+
+        // Frames submitted later are ordered after the upload by its barriers, the staging buffer waits for it
+        const vector<Texture> textures = m_Engine->recordTextureUploads(getCommandBuffer(), *load->staged, VK_NULL_HANDLE);
+        m_RecordedStaging.push_back(load->staged->staging);
+        load->staged->staging = StagingBuffer{.buffer = VK_NULL_HANDLE, .memory = VK_NULL_HANDLE, .mapped = nullptr, .size = 0};
+        for (size_t i = 0; i < textures.size(); i++) {
+            const uint32_t slot = load->slots[i];
+            Entry &entry = m_Entries[slot];
+            const Texture previous = entry.texture;
+            m_ResidentBytes -= getResidentBytes(entry);
+
+            entry.texture = textures[i];
+            entry.levelBytes = getLevelBytes(textures[i]);
+            entry.droppedLevels = 0;
+            entry.loading = false;
+            m_ResidentBytes += getResidentBytes(entry);
+            replace(slot, previous);
+        }
+        load = m_PendingLoads.erase(load);
+    }
+}
+
+DEF TextureManager::enforceBudget() -> void {
+    if (m_ResidentBytes <= m_Budget) return;
+
+    // Unreferenced textures go before referenced ones, each group least recently used first. Textures the current
+    // frame uses are left alone, evicting them would only bring them straight back.
+    vector<uint32_t> &candidates = m_EvictionCandidates;
+    candidates.clear();
+    for (uint32_t slot = 0; slot < m_Entries.size(); slot++) {
+        const Entry &entry = m_Entries[slot];
+        if (entry.occupied && entry.texture.image != VK_NULL_HANDLE && !entry.loading && entry.lastUsedFrame < m_Frame) {
+            candidates.push_back(slot);
+        }
+    }
+    std::ranges::sort(candidates, [this](const uint32_t a, const uint32_t b) {
+        const Entry &entryA = m_Entries[a];
+        const Entry &entryB = m_Entries[b];
+        if ((entryA.refCount > 0) != (entryB.refCount > 0)) return entryA.refCount == 0;
+        return entryA.lastUsedFrame < entryB.lastUsedFrame;
+    });
+
+    // Planned up front, so frames that can't get under the budget are counted as such
+    vector<Eviction> &evictions = m_Evictions;
+    evictions.clear();
+    VkDeviceSize projectedBytes = m_ResidentBytes;
+    for (const uint32_t slot : candidates) {
+        if (projectedBytes <= m_Budget) break;
+        const Entry &entry = m_Entries[slot];
+        if (entry.refCount == 0) {
+            projectedBytes -= getResidentBytes(entry);
+            evictions.push_back(Eviction{slot, 0});
+            continue;
+        }
+
+        const uint32_t topSize = std::max(entry.texture.width, entry.texture.height);
+        uint32_t levels = 0;
+        while (projectedBytes > m_Budget && levels + 1 < entry.texture.mipLevels &&
+               topSize >> (levels + 1) >= Settings::TEXTURE_MIN_RESIDENT_SIZE) {
+            projectedBytes -= entry.levelBytes[entry.droppedLevels + levels];
+            levels++;
+        }
+        if (levels > 0) evictions.push_back(Eviction{slot, levels});
+    }
+    if (projectedBytes > m_Budget) m_Stats.framesOverBudget++;
+
+    // The copies wait for pending frames to finish sampling the levels they move, the tables switch over as they can
+    for (const Eviction &eviction : evictions) {
+        if (eviction.levels == 0) {
+            evict(eviction.slot);
+            continue;
+        }
+        Entry &entry = m_Entries[eviction.slot];
+        const Texture previous = entry.texture;
+        const Texture texture = dropTopLevels(getCommandBuffer(), entry, eviction.levels);
+        m_ResidentBytes -= getResidentBytes(entry);
+
+        entry.texture = texture;
+        entry.droppedLevels += eviction.levels;
+        m_ResidentBytes += getResidentBytes(entry);
+        replace(eviction.slot, previous);
+        m_Stats.evictedLevels += eviction.levels;
+    }
+}
+
+DEF TextureManager::dropTopLevels(VkCommandBuffer commandBuffer, const Entry &entry, const uint32_t levels) -> Texture {
+    const Texture &source = entry.texture;
+    Texture texture{
+        .image = VK_NULL_HANDLE,
+        .memory = VK_NULL_HANDLE,
+        .view = VK_NULL_HANDLE,
+        .format = source.format,
+        .width = std::max(source.width >> levels, 1u),
+        .height = std::max(source.height >> levels, 1u),
+        .mipLevels = source.mipLevels - levels,
+        .memorySize = 0};
+    m_Engine->createImage(
+        texture.width,
+        texture.height,
+        texture.mipLevels,
+        VK_SAMPLE_COUNT_1_BIT,
+        texture.format,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        texture.image,
+        texture.memory,
+        MemoryCategory::Textures);
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_Device, texture.image, &memRequirements);
+    texture.memorySize = memRequirements.size;
+
+    const array toTransfer = {
+        VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = source.image,
+            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = levels, .levelCount = texture.mipLevels, .baseArrayLayer = 0, .layerCount = 1}},
+        VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = texture.image,
+            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = texture.mipLevels, .baseArrayLayer = 0, .layerCount = 1}}};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+
+    // Full level extents are valid copy regions for block compressed formats too, even below the block size
+    vector<VkImageCopy> regions(texture.mipLevels);
+    for (uint32_t level = 0; level < texture.mipLevels; level++) {
+        regions[level] = VkImageCopy{
+            .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level + levels, .baseArrayLayer = 0, .layerCount = 1},
+            .srcOffset = {.x = 0, .y = 0, .z = 0},
+            .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .baseArrayLayer = 0, .layerCount = 1},
+            .dstOffset = {.x = 0, .y = 0, .z = 0},
+            .extent = {.width = std::max(texture.width >> level, 1u), .height = std::max(texture.height >> level, 1u), .depth = 1}};
+    }
+    vkCmdCopyImage(
+        commandBuffer,
+        source.image,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        texture.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data());
+
+    const VkImageMemoryBarrier toShaderRead{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture.image,
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = texture.mipLevels, .baseArrayLayer = 0, .layerCount = 1}};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &toShaderRead);
+
+    texture.view = m_Engine->createImageView(texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
+    return texture;
+}
+
+DEF TextureManager::evict(const uint32_t slot) -> void {
+    Entry &entry = m_Entries[slot];
+    m_ResidentBytes -= getResidentBytes(entry);
+    const Texture previous = entry.texture;
+
+    // Nothing references the slot anymore, so it can be handed out again while tables still show the old texture
+    m_SlotsByFilepath.erase(entry.filepath);
+    m_OccupiedSlots.erase(std::ranges::lower_bound(m_OccupiedSlots, slot));
+    entry = Entry{};
+    m_FreeSlots.push_back(slot);
+    replace(slot, previous);
+    m_Stats.evictedTextures++;
+}
+
+DEF TextureManager::replace(const uint32_t slot, const Texture &retired) -> void {
+    for (vector<uint32_t> &dirtySlots : m_DirtySlots) dirtySlots.push_back(slot);
+    if (retired.image != VK_NULL_HANDLE) {
+        m_RetiredTextures.push_back(RetiredTexture{.texture = retired, .slot = slot, .frame = m_Engine->getFrameNumber()});
+    }
+}
+
+DEF TextureManager::getCommandBuffer() -> VkCommandBuffer {
+    if (m_CommandBuffer == VK_NULL_HANDLE) m_CommandBuffer = m_Engine->beginSingleTimeCommands();
+    return m_CommandBuffer;
+}
+
+DEF TextureManager::submitCommands() -> void {
+    if (m_CommandBuffer == VK_NULL_HANDLE) return;
+    m_Engine->submitSingleTimeCommands(m_CommandBuffer);
+    m_Submissions.push_back(Submission{
+        .commandBuffer = m_CommandBuffer,
+        .staging = std::move(m_RecordedStaging),
+        .frame = m_Engine->getFrameNumber()});
+    m_CommandBuffer = VK_NULL_HANDLE;
+    m_RecordedStaging.clear();
+}
+
+DEF TextureManager::writeTables() -> void {
+    const uint64_t frame = m_Engine->getFrameNumber();
+    for (uint32_t table = 0; table < Settings::MAX_FRAMES_IN_FLIGHT; table++) {
+        vector<uint32_t> &dirtySlots = m_DirtySlots[table];
+        if (dirtySlots.empty()) continue;
+        // The frame being built hasn't been submitted yet, its table is as safe to write as the completed ones
+        if (m_TableFrames[table] != frame && !m_Engine->isFrameComplete(m_TableFrames[table])) continue;
+
+        for (const uint32_t slot : dirtySlots) {
+            const VkImageView view = getView(m_Entries[slot]);
+            if (m_TableViews[table][slot] != view) writeDescriptor(table, slot, view);
+        }
+        dirtySlots.clear();
+    }
+}
+
+DEF TextureManager::destroyRetired(const bool idle) -> void {
+    for (auto submission = m_Submissions.begin(); submission != m_Submissions.end();) {
+        if (!idle && !m_Engine->isFrameComplete(submission->frame)) {
+            ++submission;
+            continue;
+        }
+        m_Engine->freeSingleTimeCommands(submission->commandBuffer);
+        for (const StagingBuffer &staging : submission->staging) m_Engine->getStagingPool()->release(staging);
+        submission = m_Submissions.erase(submission);
+    }
+
+    for (auto retired = m_RetiredTextures.begin(); retired != m_RetiredTextures.end();) {
+        const bool inTable = std::ranges::any_of(m_TableViews, [&retired](const vector<VkImageView> &views) {
+            return views[retired->slot] == retired->texture.view;
+        });
+        if (inTable || (!idle && !m_Engine->isFrameComplete(retired->frame))) {
+            ++retired;
+            continue;
+        }
+        m_Engine->destroyTexture(retired->texture);
+        retired = m_RetiredTextures.erase(retired);
+    }
+}
+
+DEF TextureManager::writeDescriptor(const uint32_t table, const uint32_t slot, VkImageView view) -> void {
+    const VkDescriptorImageInfo imageInfo{
+        .sampler = m_Sampler,
+        .imageView = view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    const VkWriteDescriptorSet descriptorWrite{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_TextureTables[table],
+        .dstBinding = 0,
+        .dstArrayElement = slot,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &imageInfo};
+    vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+    m_TableViews[table][slot] = view;
+}
+
+DEF TextureManager::createPlaceholder() -> void {
+    m_Placeholder = Texture{
+        .image = VK_NULL_HANDLE,
+        .memory = VK_NULL_HANDLE,
+        .view = VK_NULL_HANDLE,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .width = 1,
+        .height = 1,
+        .mipLevels = 1,
+        .memorySize = 0};
+    m_Engine->createImage(
+        1,
+        1,
+        1,
+        VK_SAMPLE_COUNT_1_BIT,
+        m_Placeholder.format,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_Placeholder.image,
+        m_Placeholder.memory,
+        MemoryCategory::Textures);
+
+    VkImageMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_Placeholder.image,
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1}};
+
+    VkCommandBuffer commandBuffer = m_Engine->beginSingleTimeCommands();
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    // Neutral grey, so textures that are still loading don't stand out
+    constexpr VkClearColorValue grey = {.float32 = {0.5f, 0.5f, 0.5f, 1.0f}};
+    vkCmdClearColorImage(commandBuffer, m_Placeholder.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &grey, 1, &barrier.subresourceRange);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+    m_Engine->endSingleTimeCommands(commandBuffer);
+
+    m_Placeholder.view = m_Engine->createImageView(m_Placeholder.image, m_Placeholder.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+}
+
+DEF TextureManager::getView(const Entry &entry) const -> VkImageView {
+    return entry.texture.image != VK_NULL_HANDLE ? entry.texture.view : m_Placeholder.view;
+}
+
+DEF TextureManager::getResidentBytes(const Entry &entry) const -> VkDeviceSize {
+    if (entry.texture.image == VK_NULL_HANDLE) return 0;
+    VkDeviceSize bytes = 0;
+    for (size_t level = entry.droppedLevels; level < entry.levelBytes.size(); level++) bytes += entry.levelBytes[level];
+    return bytes;
+}
+
+DEF TextureManager::getResidentLevelBytes(const uint32_t slot) const -> vector<VkDeviceSize> {
+    if (slot >= m_Entries.size() || m_Entries[slot].texture.image == VK_NULL_HANDLE) return {};
+    const Entry &entry = m_Entries[slot];
+    return {entry.levelBytes.begin() + entry.droppedLevels, entry.levelBytes.end()};
+}
+
+DEF TextureManager::getStats() const -> Stats {
+    Stats stats = m_Stats;
+    stats.residentBytes = m_ResidentBytes;
+    for (const Entry &entry : m_Entries) {
+        if (!entry.occupied) continue;
+        stats.textureCount++;
+        if (entry.droppedLevels > 0) stats.partialCount++;
+        if (entry.loading) stats.loadingCount++;
+        if (entry.texture.image != VK_NULL_HANDLE) stats.allocatedBytes += entry.texture.memorySize;
+    }
+    return stats;
+}
+
+DEF TextureManager::printStats() const -> void {
+    const Stats stats = getStats();
+    fprintf(stdout, "Texture manager: %u textures (%u without top mips, %u loading), %.2f of %.2f MB budget resident, %.2f MB allocated, peak %.2f MB\n",
+            stats.textureCount, stats.partialCount, stats.loadingCount,
+            toMB(stats.residentBytes), toMB(m_Budget), toMB(stats.allocatedBytes), toMB(stats.peakResidentBytes));
+    fprintf(stdout, "\tEvicted %llu textures and %llu top mip levels, %llu reloads, %llu frames over budget\n",
+            static_cast<unsigned long long>(stats.evictedTextures),
+            static_cast<unsigned long long>(stats.evictedLevels),
+            static_cast<unsigned long long>(stats.reloads),
+            static_cast<unsigned long long>(stats.framesOverBudget));
+}
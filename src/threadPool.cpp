@@ -0,0 +1,53 @@
+#include "Constants.h"
+
+#include "engine/threadPool.h"
+
+ThreadPool::ThreadPool(const uint32_t threadCount)
+    : m_Stopping(false) {
+    if (threadCount == 0) throw runtime_error("ThreadPool needs at least one thread!");
+
+    m_Workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        m_Workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+
+    // Workers drain the queue before they exit, so no future is left without a value
+    for (std::thread &worker : m_Workers) {
+        worker.join();
+    }
+}
+
+DEF ThreadPool::enqueue(std::function<void()> task) -> std::future<void> {
+    std::packaged_task<void()> packagedTask(std::move(task));
+    std::future<void> future = packagedTask.get_future();
+    {
+        std::lock_guard lock(m_Mutex);
+        if (m_Stopping) throw runtime_error("Enqueuing a task on a stopped ThreadPool!");
+        m_Tasks.push(std::move(packagedTask));
+    }
+    m_Condition.notify_one();
+    return future;
+}
+
+DEF ThreadPool::workerLoop() -> void {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock lock(m_Mutex);
+            m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Tasks.empty()) return;
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop();
+        }
+        task();
+    }
+}
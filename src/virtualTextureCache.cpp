@@ -0,0 +1,820 @@
+#include "Constants.h"
+
+#include "engine/engine.h"
+#include "engine/mipGenerator.h"
+#include "engine/virtualTextureCache.h"
+
+#include "stb_image.h"
+
+namespace {
+    constexpr uint32_t PAGE_SIZE = Settings::VIRTUAL_TEXTURE_PAGE_SIZE;
+    constexpr uint32_t PAGE_BORDER = Settings::VIRTUAL_TEXTURE_PAGE_BORDER;
+    // A page with its border on every side, which is what a cache slot holds
+    constexpr uint32_t SLOT_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+    constexpr VkDeviceSize SLOT_BYTES = static_cast<VkDeviceSize>(SLOT_SIZE) * SLOT_SIZE * 4;
+    constexpr uint32_t CACHE_SIZE = Settings::VIRTUAL_TEXTURE_CACHE_PAGES * SLOT_SIZE;
+    constexpr uint32_t SLOT_COUNT = Settings::VIRTUAL_TEXTURE_CACHE_PAGES * Settings::VIRTUAL_TEXTURE_CACHE_PAGES;
+    constexpr uint32_t NOT_RESIDENT = std::numeric_limits<uint32_t>::max();
+    constexpr uint32_t NO_REGION = std::numeric_limits<uint32_t>::max();
+
+    // Every frame in flight can hold the region it uploaded from, and the streaming thread fills one more
+    constexpr uint32_t REGION_COUNT = Settings::MAX_FRAMES_IN_FLIGHT + 1;
+    constexpr VkDeviceSize REGION_SIZE = Settings::VIRTUAL_TEXTURE_UPLOADS_PER_FRAME * SLOT_BYTES;
+    constexpr VkDeviceSize TABLE_REGION_SIZE = Settings::VIRTUAL_TEXTURE_MAX_PAGES * sizeof(uint32_t);
+    // The last level pages of every texture registered between two frames share a single region
+    static_assert(Settings::MAX_VIRTUAL_TEXTURES <= Settings::VIRTUAL_TEXTURE_UPLOADS_PER_FRAME);
+
+    // Has to match VirtualTexture in shaders/shader_phong_stages.frag (std430)
+    struct VirtualTextureInfo {
+        uint32_t width;
+        uint32_t height;
+        uint32_t tableWidth;
+        uint32_t tableHeight;
+        uint32_t mipLevels;
+        uint32_t firstPage;
+        uint32_t padding[2];
+    };
+
+    // Red and green select the slot, blue is the level the slot's page belongs to
+    DEF packEntry(const uint32_t slot, const uint32_t level) -> uint32_t {
+        const uint32_t slotX = slot % Settings::VIRTUAL_TEXTURE_CACHE_PAGES;
+        const uint32_t slotY = slot / Settings::VIRTUAL_TEXTURE_CACHE_PAGES;
+        return slotX | slotY << 8 | level << 16 | 0xFFu << 24;
+    }
+
+    DEF toMB(const uint64_t bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+} // namespace
+
+VirtualTextureCache::VirtualTextureCache(Engine *engine, VkDescriptorSetLayout descriptorSetLayout, const uint32_t queueFamilyIndex)
+    : m_Engine(engine),
+      m_Streamer(std::make_unique<ThreadPool>(1)),
+      m_DescriptorSetLayout(descriptorSetLayout),
+      m_DescriptorPool(VK_NULL_HANDLE),
+      m_DescriptorSets(),
+      m_CacheSampler(VK_NULL_HANDLE),
+      m_TableSampler(VK_NULL_HANDLE),
+      m_PageCache(VK_NULL_HANDLE),
+      m_PageCacheMemory(VK_NULL_HANDLE),
+      m_PageCacheView(VK_NULL_HANDLE),
+      m_Slots(SLOT_COUNT, CacheSlot{.page = 0, .lastRequestedFrame = 0, .occupied = false, .pinned = false}),
+      m_PageSlots(Settings::VIRTUAL_TEXTURE_MAX_PAGES, NOT_RESIDENT),
+      m_ResidentPageCount(0),
+      m_FeedbackBuffer(VK_NULL_HANDLE),
+      m_FeedbackMemory(VK_NULL_HANDLE),
+      m_Feedback(nullptr),
+      m_FeedbackRegionSize(0),
+      m_InfoBuffer(VK_NULL_HANDLE),
+      m_InfoMemory(VK_NULL_HANDLE),
+      m_Info(nullptr),
+      m_StagingBuffer(VK_NULL_HANDLE),
+      m_StagingMemory(VK_NULL_HANDLE),
+      m_Staging(nullptr),
+      m_PinRegion(NO_REGION),
+      m_CommandPool(VK_NULL_HANDLE),
+      m_CommandBuffers(),
+      m_PageCount(0),
+      m_PageStreaming(Settings::VIRTUAL_TEXTURE_MAX_PAGES, 0),
+      m_FrameIdx(0),
+      m_Frame(0),
+      m_Stats(),
+      m_FrameStats() {
+    m_Device = m_Engine->getDevice();
+    if (m_Device == VK_NULL_HANDLE) throw runtime_error("Initializing virtual texture cache before engine device got initialized!");
+
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = queueFamilyIndex};
+    if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
+        throw runtime_error("failed to create virtual texture command pool!");
+    }
+    const VkCommandBufferAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = m_CommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = static_cast<uint32_t>(m_CommandBuffers.size())};
+    if (vkAllocateCommandBuffers(m_Device, &allocInfo, m_CommandBuffers.data()) != VK_SUCCESS) {
+        throw runtime_error("failed to allocate virtual texture command buffers!");
+    }
+
+    for (uint32_t region = REGION_COUNT; region-- > 0;) m_FreeRegions.push_back(region);
+
+    createPageCache();
+    createBuffers();
+    createDescriptorSets();
+    fprintf(stdout, "\tVirtual texture page cache of %ux%u texels, %u slots of %u texel pages.\n", CACHE_SIZE, CACHE_SIZE, SLOT_COUNT, PAGE_SIZE);
+}
+
+VirtualTextureCache::~VirtualTextureCache() {
+    if (m_Streaming) m_Streaming->done.wait();
+    m_Streamer.reset();
+
+    for (const auto &texture : m_Textures) {
+        vkDestroyImageView(m_Device, texture->pageTableView, nullptr);
+        vkDestroyImage(m_Device, texture->pageTable, nullptr);
+        m_Engine->freeMemory(texture->pageTableMemory);
+    }
+    m_Textures.clear();
+
+    vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+    vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
+
+    vkUnmapMemory(m_Device, m_StagingMemory);
+    vkDestroyBuffer(m_Device, m_StagingBuffer, nullptr);
+    m_Engine->freeMemory(m_StagingMemory);
+    vkUnmapMemory(m_Device, m_InfoMemory);
+    vkDestroyBuffer(m_Device, m_InfoBuffer, nullptr);
+    m_Engine->freeMemory(m_InfoMemory);
+    vkUnmapMemory(m_Device, m_FeedbackMemory);
+    vkDestroyBuffer(m_Device, m_FeedbackBuffer, nullptr);
+    m_Engine->freeMemory(m_FeedbackMemory);
+
+    vkDestroyImageView(m_Device, m_PageCacheView, nullptr);
+    vkDestroyImage(m_Device, m_PageCache, nullptr);
+    m_Engine->freeMemory(m_PageCacheMemory);
+}
+
+DEF VirtualTextureCache::createPageCache() -> void {
+    m_Engine->createImage(
+        CACHE_SIZE,
+        CACHE_SIZE,
+        1,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R8G8B8A8_SRGB,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_PageCache,
+        m_PageCacheMemory,
+        MemoryCategory::Textures);
+    m_PageCacheView = m_Engine->createImageView(m_PageCache, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+    // Every slot gets written before a page table points at it, the clear only gives the image a defined layout
+    VkImageMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_PageCache,
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1}};
+    VkCommandBuffer commandBuffer = m_Engine->beginSingleTimeCommands();
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+    constexpr VkClearColorValue black = {.float32 = {0.0f, 0.0f, 0.0f, 1.0f}};
+    vkCmdClearColorImage(commandBuffer, m_PageCache, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &barrier.subresourceRange);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+    m_Engine->endSingleTimeCommands(commandBuffer);
+
+    // Slots carry their own border, so filtering never has to reach into a neighbouring slot
+    const VkSamplerCreateInfo cacheSamplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod = 0.0f};
+    m_CacheSampler = m_Engine->getObjectCache()->getSampler(cacheSamplerInfo);
+
+    // Page tables are only read with texelFetch
+    VkSamplerCreateInfo tableSamplerInfo = cacheSamplerInfo;
+    tableSamplerInfo.magFilter = VK_FILTER_NEAREST;
+    tableSamplerInfo.minFilter = VK_FILTER_NEAREST;
+    tableSamplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    m_TableSampler = m_Engine->getObjectCache()->getSampler(tableSamplerInfo);
+}
+
+DEF VirtualTextureCache::createBuffers() -> void {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_Engine->getPhysicalDevice(), &properties);
+    const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+
+    // The frame number header, then a counter per page
+    m_FeedbackRegionSize = ((1 + Settings::VIRTUAL_TEXTURE_MAX_PAGES) * sizeof(uint32_t) + alignment - 1) & ~(alignment - 1);
+    const VkDeviceSize feedbackSize = m_FeedbackRegionSize * Settings::MAX_FRAMES_IN_FLIGHT;
+    m_Engine->createBuffer(
+        feedbackSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_FeedbackBuffer,
+        m_FeedbackMemory,
+        MemoryCategory::Other);
+    void *feedback = nullptr;
+    if (vkMapMemory(m_Device, m_FeedbackMemory, 0, feedbackSize, 0, &feedback) != VK_SUCCESS) {
+        throw runtime_error("failed to map virtual texture feedback memory!");
+    }
+    m_Feedback = static_cast<uint32_t *>(feedback);
+    memset(m_Feedback, 0, feedbackSize);
+
+    constexpr VkDeviceSize infoSize = Settings::MAX_VIRTUAL_TEXTURES * sizeof(VirtualTextureInfo);
+    m_Engine->createBuffer(
+        infoSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_InfoBuffer,
+        m_InfoMemory,
+        MemoryCategory::Other);
+    if (vkMapMemory(m_Device, m_InfoMemory, 0, infoSize, 0, &m_Info) != VK_SUCCESS) {
+        throw runtime_error("failed to map virtual texture info memory!");
+    }
+    memset(m_Info, 0, infoSize);
+
+    constexpr VkDeviceSize stagingSize = REGION_COUNT * REGION_SIZE + Settings::MAX_FRAMES_IN_FLIGHT * TABLE_REGION_SIZE;
+    m_Engine->createBuffer(
+        stagingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_StagingBuffer,
+        m_StagingMemory,
+        MemoryCategory::Staging);
+    void *staging = nullptr;
+    if (vkMapMemory(m_Device, m_StagingMemory, 0, stagingSize, 0, &staging) != VK_SUCCESS) {
+        throw runtime_error("failed to map virtual texture staging memory!");
+    }
+    m_Staging = static_cast<std::byte *>(staging);
+}
+
+DEF VirtualTextureCache::createDescriptorSets() -> void {
+    const array poolSizes = {
+        VkDescriptorPoolSize{
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = (1 + Settings::MAX_VIRTUAL_TEXTURES) * Settings::MAX_FRAMES_IN_FLIGHT},
+        VkDescriptorPoolSize{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 2 * Settings::MAX_FRAMES_IN_FLIGHT}};
+    const VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = Settings::MAX_FRAMES_IN_FLIGHT,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()};
+    if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
+        throw runtime_error("failed to create virtual texture descriptor pool!");
+    }
+
+    array<VkDescriptorSetLayout, Settings::MAX_FRAMES_IN_FLIGHT> layouts{};
+    layouts.fill(m_DescriptorSetLayout);
+    const VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = m_DescriptorPool,
+        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+        .pSetLayouts = layouts.data()};
+    if (vkAllocateDescriptorSets(m_Device, &allocInfo, m_DescriptorSets.data()) != VK_SUCCESS) {
+        throw runtime_error("failed to allocate virtual texture descriptor sets!");
+    }
+
+    // Page tables are written as textures get registered, binding 1 is partially bound until then
+    const VkDescriptorImageInfo cacheInfo{
+        .sampler = m_CacheSampler,
+        .imageView = m_PageCacheView,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    const VkDescriptorBufferInfo infoBufferInfo{
+        .buffer = m_InfoBuffer,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE};
+    for (size_t frame = 0; frame < Settings::MAX_FRAMES_IN_FLIGHT; frame++) {
+        const VkDescriptorBufferInfo feedbackInfo{
+            .buffer = m_FeedbackBuffer,
+            .offset = frame * m_FeedbackRegionSize,
+            .range = m_FeedbackRegionSize};
+        const array descriptorWrites = {
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = m_DescriptorSets[frame],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &cacheInfo},
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = m_DescriptorSets[frame],
+                .dstBinding = 2,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &feedbackInfo},
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = m_DescriptorSets[frame],
+                .dstBinding = 3,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &infoBufferInfo}};
+        vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+DEF VirtualTextureCache::createPageTable(VirtualTexture &texture) -> void {
+    m_Engine->createImage(
+        texture.tableWidth,
+        texture.tableHeight,
+        texture.mipLevels,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        texture.pageTable,
+        texture.pageTableMemory,
+        MemoryCategory::Textures);
+    texture.pageTableView = m_Engine->createImageView(texture.pageTable, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
+}
+
+DEF VirtualTextureCache::registerTexture(const char *textureFilepath) -> uint32_t {
+    if (m_Textures.size() >= Settings::MAX_VIRTUAL_TEXTURES) throw runtime_error("Too many virtual textures!");
+
+    int texWidth = 0;
+    int texHeight = 0;
+    int texChannels = 0;
+    stbi_uc *pixels = stbi_load(textureFilepath, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels) throw runtime_error("failed to load virtual texture image!");
+
+    auto texture = std::make_unique<VirtualTexture>();
+    texture->filepath = textureFilepath;
+    texture->width = static_cast<uint32_t>(texWidth);
+    texture->height = static_cast<uint32_t>(texHeight);
+    texture->tableWidth = std::bit_ceil((texture->width + PAGE_SIZE - 1) / PAGE_SIZE);
+    texture->tableHeight = std::bit_ceil((texture->height + PAGE_SIZE - 1) / PAGE_SIZE);
+    // Down to the level whose table is a single page, which always covers the whole level
+    texture->mipLevels = static_cast<uint32_t>(std::bit_width(std::max(texture->tableWidth, texture->tableHeight)));
+    texture->firstPage = m_PageCount;
+
+    uint32_t entryCount = 0;
+    for (uint32_t level = 0; level < texture->mipLevels; level++) {
+        texture->levelOffsets.push_back(entryCount);
+        entryCount += std::max(texture->tableWidth >> level, 1u) * std::max(texture->tableHeight >> level, 1u);
+    }
+    texture->levelOffsets.push_back(entryCount);
+    if (m_PageCount + entryCount > Settings::VIRTUAL_TEXTURE_MAX_PAGES) {
+        stbi_image_free(pixels);
+        throw runtime_error("Virtual texture page tables exceed Settings::VIRTUAL_TEXTURE_MAX_PAGES!");
+    }
+
+    texture->levels.emplace_back(pixels, pixels + static_cast<size_t>(texture->width) * texture->height * 4);
+    for (vector<uint8_t> &level : MipGenerator::generate(pixels, texture->width, texture->height, texture->mipLevels, true, *m_Engine->getTexturePool())) {
+        texture->levels.push_back(std::move(level));
+    }
+    stbi_image_free(pixels);
+
+    texture->tableEntries.assign(entryCount, 0);
+    texture->tableDirty = true;
+    texture->tableUploaded = false;
+    createPageTable(*texture);
+    m_PageCount += entryCount;
+
+    const auto textureIdx = static_cast<uint32_t>(m_Textures.size());
+    m_Textures.push_back(std::move(texture));
+    const VirtualTexture &added = *m_Textures.back();
+
+    // The last level's page gets pinned, after this every lookup into the texture finds a resident page. It's uploaded
+    // with the next frame's streamed pages, ordered after every frame that may still sample the slot it takes.
+    const uint32_t slot = findSlot();
+    if (slot == NOT_RESIDENT) throw runtime_error("Virtual texture page cache has no slot left to pin a texture's last level!");
+    if (m_PinRegion == NO_REGION) m_PinRegion = acquireRegion();
+    const VkDeviceSize pinOffset = m_PinRegion * REGION_SIZE + m_PinCopies.size() * SLOT_BYTES;
+    writePage(added, added.mipLevels - 1, 0, 0, m_Staging + pinOffset);
+    makeResident(added.firstPage + added.levelOffsets[added.mipLevels - 1], slot, true);
+    m_PinCopies.push_back(VkBufferImageCopy{
+        .bufferOffset = pinOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+        .imageOffset = {
+            .x = static_cast<int32_t>(slot % Settings::VIRTUAL_TEXTURE_CACHE_PAGES * SLOT_SIZE),
+            .y = static_cast<int32_t>(slot / Settings::VIRTUAL_TEXTURE_CACHE_PAGES * SLOT_SIZE),
+            .z = 0},
+        .imageExtent = {.width = SLOT_SIZE, .height = SLOT_SIZE, .depth = 1}});
+
+    static_cast<VirtualTextureInfo *>(m_Info)[textureIdx] = VirtualTextureInfo{
+        .width = added.width,
+        .height = added.height,
+        .tableWidth = added.tableWidth,
+        .tableHeight = added.tableHeight,
+        .mipLevels = added.mipLevels,
+        .firstPage = added.firstPage,
+        .padding = {0, 0}};
+
+    // Update after bind, recorded command buffers that bound the sets stay valid
+    const VkDescriptorImageInfo tableInfo{
+        .sampler = m_TableSampler,
+        .imageView = added.pageTableView,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    for (VkDescriptorSet descriptorSet : m_DescriptorSets) {
+        const VkWriteDescriptorSet descriptorWrite{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptorSet,
+            .dstBinding = 1,
+            .dstArrayElement = textureIdx,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &tableInfo};
+        vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+    }
+
+    uint64_t hostBytes = 0;
+    for (const vector<uint8_t> &level : added.levels) hostBytes += level.size();
+    fprintf(stdout, "\tRegistered virtual texture '%s' as %u: %ux%u, %u levels, %u page table entries, %.2f MB in host memory\n",
+            textureFilepath, textureIdx, added.width, added.height, added.mipLevels, entryCount, toMB(hostBytes));
+    return Settings::VIRTUAL_MATERIAL_BIT | textureIdx;
+}
+
+DEF VirtualTextureCache::beginFrame(const uint32_t frameIdx) -> void {
+    m_FrameIdx = frameIdx;
+    m_Frame++;
+    m_FrameStats = {};
+
+    reclaimRegions();
+
+    uint32_t *feedback = m_Feedback + frameIdx * (m_FeedbackRegionSize / sizeof(uint32_t));
+    uint32_t *counts = feedback + 1;
+    m_Requests.clear();
+    for (uint32_t page = 0; page < m_PageCount; page++) {
+        const uint32_t count = counts[page];
+        if (count == 0) continue;
+        counts[page] = 0;
+        m_FrameStats.requestedPages++;
+
+        if (m_PageSlots[page] != NOT_RESIDENT) {
+            m_FrameStats.hits++;
+            m_Slots[m_PageSlots[page]].lastRequestedFrame = m_Frame;
+            continue;
+        }
+        m_FrameStats.misses++;
+
+        // Whatever the page falls back to is in use as well, it mustn't be evicted before the page is resident
+        PageAddress address = decodePage(page);
+        const VirtualTexture &texture = *m_Textures[address.texture];
+        const uint32_t level = address.level;
+        while (address.level + 1 < texture.mipLevels) {
+            address.level++;
+            address.x /= 2;
+            address.y /= 2;
+            const uint32_t ancestor = texture.firstPage + texture.levelOffsets[address.level] +
+                                      address.y * std::max(texture.tableWidth >> address.level, 1u) + address.x;
+            if (m_PageSlots[ancestor] != NOT_RESIDENT) {
+                m_Slots[m_PageSlots[ancestor]].lastRequestedFrame = m_Frame;
+                break;
+            }
+        }
+        if (!m_PageStreaming[page]) m_Requests.push_back(Request{.page = page, .level = level, .count = count});
+    }
+    feedback[0] = static_cast<uint32_t>(m_Frame);
+
+    // Coarse levels first, they're what the finer ones fall back to
+    std::ranges::sort(m_Requests, [](const Request &a, const Request &b) {
+        if (a.level != b.level) return a.level > b.level;
+        return a.count > b.count;
+    });
+
+    m_Stats.requestedPages += m_FrameStats.requestedPages;
+    m_Stats.hits += m_FrameStats.hits;
+    m_Stats.misses += m_FrameStats.misses;
+}
+
+DEF VirtualTextureCache::recordUploads() -> VkCommandBuffer {
+    vector<VkBufferImageCopy> pageCopies;
+    if (m_Streaming && m_Streaming->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        m_Streaming->done.get();
+        const VkDeviceSize regionOffset = m_Streaming->region * REGION_SIZE;
+        for (size_t i = 0; i < m_Streaming->pages.size(); i++) {
+            const uint32_t page = m_Streaming->pages[i];
+            m_PageStreaming[page] = 0;
+            const uint32_t slot = findSlot();
+            if (slot == NOT_RESIDENT) {
+                m_FrameStats.droppedPages++;
+                continue;
+            }
+            makeResident(page, slot, false);
+            pageCopies.push_back(VkBufferImageCopy{
+                .bufferOffset = regionOffset + i * SLOT_BYTES,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+                .imageOffset = {
+                    .x = static_cast<int32_t>(slot % Settings::VIRTUAL_TEXTURE_CACHE_PAGES * SLOT_SIZE),
+                    .y = static_cast<int32_t>(slot / Settings::VIRTUAL_TEXTURE_CACHE_PAGES * SLOT_SIZE),
+                    .z = 0},
+                .imageExtent = {.width = SLOT_SIZE, .height = SLOT_SIZE, .depth = 1}});
+        }
+        m_RetiredRegions.push_back(RetiredRegion{.region = m_Streaming->region, .frame = m_Engine->getFrameNumber()});
+        m_Streaming.reset();
+    }
+    if (m_PinRegion != NO_REGION) {
+        pageCopies.insert(pageCopies.end(), m_PinCopies.begin(), m_PinCopies.end());
+        m_RetiredRegions.push_back(RetiredRegion{.region = m_PinRegion, .frame = m_Engine->getFrameNumber()});
+        m_PinRegion = NO_REGION;
+        m_PinCopies.clear();
+    }
+    dispatchStreaming();
+    m_Stats.droppedPages += m_FrameStats.droppedPages;
+
+    const bool tablesDirty = std::ranges::any_of(m_Textures, [](const auto &texture) { return texture->tableDirty; });
+    if (pageCopies.empty() && !tablesDirty) return VK_NULL_HANDLE;
+
+    VkCommandBuffer commandBuffer = m_CommandBuffers[m_FrameIdx];
+    vkResetCommandBuffer(commandBuffer, 0);
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw runtime_error("failed to begin recording virtual texture uploads!");
+    }
+    const VkDeviceSize uploadedBytes = recordCopies(commandBuffer, pageCopies, m_FrameIdx);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw runtime_error("failed to record virtual texture uploads!");
+    }
+
+    m_FrameStats.uploadedPages += pageCopies.size();
+    m_FrameStats.uploadedBytes += uploadedBytes;
+    m_Stats.uploadedPages += m_FrameStats.uploadedPages;
+    m_Stats.uploadedBytes += m_FrameStats.uploadedBytes;
+    return commandBuffer;
+}
+
+DEF VirtualTextureCache::recordFeedbackBarrier(VkCommandBuffer commandBuffer, const uint32_t frameIdx) const -> void {
+    // Host coherent memory only spares the flush, the atomics still have to be made available to the host
+    const VkBufferMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = m_FeedbackBuffer,
+        .offset = frameIdx * m_FeedbackRegionSize,
+        .size = m_FeedbackRegionSize};
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, nullptr,
+        1, &barrier,
+        0, nullptr);
+}
+
+DEF VirtualTextureCache::recordCopies(VkCommandBuffer commandBuffer, const vector<VkBufferImageCopy> &pageCopies, const uint32_t frameIdx) -> VkDeviceSize {
+    VkDeviceSize uploadedBytes = pageCopies.size() * SLOT_BYTES;
+
+    // Every dirty table is uploaded whole, they're a few KB at most
+    const VkDeviceSize tableRegionOffset = REGION_COUNT * REGION_SIZE + frameIdx * TABLE_REGION_SIZE;
+    VkDeviceSize tableOffset = 0;
+    vector<VirtualTexture *> tables;
+    vector<vector<VkBufferImageCopy>> tableCopies;
+    for (const auto &texture : m_Textures) {
+        if (!texture->tableDirty) continue;
+        rebuildPageTable(*texture);
+
+        vector<VkBufferImageCopy> copies;
+        for (uint32_t level = 0; level < texture->mipLevels; level++) {
+            copies.push_back(VkBufferImageCopy{
+                .bufferOffset = tableRegionOffset + tableOffset + texture->levelOffsets[level] * sizeof(uint32_t),
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .baseArrayLayer = 0, .layerCount = 1},
+                .imageOffset = {.x = 0, .y = 0, .z = 0},
+                .imageExtent = {
+                    .width = std::max(texture->tableWidth >> level, 1u),
+                    .height = std::max(texture->tableHeight >> level, 1u),
+                    .depth = 1}});
+        }
+        const VkDeviceSize tableBytes = texture->tableEntries.size() * sizeof(uint32_t);
+        memcpy(m_Staging + tableRegionOffset + tableOffset, texture->tableEntries.data(), tableBytes);
+        tableOffset += tableBytes;
+        texture->tableDirty = false;
+
+        tables.push_back(texture.get());
+        tableCopies.push_back(std::move(copies));
+    }
+    uploadedBytes += tableOffset;
+
+    // Frames submitted earlier may still sample the slots and tables that are about to be overwritten
+    vector<VkImageMemoryBarrier> toTransferDst;
+    const auto addBarrier = [&toTransferDst](VkImage image, const uint32_t levelCount, const bool initialized) {
+        toTransferDst.push_back(VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = initialized ? VK_ACCESS_SHADER_READ_BIT : VkAccessFlags{0},
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = levelCount, .baseArrayLayer = 0, .layerCount = 1}});
+    };
+    if (!pageCopies.empty()) addBarrier(m_PageCache, 1, true);
+    for (VirtualTexture *texture : tables) {
+        addBarrier(texture->pageTable, texture->mipLevels, texture->tableUploaded);
+        texture->tableUploaded = true;
+    }
+    if (toTransferDst.empty()) return 0;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(toTransferDst.size()), toTransferDst.data());
+
+    if (!pageCopies.empty()) {
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            m_StagingBuffer,
+            m_PageCache,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(pageCopies.size()),
+            pageCopies.data());
+    }
+    for (size_t i = 0; i < tables.size(); i++) {
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            m_StagingBuffer,
+            tables[i]->pageTable,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(tableCopies[i].size()),
+            tableCopies[i].data());
+    }
+
+    vector<VkImageMemoryBarrier> toShaderRead = toTransferDst;
+    for (VkImageMemoryBarrier &barrier : toShaderRead) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(toShaderRead.size()), toShaderRead.data());
+    return uploadedBytes;
+}
+
+DEF VirtualTextureCache::reclaimRegions() -> void {
+    // Not only the last frame of an index, any frame that completed is done copying out of the regions it uploaded from
+    for (auto retired = m_RetiredRegions.begin(); retired != m_RetiredRegions.end();) {
+        if (!m_Engine->isFrameComplete(retired->frame)) {
+            ++retired;
+            continue;
+        }
+        m_FreeRegions.push_back(retired->region);
+        retired = m_RetiredRegions.erase(retired);
+    }
+}
+
+DEF VirtualTextureCache::acquireRegion() -> uint32_t {
+    reclaimRegions();
+    if (m_FreeRegions.empty()) {
+        // The streaming thread holds at most one region, so with none free the others wait for their frames
+        const auto oldest = std::ranges::min_element(m_RetiredRegions, {}, &RetiredRegion::frame);
+        m_Engine->waitForFrame(oldest->frame);
+        reclaimRegions();
+    }
+    const uint32_t region = m_FreeRegions.back();
+    m_FreeRegions.pop_back();
+    return region;
+}
+
+DEF VirtualTextureCache::dispatchStreaming() -> void {
+    if (m_Streaming || m_Requests.empty() || m_FreeRegions.empty()) return;
+
+    StreamBatch batch{.region = m_FreeRegions.back(), .pages = {}, .done = {}};
+    m_FreeRegions.pop_back();
+
+    vector<std::pair<const VirtualTexture *, PageAddress>> pages;
+    for (const Request &request : m_Requests) {
+        if (batch.pages.size() == Settings::VIRTUAL_TEXTURE_UPLOADS_PER_FRAME) break;
+        m_PageStreaming[request.page] = 1;
+        batch.pages.push_back(request.page);
+
+        const PageAddress address = decodePage(request.page);
+        pages.emplace_back(m_Textures[address.texture].get(), address);
+    }
+    m_Requests.clear();
+
+    // Textures are never destroyed while the cache exists, the thread can hold on to their pixels
+    std::byte *destination = m_Staging + batch.region * REGION_SIZE;
+    batch.done = m_Streamer->enqueue([pages = std::move(pages), destination] {
+        for (size_t i = 0; i < pages.size(); i++) {
+            const auto &[texture, address] = pages[i];
+            writePage(*texture, address.level, address.x, address.y, destination + i * SLOT_BYTES);
+        }
+    });
+    m_Streaming = std::move(batch);
+}
+
+DEF VirtualTextureCache::writePage(const VirtualTexture &texture, const uint32_t level, const uint32_t x, const uint32_t y, std::byte *destination) -> void {
+    const uint32_t width = std::max(texture.width >> level, 1u);
+    const uint32_t height = std::max(texture.height >> level, 1u);
+    const uint8_t *source = texture.levels[level].data();
+
+    // Starts a border's width before the page, modulo keeps negative offsets wrapping to the other edge
+    const auto originX = static_cast<int64_t>(x) * PAGE_SIZE - PAGE_BORDER;
+    const auto originY = static_cast<int64_t>(y) * PAGE_SIZE - PAGE_BORDER;
+    for (uint32_t row = 0; row < SLOT_SIZE; row++) {
+        const auto sourceY = static_cast<uint32_t>(((originY + row) % height + height) % height);
+        const uint8_t *sourceRow = source + static_cast<size_t>(sourceY) * width * 4;
+        std::byte *destinationRow = destination + static_cast<size_t>(row) * SLOT_SIZE * 4;
+        for (uint32_t column = 0; column < SLOT_SIZE; column++) {
+            const auto sourceX = static_cast<uint32_t>(((originX + column) % width + width) % width);
+            memcpy(destinationRow + column * 4, sourceRow + sourceX * 4, 4);
+        }
+    }
+}
+
+DEF VirtualTextureCache::findSlot() -> uint32_t {
+    uint32_t oldest = NOT_RESIDENT;
+    for (uint32_t slot = 0; slot < m_Slots.size(); slot++) {
+        const CacheSlot &cacheSlot = m_Slots[slot];
+        if (!cacheSlot.occupied) return slot;
+        if (cacheSlot.pinned || cacheSlot.lastRequestedFrame >= m_Frame) continue;
+        if (oldest == NOT_RESIDENT || cacheSlot.lastRequestedFrame < m_Slots[oldest].lastRequestedFrame) oldest = slot;
+    }
+    return oldest;
+}
+
+DEF VirtualTextureCache::makeResident(const uint32_t page, const uint32_t slot, const bool pinned) -> void {
+    CacheSlot &cacheSlot = m_Slots[slot];
+    if (cacheSlot.occupied) {
+        m_PageSlots[cacheSlot.page] = NOT_RESIDENT;
+        m_Textures[decodePage(cacheSlot.page).texture]->tableDirty = true;
+        m_ResidentPageCount--;
+        m_FrameStats.evictedPages++;
+        m_Stats.evictedPages++;
+    }
+
+    // Counts as requested this frame, so the rest of the batch can't evict it again
+    cacheSlot = CacheSlot{.page = page, .lastRequestedFrame = m_Frame, .occupied = true, .pinned = pinned};
+    m_PageSlots[page] = slot;
+    m_Textures[decodePage(page).texture]->tableDirty = true;
+    m_ResidentPageCount++;
+}
+
+DEF VirtualTextureCache::rebuildPageTable(VirtualTexture &texture) -> void {
+    // From the pinned last level down, missing pages take over their parent's entry
+    for (uint32_t level = texture.mipLevels; level-- > 0;) {
+        const uint32_t tableWidth = std::max(texture.tableWidth >> level, 1u);
+        const uint32_t tableHeight = std::max(texture.tableHeight >> level, 1u);
+        const uint32_t parentWidth = std::max(texture.tableWidth >> (level + 1), 1u);
+        for (uint32_t y = 0; y < tableHeight; y++) {
+            for (uint32_t x = 0; x < tableWidth; x++) {
+                const uint32_t entry = texture.levelOffsets[level] + y * tableWidth + x;
+                const uint32_t slot = m_PageSlots[texture.firstPage + entry];
+                if (slot != NOT_RESIDENT) {
+                    texture.tableEntries[entry] = packEntry(slot, level);
+                } else if (level + 1 < texture.mipLevels) {
+                    texture.tableEntries[entry] = texture.tableEntries[texture.levelOffsets[level + 1] + (y / 2) * parentWidth + x / 2];
+                }
+            }
+        }
+    }
+}
+
+DEF VirtualTextureCache::decodePage(const uint32_t page) const -> PageAddress {
+    for (uint32_t textureIdx = 0; textureIdx < m_Textures.size(); textureIdx++) {
+        const VirtualTexture &texture = *m_Textures[textureIdx];
+        if (page >= texture.firstPage + texture.levelOffsets.back()) continue;
+
+        const uint32_t entry = page - texture.firstPage;
+        const auto level = static_cast<uint32_t>(std::ranges::upper_bound(texture.levelOffsets, entry) - texture.levelOffsets.begin()) - 1;
+        const uint32_t tableWidth = std::max(texture.tableWidth >> level, 1u);
+        const uint32_t index = entry - texture.levelOffsets[level];
+        return PageAddress{.texture = textureIdx, .level = level, .x = index % tableWidth, .y = index / tableWidth};
+    }
+    throw runtime_error("Virtual texture page index out of range!");
+}
+
+DEF VirtualTextureCache::printStats() const -> void {
+    const double hitRate = m_Stats.requestedPages > 0 ? 100.0 * static_cast<double>(m_Stats.hits) / static_cast<double>(m_Stats.requestedPages) : 100.0;
+    fprintf(stdout, "Virtual textures: %zu textures, %u of %u cache slots resident, %.1f%% hit rate over %llu page requests\n",
+            m_Textures.size(), m_ResidentPageCount, SLOT_COUNT, hitRate, static_cast<unsigned long long>(m_Stats.requestedPages));
+    fprintf(stdout, "\tUploaded %llu pages (%.2f MB), evicted %llu, dropped %llu\n",
+            static_cast<unsigned long long>(m_Stats.uploadedPages),
+            toMB(m_Stats.uploadedBytes),
+            static_cast<unsigned long long>(m_Stats.evictedPages),
+            static_cast<unsigned long long>(m_Stats.droppedPages));
+}
@@ -0,0 +1,246 @@
+#include "Constants.h"
+
+#include "engine/vulkanObjectCache.h"
+
+namespace {
+    // Appends fields one by one, whole structs would bring their padding and pointers into the key
+    class KeyWriter {
+    public:
+        template <typename T>
+        DEF write(const T &value) -> void {
+            static_assert(std::is_trivially_copyable_v<T>);
+            m_Key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        DEF writeReferences(const uint32_t count, const VkAttachmentReference *references) -> void {
+            write(references != nullptr ? count : 0u);
+            if (references == nullptr) return;
+            for (uint32_t i = 0; i < count; i++) {
+                write(references[i].attachment);
+                write(references[i].layout);
+            }
+        }
+
+        DEF take() -> string { return std::move(m_Key); }
+
+    private:
+        string m_Key;
+    };
+
+    template <typename Handle, typename Create>
+    DEF lookup(unordered_map<string, Handle> &objects, VulkanObjectCache::KindStats &stats, string key, Create create) -> Handle {
+        if (const auto found = objects.find(key); found != objects.end()) {
+            stats.hits++;
+            return found->second;
+        }
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        Handle handle = create();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        stats.misses++;
+        stats.createMs += elapsed.count();
+        objects.emplace(std::move(key), handle);
+        return handle;
+    }
+
+    DEF savedMs(const VulkanObjectCache::KindStats &stats) -> double {
+        if (stats.misses == 0) return 0.0;
+        return static_cast<double>(stats.hits) * stats.createMs / static_cast<double>(stats.misses);
+    }
+
+    DEF printKind(const char *name, const VulkanObjectCache::KindStats &stats, const size_t count) -> void {
+        fprintf(stdout, "\t%-23s %4zu objects, %6llu hits, %4llu misses, %8.3f ms creating, ~%8.3f ms saved\n",
+                name,
+                count,
+                static_cast<unsigned long long>(stats.hits),
+                static_cast<unsigned long long>(stats.misses),
+                stats.createMs,
+                savedMs(stats));
+    }
+} // namespace
+
+VulkanObjectCache::VulkanObjectCache(VkDevice device)
+    : m_Device(device),
+      m_Stats() {}
+
+VulkanObjectCache::~VulkanObjectCache() {
+    // Pipeline layouts reference descriptor set layouts, so they go first
+    for (const auto &[key, pipelineLayout] : m_PipelineLayouts) vkDestroyPipelineLayout(m_Device, pipelineLayout, nullptr);
+    for (const auto &[key, descriptorSetLayout] : m_DescriptorSetLayouts) vkDestroyDescriptorSetLayout(m_Device, descriptorSetLayout, nullptr);
+    for (const auto &[key, sampler] : m_Samplers) vkDestroySampler(m_Device, sampler, nullptr);
+    for (const auto &[key, renderPass] : m_RenderPasses) vkDestroyRenderPass(m_Device, renderPass, nullptr);
+}
+
+DEF VulkanObjectCache::getSampler(const VkSamplerCreateInfo &createInfo) -> VkSampler {
+    if (createInfo.pNext != nullptr) throw runtime_error("VulkanObjectCache can't key a sampler with a pNext chain!");
+
+    KeyWriter key;
+    key.write(createInfo.flags);
+    key.write(createInfo.magFilter);
+    key.write(createInfo.minFilter);
+    key.write(createInfo.mipmapMode);
+    key.write(createInfo.addressModeU);
+    key.write(createInfo.addressModeV);
+    key.write(createInfo.addressModeW);
+    key.write(createInfo.mipLodBias);
+    key.write(createInfo.anisotropyEnable);
+    if (createInfo.anisotropyEnable) key.write(createInfo.maxAnisotropy);
+    key.write(createInfo.compareEnable);
+    if (createInfo.compareEnable) key.write(createInfo.compareOp);
+    key.write(createInfo.minLod);
+    key.write(createInfo.maxLod);
+    const bool usesBorder = createInfo.addressModeU == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER ||
+                            createInfo.addressModeV == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER ||
+                            createInfo.addressModeW == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    if (usesBorder) key.write(createInfo.borderColor);
+    key.write(createInfo.unnormalizedCoordinates);
+
+    std::lock_guard lock(m_Mutex);
+    return lookup(m_Samplers, m_Stats.samplers, key.take(), [&] {
+        VkSampler sampler = VK_NULL_HANDLE;
+        if (vkCreateSampler(m_Device, &createInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw runtime_error("failed to create sampler!");
+        }
+        return sampler;
+    });
+}
+
+DEF VulkanObjectCache::getDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo &createInfo) -> VkDescriptorSetLayout {
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo *flagsInfo = nullptr;
+    for (auto next = static_cast<const VkBaseInStructure *>(createInfo.pNext); next != nullptr; next = next->pNext) {
+        if (next->sType != VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO) {
+            throw runtime_error("VulkanObjectCache can't key a descriptor set layout with this pNext chain!");
+        }
+        flagsInfo = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo *>(next);
+    }
+    const bool hasFlags = flagsInfo != nullptr && flagsInfo->bindingCount > 0;
+
+    // Binding order in the create-info doesn't matter to Vulkan, it shouldn't to the key either
+    vector<uint32_t> order(createInfo.bindingCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::ranges::sort(order, [&](const uint32_t a, const uint32_t b) { return createInfo.pBindings[a].binding < createInfo.pBindings[b].binding; });
+
+    KeyWriter key;
+    key.write(createInfo.flags);
+    key.write(createInfo.bindingCount);
+    for (const uint32_t i : order) {
+        const VkDescriptorSetLayoutBinding &binding = createInfo.pBindings[i];
+        key.write(binding.binding);
+        key.write(binding.descriptorType);
+        key.write(binding.descriptorCount);
+        key.write(binding.stageFlags);
+        const bool takesSamplers = binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER ||
+                                   binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        const bool immutable = takesSamplers && binding.pImmutableSamplers != nullptr;
+        key.write(immutable);
+        if (immutable) {
+            for (uint32_t sampler = 0; sampler < binding.descriptorCount; sampler++) key.write(binding.pImmutableSamplers[sampler]);
+        }
+        key.write(hasFlags ? flagsInfo->pBindingFlags[i] : VkDescriptorBindingFlags{0});
+    }
+
+    std::lock_guard lock(m_Mutex);
+    return lookup(m_DescriptorSetLayouts, m_Stats.descriptorSetLayouts, key.take(), [&] {
+        VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+        if (vkCreateDescriptorSetLayout(m_Device, &createInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+            throw runtime_error("failed to create descriptor set layout!");
+        }
+        return descriptorSetLayout;
+    });
+}
+
+DEF VulkanObjectCache::getPipelineLayout(const VkPipelineLayoutCreateInfo &createInfo) -> VkPipelineLayout {
+    if (createInfo.pNext != nullptr) throw runtime_error("VulkanObjectCache can't key a pipeline layout with a pNext chain!");
+
+    // Set layouts are keyed by handle, which is unique as long as they come from this cache as well
+    KeyWriter key;
+    key.write(createInfo.flags);
+    key.write(createInfo.setLayoutCount);
+    for (uint32_t i = 0; i < createInfo.setLayoutCount; i++) key.write(createInfo.pSetLayouts[i]);
+    key.write(createInfo.pushConstantRangeCount);
+    for (uint32_t i = 0; i < createInfo.pushConstantRangeCount; i++) {
+        key.write(createInfo.pPushConstantRanges[i].stageFlags);
+        key.write(createInfo.pPushConstantRanges[i].offset);
+        key.write(createInfo.pPushConstantRanges[i].size);
+    }
+
+    std::lock_guard lock(m_Mutex);
+    return lookup(m_PipelineLayouts, m_Stats.pipelineLayouts, key.take(), [&] {
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        if (vkCreatePipelineLayout(m_Device, &createInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+            throw runtime_error("failed to create pipeline layout!");
+        }
+        return pipelineLayout;
+    });
+}
+
+DEF VulkanObjectCache::getRenderPass(const VkRenderPassCreateInfo &createInfo) -> VkRenderPass {
+    if (createInfo.pNext != nullptr) throw runtime_error("VulkanObjectCache can't key a render pass with a pNext chain!");
+
+    KeyWriter key;
+    key.write(createInfo.flags);
+    key.write(createInfo.attachmentCount);
+    for (uint32_t i = 0; i < createInfo.attachmentCount; i++) {
+        const VkAttachmentDescription &attachment = createInfo.pAttachments[i];
+        key.write(attachment.flags);
+        key.write(attachment.format);
+        key.write(attachment.samples);
+        key.write(attachment.loadOp);
+        key.write(attachment.storeOp);
+        key.write(attachment.stencilLoadOp);
+        key.write(attachment.stencilStoreOp);
+        key.write(attachment.initialLayout);
+        key.write(attachment.finalLayout);
+    }
+    key.write(createInfo.subpassCount);
+    for (uint32_t i = 0; i < createInfo.subpassCount; i++) {
+        const VkSubpassDescription &subpass = createInfo.pSubpasses[i];
+        key.write(subpass.flags);
+        key.write(subpass.pipelineBindPoint);
+        key.writeReferences(subpass.inputAttachmentCount, subpass.pInputAttachments);
+        key.writeReferences(subpass.colorAttachmentCount, subpass.pColorAttachments);
+        key.writeReferences(subpass.colorAttachmentCount, subpass.pResolveAttachments);
+        key.writeReferences(1, subpass.pDepthStencilAttachment);
+        key.write(subpass.preserveAttachmentCount);
+        for (uint32_t attachment = 0; attachment < subpass.preserveAttachmentCount; attachment++) key.write(subpass.pPreserveAttachments[attachment]);
+    }
+    key.write(createInfo.dependencyCount);
+    for (uint32_t i = 0; i < createInfo.dependencyCount; i++) {
+        const VkSubpassDependency &dependency = createInfo.pDependencies[i];
+        key.write(dependency.srcSubpass);
+        key.write(dependency.dstSubpass);
+        key.write(dependency.srcStageMask);
+        key.write(dependency.dstStageMask);
+        key.write(dependency.srcAccessMask);
+        key.write(dependency.dstAccessMask);
+        key.write(dependency.dependencyFlags);
+    }
+
+    std::lock_guard lock(m_Mutex);
+    return lookup(m_RenderPasses, m_Stats.renderPasses, key.take(), [&] {
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        if (vkCreateRenderPass(m_Device, &createInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw runtime_error("failed to create render pass!");
+        }
+        return renderPass;
+    });
+}
+
+DEF VulkanObjectCache::getStats() const -> Stats {
+    std::lock_guard lock(m_Mutex);
+    return m_Stats;
+}
+
+DEF VulkanObjectCache::getSavedMs() const -> double {
+    std::lock_guard lock(m_Mutex);
+    return savedMs(m_Stats.samplers) + savedMs(m_Stats.descriptorSetLayouts) + savedMs(m_Stats.pipelineLayouts) + savedMs(m_Stats.renderPasses);
+}
+
+DEF VulkanObjectCache::printStats() const -> void {
+    std::lock_guard lock(m_Mutex);
+    fprintf(stdout, "Vulkan object cache:\n");
+    printKind("Samplers", m_Stats.samplers, m_Samplers.size());
+    printKind("Descriptor set layouts", m_Stats.descriptorSetLayouts, m_DescriptorSetLayouts.size());
+    printKind("Pipeline layouts", m_Stats.pipelineLayouts, m_PipelineLayouts.size());
+    printKind("Render passes", m_Stats.renderPasses, m_RenderPasses.size());
+}